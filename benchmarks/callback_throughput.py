@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""
+Measures PythonParameter callbacks per second, as dispatched by Parameter_callback().
+
+Each callback looks up its Parameter in the param_t -> Parameter map (src/pointer_map.c),
+for both single value parameters, and each index of a 1000 element array.
+"""
+
+from __future__ import annotations
+
+import pycsh
+from time import perf_counter
+
+
+def main(iterations: int = 100000, array_size: int = 1000) -> None:
+
+    pycsh.init(quiet=True)
+
+    calls = 0
+
+    def callback(param: pycsh.Parameter, offset: int) -> None:
+        nonlocal calls
+        calls += 1
+
+    single = pycsh.PythonParameter(720, "bench_callback_single", pycsh.PARAM_TYPE_UINT32, pycsh.PM_DEBUG, callback=callback)
+    array = pycsh.PythonParameter(721, "bench_callback_array", pycsh.PARAM_TYPE_UINT32, pycsh.PM_DEBUG, array_size=array_size, callback=callback)
+
+    start = perf_counter()
+    for i in range(iterations):
+        single.cached_value = i
+    elapsed = perf_counter() - start
+    print(f"1 element:    {calls / elapsed:12.0f} callbacks/s")
+
+    calls = 0
+    values = tuple(range(array_size))
+    start = perf_counter()
+    for _ in range(max(1, iterations // array_size)):
+        array.cached_value = values
+    elapsed = perf_counter() - start
+    print(f"{array_size} elements: {calls / elapsed:12.0f} callbacks/s")
+
+    single.keep_alive = False
+    array.keep_alive = False
+
+
+if __name__ == '__main__':
+    main()
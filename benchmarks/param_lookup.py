@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""
+Measures parameter lookups per second by name and id, through _pycsh_util_find_param_t().
+
+Lookups are served by the hash index (src/param_index.c),
+so parameters near the end of the list should be found as quickly as those near the start,
+where walking the list would take time proportional to its length.
+
+NOTE: Setup is slow for large counts, as libparam's param_list_add() still walks the list for duplicates.
+"""
+
+from __future__ import annotations
+
+import sys
+import pycsh
+from time import perf_counter
+
+
+def lookups_per_second(identifiers: list[tuple[str | int, int]], rounds: int) -> float:
+    start = perf_counter()
+    for _ in range(rounds):
+        for identifier, node in identifiers:
+            pycsh.get_type(identifier, node)
+    return (rounds * len(identifiers)) / (perf_counter() - start)
+
+
+def main(count: int = 100000, per_node: int = 1000, rounds: int = 20) -> None:
+
+    pycsh.init(quiet=True)
+
+    start = perf_counter()
+    for i in range(count):
+        node, param_id = 1000 + i // per_node, i % per_node
+        pycsh.list_add(node, 1, param_id, f"bench_lookup_{i}", pycsh.PARAM_TYPE_UINT32)
+    print(f"Added {count} parameters in {perf_counter() - start:.1f}s")
+
+    sample = range(0, count, max(1, count // 1000))
+    for label, indexes in (("first", sample[:len(sample)//10]), ("last", sample[-(len(sample)//10):])):
+        by_name = [(f"bench_lookup_{i}", 1000 + i // per_node) for i in indexes]
+        by_id = [(i % per_node, 1000 + i // per_node) for i in indexes]
+        print(f"{label:5} 10%: name {lookups_per_second(by_name, rounds):12.0f} lookups/s | id {lookups_per_second(by_id, rounds):12.0f} lookups/s")
+
+
+if __name__ == '__main__':
+    main(*(int(arg) for arg in sys.argv[1:]))
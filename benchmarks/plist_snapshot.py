@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+"""
+Measures ParameterList.snapshot() per parameter, against reading .cached_value of each Parameter in Python.
+
+The target is below 1 µs per scalar parameter.
+
+Usage: plist_snapshot.py [count] [iterations]
+"""
+
+from __future__ import annotations
+
+import sys
+import pycsh
+from time import perf_counter
+
+
+def us_per_param(func, count: int, iterations: int) -> float:
+    start = perf_counter()
+    for _ in range(iterations):
+        func()
+    return (perf_counter() - start) / (iterations * count) * 1e6
+
+
+def main(count: int = 1000, iterations: int = 200) -> None:
+
+    pycsh.init(quiet=True)
+
+    params = [pycsh.PythonParameter(800 + i, f"bench_snapshot_{i}", pycsh.PARAM_TYPE_FLOAT, pycsh.PM_DEBUG) for i in range(count)]
+    plist = pycsh.ParameterList(params)
+
+    snapshot = us_per_param(plist.snapshot, count, iterations)
+    python = us_per_param(lambda: [param.cached_value for param in plist], count, iterations)
+
+    print(f"{count} scalar parameters: snapshot() {snapshot:6.3f} µs/param | .cached_value {python:6.3f} µs/param | x{python/snapshot:.2f}")
+
+    for param in params:
+        param.keep_alive = False
+
+
+if __name__ == '__main__':
+    main(*(int(arg) for arg in sys.argv[1:]))
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+Counts the packets sent by set() of an array parameter, through pycsh.queue_stats().
+
+The array is pushed to our own address, so it takes the remote path and is answered by the loopback parameter server.
+Every index used to cost a request of its own, whereas the queue is now split into as few packets as the MTU allows.
+The values are chosen to serialize to the same number of bytes, so every set must take exactly
+ceil(elements / (PARAM_SERVER_MTU // bytes per element)) packets.
+
+Usage: set_array_packets.py [address] [iterations]
+"""
+
+from __future__ import annotations
+
+import sys
+import pycsh
+from math import ceil
+from time import perf_counter
+
+
+def main(address: int = 10, iterations: int = 100) -> None:
+
+    pycsh.init(quiet=True)
+    pycsh.csp_init()
+    pycsh.csp_add_udp(address, "127.0.0.1", listen_port=9221, remote_port=9221)  # Gives us 'address', pushes to it are looped back.
+
+    print(f"{'elements':>8} {'packets':>8} {'bytes':>8} {'fill':>8} {'sets/s':>10}")
+
+    for size in (2, 8, 32, 128, 512):
+
+        param = pycsh.PythonParameter(900 + size, f"bench_set_array_{size}", pycsh.PARAM_TYPE_UINT32, pycsh.PM_DEBUG, array_size=size)
+        values = [0x10000 + i for i in range(size)]  # Every value takes the same 5 bytes of msgpack
+
+        pycsh.queue_stats(reset=True)
+        start = perf_counter()
+        for _ in range(iterations):
+            pycsh.set(param, values, server=address, timeout=1000, verbose=-1)
+        rate = iterations / (perf_counter() - start)
+        stats = pycsh.queue_stats(reset=True)
+
+        packets = stats["packets"] / iterations
+        payload = stats["bytes"] / iterations
+        fill = payload / packets
+        print(f"{size:>8} {packets:>8.1f} {payload:>8.0f} {fill:>8.1f} {rate:>10.0f}")
+
+        assert stats["timeouts"] == 0, "The loopback parameter server did not respond"
+        assert stats["bytes"] % (iterations * size) == 0, "Expected every element to serialize to the same size"
+        element_bytes = stats["bytes"] // (iterations * size)
+        expected = ceil(size / (pycsh.PARAM_SERVER_MTU // element_bytes))
+        assert stats["packets"] == expected * iterations, f"Expected {expected} packets per set, got {packets:.1f}"
+
+        param.keep_alive = False
+
+
+if __name__ == '__main__':
+    main(*(int(arg) for arg in sys.argv[1:]))
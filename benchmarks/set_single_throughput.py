@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""
+Measures local sets per second through _pycsh_util_set_single().
+
+int/float values take the typed conversion path,
+whereas str values still take the str() -> param_str_to_value() path used before.
+"""
+
+from __future__ import annotations
+
+import pycsh
+from time import perf_counter
+
+
+def sets_per_second(param: pycsh.Parameter, value, iterations: int) -> float:
+    start = perf_counter()
+    for _ in range(iterations):
+        param.cached_value = value
+    return iterations / (perf_counter() - start)
+
+
+def main(iterations: int = 200000) -> None:
+
+    pycsh.init(quiet=True)
+
+    cases = (
+        (pycsh.PARAM_TYPE_UINT32, 123456, "123456"),
+        (pycsh.PARAM_TYPE_XINT16, 0xBEEF, "0xBEEF"),
+        (pycsh.PARAM_TYPE_INT64, -1234567890123, "-1234567890123"),
+        (pycsh.PARAM_TYPE_DOUBLE, 3.14159, "3.14159"),
+    )
+
+    for i, (param_type, typed_value, str_value) in enumerate(cases):
+        param = pycsh.PythonParameter(700 + i, f"bench_set_{i}", param_type, pycsh.PM_DEBUG)
+
+        str_rate = sets_per_second(param, str_value, iterations)
+        typed_rate = sets_per_second(param, typed_value, iterations)
+
+        print(f"type {param_type:2}: str {str_rate:12.0f} sets/s | {type(typed_value).__name__:5} {typed_rate:12.0f} sets/s | x{typed_rate/str_rate:.2f}")
+
+        param.keep_alive = False
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+"""
+Measures the CPU time per sample of the parameter sniffer, using "sniffer bench".
+
+Synthetic pull responses are decoded into sample records on the calling thread,
+first without rendering them, then rendering each as the text line of the Victoria Metrics and logfile sinks.
+The sink queues are not involved, so this may run while the sniffer is active.
+
+Usage: sniffer_ingest.py [samples]
+"""
+
+from __future__ import annotations
+
+import sys
+import pycsh
+
+
+def main(samples: int = 1000000) -> None:
+
+    pycsh.init(quiet=True)
+
+    bench = pycsh.SlashCommand("sniffer bench")
+
+    for integer in (False, True):
+        for array in (1, 8, 64):
+            if integer:
+                bench(samples=samples, array=array, integer=True)
+            else:
+                bench(samples=samples, array=array)
+            print()
+
+
+if __name__ == '__main__':
+    main(*(int(arg) for arg in sys.argv[1:]))
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Compares the VictoriaMetrics push formats of "vm start" against a local mock endpoint (vm_standin.py):
+
+    text        Prometheus text, one line per sample (the default)
+    text+gzip   vm start -z
+    json        vm start -j, one JSON line per series with all of its samples
+    json+gzip   vm start -j -z
+
+Batches mimic one second of sniffed housekeeping, and are encoded the same way as the C client does,
+reporting bytes per sample on the wire and samples per second through the endpoint.
+
+Usage: vm_ingest_formats.py [series] [samples_per_series] [iterations]
+"""
+
+from __future__ import annotations
+
+import sys
+import json
+import gzip
+import threading
+import urllib.request
+from time import perf_counter
+from collections import defaultdict
+from http.server import ThreadingHTTPServer
+
+from vm_standin import StandIn
+
+
+def make_batch(series: int, samples: int) -> bytes:
+    lines = []
+    for s in range(samples):
+        for i in range(series):
+            lines.append(f'bench_param_{i % 50}{{node="{10 + i // 50}", idx="{i % 4}"}} {1.0 + i * 0.001 + s:e} {1700000000000 + s * 100}\n')
+    return ''.join(lines).encode()
+
+
+def encode_json(batch: bytes) -> bytes:
+    """ Same grouping as vm_encode_json() in src/csh/victoria_metrics.c """
+    grouped: dict[bytes, tuple[list[bytes], list[bytes]]] = defaultdict(lambda: ([], []))
+    for line in batch.splitlines():
+        series, value, timestamp = line.rsplit(b' ', 2)
+        grouped[series][0].append(value)
+        grouped[series][1].append(timestamp)
+
+    out = []
+    for series, (values, timestamps) in sorted(grouped.items()):
+        name, _, labels = series.decode().partition('{')
+        metric = {'__name__': name}
+        for pair in labels.rstrip('}').split(','):
+            if '=' in pair:
+                key, _, value = pair.strip().partition('=')
+                metric[key] = value.strip('"')
+        out.append(f'{{"metric":{json.dumps(metric, separators=(",", ":"))},"values":[{",".join(v.decode() for v in values)}],"timestamps":[{",".join(t.decode() for t in timestamps)}]}}\n')
+    return ''.join(out).encode()
+
+
+def post(url: str, body: bytes, content_type: str, compressed: bool) -> None:
+    headers = {'Content-Type': content_type}
+    if compressed:
+        headers['Content-Encoding'] = 'gzip'
+    urllib.request.urlopen(urllib.request.Request(url, data=body, headers=headers, method='POST')).read()
+
+
+def main(series: int = 500, samples: int = 10, iterations: int = 20) -> None:
+
+    StandIn.quiet = True
+    server = ThreadingHTTPServer(('127.0.0.1', 0), StandIn)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    base = f'http://127.0.0.1:{server.server_address[1]}'
+
+    batch = make_batch(series, samples)
+    count = series * samples
+
+    formats = {
+        'text': lambda: (batch, '/api/v1/import/prometheus', 'text/plain', False),
+        'text+gzip': lambda: (gzip.compress(batch, 6), '/api/v1/import/prometheus', 'text/plain', True),
+        'json': lambda: (encode_json(batch), '/api/v1/import?', 'application/json', False),
+        'json+gzip': lambda: (gzip.compress(encode_json(batch), 6), '/api/v1/import?', 'application/json', True),
+    }
+
+    print(f"{count} samples per batch ({len(batch)} bytes of text)")
+    for name, encode in formats.items():
+        start = perf_counter()
+        for _ in range(iterations):
+            body, path, content_type, compressed = encode()
+            post(base + path, body, content_type, compressed)
+        elapsed = perf_counter() - start
+        print(f"{name:10} {len(body) / count:7.2f} bytes/sample | x{len(batch) / len(body):5.1f} smaller | {count * iterations / elapsed:10.0f} samples/s")
+
+    server.shutdown()
+
+
+if __name__ == '__main__':
+    main(*(int(arg) for arg in sys.argv[1:]))
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for a VictoriaMetrics server, for testing "vm start" without one.
+
+Accepts the connection test, /api/v1/import/prometheus and /api/v1/import (JSON lines),
+counting the received samples. Gzip Content-Encoding is decompressed.
+Failures and latency can be injected, to exercise the spool and its replay:
+
+    vm_standin.py --port 8428 --fail 10-20 --delay 0.5
+    (in PyCSH) vm start -d /tmp/vm_spool localhost
+    (in PyCSH) vm stats
+
+Usage: vm_standin.py [--port PORT] [--fail FIRST-LAST] [--delay SECONDS]
+"""
+
+from __future__ import annotations
+
+import argparse
+import gzip
+import json
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+class StandIn(BaseHTTPRequestHandler):
+
+    imports = 0
+    lines = 0
+    fail_range = range(0)
+    delay = 0.0
+    quiet = False
+
+    def do_POST(self) -> None:
+        body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+
+        if self.path.startswith('/prometheus/api/v1/query'):
+            self.send_response(200)
+            self.send_header('Content-Length', '0')
+            self.end_headers()
+            return
+
+        json_lines = self.path.startswith('/api/v1/import?')
+        if not json_lines and not self.path.startswith('/api/v1/import/prometheus'):
+            self.send_error(404)
+            return
+
+        cls = type(self)
+        index = cls.imports
+        cls.imports += 1
+        time.sleep(cls.delay)
+
+        if index in cls.fail_range:
+            print(f"import #{index}: failing on purpose")
+            self.send_error(503)
+            return
+
+        if self.headers.get('Content-Encoding') == 'gzip':
+            body = gzip.decompress(body)
+
+        if json_lines:
+            # One line per series, count its samples.
+            received = sum(len(json.loads(line)['values']) for line in body.splitlines() if line)
+        else:
+            received = body.count(b'\n')
+        cls.lines += received
+        if not cls.quiet:
+            print(f"import #{index}: {received} samples ({len(body)} bytes), {cls.lines} samples total")
+        self.send_response(204)
+        self.end_headers()
+
+    def log_message(self, format: str, *args) -> None:
+        pass  # We print our own summary per import.
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--port', type=int, default=8428)
+    parser.add_argument('--fail', default=None, help="Range of import numbers to fail, i.e 10-20")
+    parser.add_argument('--delay', type=float, default=0.0, help="Seconds to wait before answering each import")
+    args = parser.parse_args()
+
+    if args.fail:
+        first, _, last = args.fail.partition('-')
+        StandIn.fail_range = range(int(first), int(last or first) + 1)
+    StandIn.delay = args.delay
+
+    ThreadingHTTPServer(('', args.port), StandIn).serve_forever()
+
+
+if __name__ == '__main__':
+    main()
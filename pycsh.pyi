@@ -14,7 +14,8 @@ from typing import \
     Any as _Any, \
     Iterable as _Iterable, \
     Literal as _Literal, \
-    Callable as _Callable
+    Callable as _Callable, \
+    Awaitable as _Awaitable
 from datetime import datetime as _datetime
 
 _param_value_hint = int | float | str
@@ -65,6 +66,8 @@ PM_PRIO2: int
 PM_PRIO3: int
 PM_PRIO_MASK: int
 
+PARAM_SERVER_MTU: int  # Bytes of parameter data in a single request packet.
+
 # Custom Exceptions
 class ProgramDiffError(ConnectionError):
     """
@@ -84,6 +87,13 @@ class InvalidParameterTypeError(ValueError):
     Must be caught before ValueError() baseclass.
     """
 
+class PartialResponseError(ConnectionError):
+    """
+    Raised when only some of the packets of a segmented request received a response.
+    args[1] is a list of the Parameters in the failed packets.
+    Must be caught before ConnectionError() baseclass.
+    """
+
 
 class Parameter:
     """
@@ -140,7 +150,7 @@ class Parameter:
         """
         Sets the local cached value of the parameter.
 
-        :param value: New desired value. Assignments to other parameters, use their value instead, Otherwise uses .__str__().
+        :param value: New desired value. int and float values are converted directly (range checked), assignments to other parameters use their value instead, otherwise uses .__str__().
         """
 
     @property
@@ -148,6 +158,7 @@ class Parameter:
         """
         Returns the remote value of the parameter from its specified node in the Python representation of its type.
         Array parameters return a tuple of values, whereas normal parameters return only a single value.
+        Array parameters larger than a single packet are pulled in several packets, see pycsh.max_in_flight().
         """
 
     @remote_value.setter
@@ -155,7 +166,34 @@ class Parameter:
         """
         Sets the remote value of the parameter.
 
-        :param value: New desired value. Assignments to other parameters, use their value instead, Otherwise uses .__str__().
+        :param value: New desired value. int and float values are converted directly (range checked), assignments to other parameters use their value instead, otherwise uses .__str__().
+        """
+
+    def aget(self, deadline: float = None) -> _Awaitable[_param_type_hint | tuple[_param_type_hint]]:
+        """
+        Awaitable equivalent of .remote_value, for use in coroutines.
+        The request is performed by a C worker thread, so awaiting it needs no Python thread.
+        At most async_workers() requests are in flight at once though, the rest wait for a worker in order.
+
+        :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+            including the time spent waiting for a worker, every packet and every retry.
+        :raises RuntimeError: When not called from a running event loop.
+        :raises ConnectionError: (when awaited) When no response is received.
+        :raises TimeoutError: (when awaited) When the deadline expired before a response was received.
+
+        :return: Future resolving to the remote value of the parameter. Cancelling it discards any request that is yet to be sent.
+        """
+
+    def aset(self, value: _param_value_hint | _Iterable[int | float], deadline: float = None) -> _Awaitable[None]:
+        """
+        Awaitable equivalent of assigning .remote_value, for use in coroutines.
+        The value is converted immediately, so conversion errors are raised by the call itself.
+
+        :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+            including the time spent waiting for a worker, every packet and every retry.
+        :raises RuntimeError: When not called from a running event loop.
+        :raises ConnectionError: (when awaited) When no response is received.
+        :raises TimeoutError: (when awaited) When the deadline expired before a response was received.
         """
 
     @property
@@ -192,6 +230,46 @@ class Parameter:
         Use None to reset default value.
         """
 
+    @property
+    def max_age(self) -> float | None:
+        """ Returns the number of seconds a pulled or sniffed value may be used for by .remote_value, or None to always pull. """
+
+    @max_age.setter
+    def max_age(self, value: float | None) -> None:
+        """
+        Sets the number of seconds a pulled or sniffed value may be used for by .remote_value (and pycsh.get()),
+        instead of pulling it again. Use None to always pull (default).
+        The local receive time is used when known, otherwise .timestamp.
+        """
+
+    @property
+    def history_size(self) -> int:
+        """ Returns the number of samples kept in the history of the parameter, 0 when disabled. """
+
+    @history_size.setter
+    def history_size(self, value: int | None) -> None:
+        """
+        Enables the history of the parameter, keeping the newest 'value' samples.
+        Samples are recorded when the value is set locally, pulled, or decoded by the parameter sniffer.
+        Use 0 or None to disable the history and free its memory.
+
+        :raises TypeError: For non-numeric parameters.
+        :raises MemoryError: When the history would exceed pycsh.history_limit().
+        """
+
+    def history(self, since: float = None, max: int = None) -> tuple[memoryview, memoryview]:
+        """
+        Returns the recorded history of the parameter, oldest sample first.
+        Each sample contains every index of the parameter, indexes not written by the sample keep their previous value.
+
+        :param since: Only include samples with a timestamp (seconds since the epoch) >= since.
+        :param max: Only include the newest 'max' samples.
+        :raises ValueError: When the history is not enabled by .history_size
+
+        :return: (timestamps, values) as memoryviews, timestamps are doubles in seconds since the epoch,
+            values have the C type of the parameter with shape (samples,) or (samples, array_size).
+        """
+
 class ParameterArray(Parameter):
     """
     Subclass of Parameter specifically designed to provide an interface
@@ -230,6 +308,19 @@ class ParameterArray(Parameter):
         :raises ConnectionError: When autosend is on, and no response is received.
         """
 
+    def __buffer__(self, flags: int, /) -> memoryview:
+        """
+        Exposes the cached values of the array through the buffer protocol,
+        without creating a Python object per index.
+        i.e: memoryview(param), numpy.frombuffer(param) or array.array('H', param)
+
+        The format matches the C type of the parameter (i.e 'H' for uint16, 'd' for double).
+        Values of RAM parameters are exported without copying,
+        whereas VMEM parameters (i.e PythonGetSetArrayParameter) are copied into a snapshot.
+
+        :raises BufferError: When requesting a writable buffer, as buffers are read-only.
+        """
+
     @property
     def cached_value(self) -> str | tuple[int | float]:
         """
@@ -242,7 +333,7 @@ class ParameterArray(Parameter):
         """
         Sets the local cached value of the parameter.
 
-        :param value: New desired value. Assignments to other parameters, use their value instead, Otherwise uses .__str__().
+        :param value: New desired value. int and float values are converted directly (range checked), assignments to other parameters use their value instead, otherwise uses .__str__().
         """
 
     @property
@@ -257,7 +348,7 @@ class ParameterArray(Parameter):
         """
         Sets the remote value of the parameter.
 
-        :param value: New desired value. Assignments to other parameters, use their value instead, Otherwise uses .__str__().
+        :param value: New desired value. int and float values are converted directly (range checked), assignments to other parameters use their value instead, otherwise uses .__str__().
         """
 
 
@@ -346,21 +437,189 @@ class ParameterList(_pylist[Parameter | ParameterArray], _Iterable):
         :raises TypeError: When attempting to append a non-Parameter object.
         """
 
-    def pull(self, node: int = None, timeout: int = None, paramver: int = 2) -> None:
+    def pull(self, node: int | None = None, timeout: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None) -> None | dict[int, None | ConnectionError]:
         """
-        Pulls all Parameters in the list as a single request.
+        Pulls all Parameters in the list, split into as few packets as the MTU allows.
+        The serialized request is kept, and reused by later pulls until the list or arguments change.
+
+        :param node: Node to pull every Parameter from. When None, the Parameters are grouped by their own node
+            (local Parameters use pycsh.node()), and the nodes are pulled from concurrently.
+        :param retries: Number of attempts for each packet.
+        :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight().
+            Raised to the number of nodes when grouped.
+
+        :returns: None, or when grouped, a dict of {node: None | ConnectionError | PartialResponseError},
+            where the exceptions are returned rather than raised.
 
         :raises ConnectionError: When no response is received.
+        :raises PartialResponseError: When only some of the packets received a response.
+        """
+
+    def snapshot(self) -> dict[str, list[str] | memoryview | dict[str, memoryview]]:
+        """
+        Copies the cached values of every Parameter in the list into columnar buffers, in a single pass in C.
+
+        Returns a dict of the columns 'name' (list[str]), 'node', 'id', 'type', 'timestamp', 'offset' and 'count' (memoryviews),
+        and 'values': a dict of one contiguous memoryview per type name (i.e 'uint8' or 'float').
+        The values of row i are values[type_name][offset[i]:offset[i]+count[i]].
+        Timestamps are the local receive time (or remote timestamp) in seconds since the epoch, NaN when unknown.
+
+        The memoryviews may be passed to numpy.frombuffer(), pandas or polars without copying.
+        """
+
+    def poll(self, period: float = 0.1, node: int | None = None, on_update: _Callable[[ParameterList], None] = None, timeout: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None) -> Poller:
+        """
+        Pull the list every 'period' seconds from a background thread, until the returned Poller is stopped.
+        Polls are scheduled at absolute deadlines, so they don't drift with the time spent pulling.
+        The members of the list are serialized once, so later changes to the list are not polled.
+
+        :param period: Seconds between the start of each poll.
+        :param node: Node to pull every Parameter from. When None (the default, previously pycsh.node()),
+            the Parameters are grouped by their own node like .pull(), and the nodes are pulled from concurrently.
+        :param on_update: Called with the list after each pull where any packet got a response,
+            from the poller thread while holding the GIL. Polls with missing responses are counted in .stats['timeouts'].
+            Exceptions raised by it are printed, and don't stop the Poller.
+        :param retries: Number of attempts for each packet.
+        :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight().
+            Raised to the number of nodes when grouped.
+
+        :raises ValueError: When period is not positive.
+        :raises TypeError: When on_update is not callable.
         """
 
-    def push(self, node: int = None, timeout: int = None, hwid: int = None, paramver: int = 2) -> None:
+    def push(self, node: int | None = None, timeout: int = None, hwid: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None, only_changed: bool = False) -> None | dict[str, int] | dict[int, None | dict[str, int] | ConnectionError]:
         """
-        Pushes all Parameters in the list in a single packet.
+        Pushes all Parameters in the list, split into as few packets as the MTU allows.
+
+        :param node: Node to push every Parameter to. When None, the Parameters are grouped by their own node
+            (local Parameters use pycsh.node()), and the nodes are pushed to concurrently.
+        :param retries: Number of attempts for each packet.
+        :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight().
+            Raised to the number of nodes when grouped.
+        :param only_changed: Only push values that differ from their last known remote value,
+            i.e the value last pulled, pushed or sniffed. Arrays are compared (and pushed) per index.
+            Values that have never been seen remotely, and values pushed to another node than that of their Parameter
+            (including local Parameters), are always pushed.
+
+        :returns: None, or with only_changed, a dict of 'pushed_elements', 'skipped_elements' and 'skipped_bytes'.
+            When grouped, a dict of {node: result | ConnectionError | PartialResponseError} with the above result per node,
+            where the exceptions are returned rather than raised.
 
         :raises ConnectionError: When no response is received.
+        :raises PartialResponseError: When only some of the packets received a response.
+        """
+
+    def apull(self, node: int | None = None, timeout: int = None, paramver: int = 2, retries: int = 1, deadline: float = None) -> _Awaitable[None | dict[int, None | ConnectionError | TimeoutError]]:
+        """
+        Awaitable equivalent of .pull(), for use in coroutines.
+
+        :param node: Node to pull every Parameter from. When None (the default, previously pycsh.node()),
+            the Parameters are grouped by their own node like .pull().
+        :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+            including the time spent waiting for a worker, every packet and every retry.
+
+        :returns: None, or when grouped, a dict of {node: None | ConnectionError | PartialResponseError | TimeoutError},
+            where the exceptions are returned rather than raised.
+        :raises RuntimeError: When not called from a running event loop.
+        """
+
+    def apush(self, node: int | None = None, timeout: int = None, hwid: int = None, paramver: int = 2, retries: int = 1, deadline: float = None) -> _Awaitable[None | dict[int, None | ConnectionError | TimeoutError]]:
+        """
+        Awaitable equivalent of .push(), for use in coroutines.
+
+        :param node: Node to push every Parameter to. When None (the default, previously pycsh.node()),
+            the Parameters are grouped by their own node like .push().
+        :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+            including the time spent waiting for a worker, every packet and every retry.
+
+        :returns: None, or when grouped, a dict of {node: None | ConnectionError | PartialResponseError | TimeoutError},
+            where the exceptions are returned rather than raised.
+        :raises RuntimeError: When not called from a running event loop.
         """
 
 
+class Poller:
+    """
+    Periodically pulls a ParameterList, as returned by ParameterList.poll().
+    Every Poller is scheduled by a single shared thread, and due Pollers are pulled concurrently by a shared pool of workers,
+    which only take the GIL to deliver updates. Every Poller is stopped when the interpreter exits.
+    May be used as a context manager, which stops it on exit.
+    """
+
+    period: float  # Seconds between the start of each poll.
+    list: ParameterList  # The list being polled.
+    running: bool  # Whether the Poller has yet to be stopped.
+
+    @property
+    def stats(self) -> dict[str, int | float]:
+        """
+        Statistics of the Poller, with the keys:
+            polls: Number of polls performed.
+            rate: Achieved polls per second.
+            timeouts: Number of polls where one or more packets got no response.
+            overruns: Number of periods skipped, because the previous poll was still in progress.
+            jitter_p50_ms, jitter_p90_ms, jitter_p99_ms, jitter_max_ms: Percentiles of how late polls were started,
+                over the most recent 1024 polls.
+        """
+
+    def stop(self) -> None:
+        """ Stop polling, an ongoing pull is completed first. """
+
+    def __enter__(self) -> Poller: ...
+
+    def __exit__(self, exc_type, exc_value, traceback) -> bool: ...
+
+class ParameterListView:
+    """
+    Lazily materialized, read-only sequence of Parameters, as returned by pycsh.list(lazy=True).
+    Parameters are identified by node and ID, and only wrapped when accessed.
+
+    Unlike a ParameterList, it cannot be mutated.
+    pull(), push(), apull(), apush(), poll() and snapshot() behave as on a ParameterList,
+    which is materialized by the first of them and reused by the rest (keeping the serialized pull request).
+    It is not updated by later changes to the parameter list, use materialize() for a ParameterList of your own.
+    """
+
+    def __len__(self) -> int:
+        """ :returns: The number of parameters that matched the filter. """
+
+    def __getitem__(self, index: int) -> Parameter:
+        """
+        Wraps the parameter at the specified index.
+
+        :raises IndexError: When the index is out of range.
+        :raises ValueError: When the parameter has been removed from the list since the view was created.
+        """
+
+    def __iter__(self) -> _Iterable[Parameter]:
+        """ Wraps the parameters one at a time. """
+
+    def materialize(self) -> ParameterList:
+        """
+        Wraps every parameter in the view, in a new ParameterList.
+
+        :raises ValueError: When a parameter has been removed from the list since the view was created.
+        """
+
+    def pull(self, node: int | None = None, timeout: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None) -> None | dict[int, None | ConnectionError]:
+        """ ParameterList.pull() of the materialized view. """
+
+    def push(self, node: int | None = None, timeout: int = None, hwid: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None, only_changed: bool = False) -> None | dict[str, int] | dict[int, None | dict[str, int] | ConnectionError]:
+        """ ParameterList.push() of the materialized view. """
+
+    def apull(self, node: int | None = None, timeout: int = None, paramver: int = 2, retries: int = 1, deadline: float = None) -> _Awaitable[None | dict[int, None | ConnectionError | TimeoutError]]:
+        """ ParameterList.apull() of the materialized view. """
+
+    def apush(self, node: int | None = None, timeout: int = None, hwid: int = None, paramver: int = 2, retries: int = 1, deadline: float = None) -> _Awaitable[None | dict[int, None | ConnectionError | TimeoutError]]:
+        """ ParameterList.apush() of the materialized view. """
+
+    def poll(self, period: float = 0.1, node: int | None = None, on_update: _Callable[[ParameterList], None] = None, timeout: int = None, paramver: int = 2, retries: int = 1, max_in_flight: int = None) -> Poller:
+        """ ParameterList.poll() of the materialized view, on_update receives the materialized ParameterList. """
+
+    def snapshot(self) -> dict[str, list[str] | memoryview | dict[str, memoryview]]:
+        """ ParameterList.snapshot() of the materialized view. """
+
+
 class SlashCommand:
     """ Wrapper class for slash commands """
 
@@ -479,7 +738,7 @@ _param_ident_hint = int | str | Parameter  # Types accepted for finding a param_
 
 
 # Libparam commands
-def get(param_identifier: _param_ident_hint, node: int = None, server: int = None, paramver: int = 2, offset: int = None, timeout: int = None, retries: int = None) -> _param_value_hint | tuple[_param_value_hint]:
+def get(param_identifier: _param_ident_hint, node: int = None, server: int = None, paramver: int = 2, offset: int = None, timeout: int = None, retries: int = None, max_age: float = None) -> _param_value_hint | tuple[_param_value_hint]:
     """
     Get the value of a parameter.
 
@@ -490,6 +749,8 @@ def get(param_identifier: _param_ident_hint, node: int = None, server: int = Non
     :param offset: Index to use for array parameters.
     :param timeout: Timeout of pull transaction in milliseconds (Has no effect when autosend is 0).
     :param retries: Number of retries available for timeouts.
+    :param max_age: Use the cached value instead of pulling, when it was pulled or sniffed at most this many seconds ago.
+        Defaults to Parameter.max_age when param_identifier is a Parameter, otherwise always pulls. See cache_stats().
 
     :raises TypeError: When an invalid param_identifier type is provided.
     :raises ValueError: When a parameter could not be found.
@@ -498,12 +759,28 @@ def get(param_identifier: _param_ident_hint, node: int = None, server: int = Non
     :return: The value of the retrieved parameter (As its Python type).
     """
 
+def cache_stats(reset: bool = False) -> dict[str, int]:
+    """
+    Hit and miss counts of reads using max_age, i.e: {"hits": 10, "misses": 2}
+
+    :param reset: Reset the counts to 0, after returning them.
+    """
+
+def queue_stats(reset: bool = False) -> dict[str, int]:
+    """
+    Counts of the parameter request packets sent by split queues (i.e set() of arrays, get_many()/set_many(), ParameterList, Batch and Poller),
+    i.e: {"packets": 12, "bytes": 2100, "timeouts": 1}
+    Retries are counted as packets as well, "timeouts" counts the attempts that got no response.
+
+    :param reset: Reset the counts to 0, after returning them.
+    """
+
 def set(param_identifier: _param_ident_hint, value: _param_value_hint | _Iterable[int | float], node: int = None, server: int = None, paramver: int = 2, offset: int = None, timeout: int = None, retries: int = None, verbose: int = 2) -> None:
     """
     Set the value of a parameter.
 
     :param param_identifier: string name, int id or Parameter object of the desired parameter.
-    :param value: The new value of the parameter. .__str__() of the provided object will be used.
+    :param value: The new value of the parameter. int and float values are converted directly, otherwise .__str__() of the provided object will be used.
     :param node: node (default = <env>)
     :param server: server to get parameters from (default = node)
     :param paramver: parameter system version (default = 2)
@@ -513,9 +790,132 @@ def set(param_identifier: _param_ident_hint, value: _param_value_hint | _Iterabl
 
     :raises TypeError: When an invalid param_identifier type is provided.
     :raises ValueError: When a parameter could not be found.
+    :raises OverflowError: When an int value is outside the range of the parameter type.
     :raises RuntimeError: When called before .init().
     """
 
+class Batch:
+    """
+    Context manager returned by pycsh.batch(), which queues remote sets made by the current thread,
+    i.e: Parameter.remote_value assignments and pycsh.set(), instead of sending them.
+    On exit, the queued sets are pushed in as few packets as possible.
+    Local parameters are still set immediately.
+    """
+
+    errors: dict[Parameter, Exception]  # Parameters (and their exceptions) that failed during the last push.
+
+    def __enter__(self) -> Batch:
+        """
+        Make this the active batch of the current thread, batches may be nested.
+
+        :raises RuntimeError: When the batch is already active.
+        """
+
+    def __exit__(self, exc_type, exc_value, traceback) -> bool:
+        """
+        Push the queued sets, unless the block raised an exception, in which case they are discarded.
+
+        :raises RuntimeError: When the batch is not the innermost active batch of the current thread.
+        :raises ConnectionError: When no packets received a response.
+        :raises PartialResponseError: When only some packets received a response, see .errors for which parameters failed.
+        """
+
+    def __len__(self) -> int:
+        """ :returns: The number of queued values (each array index counts). """
+
+def batch(node: int = None, timeout: int = None, retries: int = 1, paramver: int = 2, hwid: int = 0, max_in_flight: int = None) -> Batch:
+    """
+    Create a Batch context manager, i.e:
+
+    with pycsh.batch(node=1, timeout=1000) as b:
+        param.remote_value = 5
+        pycsh.set("other_param", 10)
+
+    :param node: Destination of sets without a server (default = the node of the parameter).
+    :param timeout: Timeout of each packet in milliseconds (default = <env>)
+    :param retries: Number of retries available for each packet.
+    :param paramver: parameter system version (default = 2)
+    :param hwid: Hardware ID to include in the packets.
+    :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight().
+    """
+
+def aget(param_identifier: _param_ident_hint, node: int = None, server: int = None, paramver: int = 2, timeout: int = None, retries: int = None, deadline: float = None) -> _Awaitable[_param_value_hint | tuple[_param_value_hint]]:
+    """
+    Awaitable equivalent of get(), for use in coroutines.
+    Requests are performed by C worker threads, which resolve the future on its event loop.
+    Each worker performs one request at a time, so only async_workers() requests are sent at once,
+    the rest wait for a worker in the order they were awaited.
+
+    :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+        including the time spent waiting for a worker, every packet and every retry.
+
+    :raises TypeError: When an invalid param_identifier type is provided.
+    :raises ValueError: When a parameter could not be found.
+    :raises RuntimeError: When not called from a running event loop, or before .init().
+
+    :return: Future resolving to the value of the parameter, or raising ConnectionError/TimeoutError.
+        Cancelling it discards any request that is yet to be sent.
+    """
+
+def aset(param_identifier: _param_ident_hint, value: _param_value_hint | _Iterable[int | float], node: int = None, server: int = None, paramver: int = 2, timeout: int = None, retries: int = None, deadline: float = None) -> _Awaitable[None]:
+    """
+    Awaitable equivalent of set(), for use in coroutines.
+    The value is converted immediately, so conversion errors are raised by the call itself.
+
+    :param deadline: Seconds from now after which the request is abandoned with TimeoutError,
+        including the time spent waiting for a worker, every packet and every retry.
+
+    :raises TypeError: When an invalid param_identifier type is provided.
+    :raises ValueError: When a parameter could not be found.
+    :raises OverflowError: When an int value is outside the range of the parameter type.
+    :raises RuntimeError: When not called from a running event loop, or before .init().
+    """
+
+def get_many(identifiers: _Iterable[_param_ident_hint], node: int = None, server: int = None, paramver: int = 2, timeout: int = None, retries: int = None, verbose: int = None, max_in_flight: int = None) -> tuple[_param_value_hint | tuple[_param_value_hint] | Exception, ...]:
+    """
+    Get the values of multiple parameters.
+    Remote parameters are pulled with one queue per destination node, and the nodes are pulled concurrently.
+    Local parameters (node 0) are read directly.
+
+    :param identifiers: string names, int ids or Parameter objects of the desired parameters.
+    :param node: Node to pull every parameter from, None (default) pulls each parameter from its own node.
+        String names and int ids are looked up on this node, or on pycsh.node() when None.
+    :param server: server to get parameters from (default = node), as for get()
+    :param paramver: parameter system version (default = 2)
+    :param timeout: Timeout of pull transactions in milliseconds.
+    :param retries: Number of retries available for timeouts.
+    :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight(),
+        raised to the number of destination nodes.
+
+    :raises TypeError: When identifiers is not iterable.
+    :raises RuntimeError: When called before .init().
+
+    :return: The value of each parameter in the order of identifiers.
+        Parameters that could not be found or pulled have their exception (i.e ValueError or ConnectionError) in place of their value.
+    """
+
+def set_many(mapping: dict[_param_ident_hint, _param_value_hint | _Iterable[int | float]], node: int = None, server: int = None, paramver: int = 2, timeout: int = None, retries: int = None, verbose: int = -1, max_in_flight: int = None) -> dict[_param_ident_hint, Exception | None]:
+    """
+    Set the values of multiple parameters.
+    Remote parameters are pushed with one queue per destination node, and the nodes are pushed concurrently.
+    Local parameters are set immediately, in the order of the mapping.
+
+    :param mapping: New value for each string name, int id or Parameter object.
+    :param node: Node to push every parameter to, None (default) pushes each parameter to its own node.
+        String names and int ids are looked up on this node, or on pycsh.node() when None.
+    :param server: server to set parameters on (default = node), as for set()
+    :param paramver: parameter system version (default = 2)
+    :param timeout: Timeout of push transactions in milliseconds.
+    :param retries: Number of retries available for timeouts.
+    :param max_in_flight: Number of packets awaiting a response at once, defaults to pycsh.max_in_flight(),
+        raised to the number of destination nodes.
+
+    :raises TypeError: When mapping is not a mapping.
+    :raises RuntimeError: When called before .init().
+
+    :return: None for each successfully set parameter, otherwise the exception that prevented it (i.e ValueError, OverflowError or ConnectionError).
+    """
+
 def push(node: int, timeout: int = None, hwid: int = None, retries: int = None) -> None:
     """
     Push the current queue.
@@ -572,14 +972,75 @@ def verbose(verbose: int = None) -> int:
     :return: The current default timeout.
     """
 
+def max_in_flight(max_in_flight: int = None) -> int:
+    """
+    Used to get or change the default number of packets awaiting a response at once,
+    when array or ParameterList requests are too large for a single packet.
+
+    :param max_in_flight: Integer between 1 and 16 to change the default to (initial value = 4).
+    :return: The current default max in flight.
+
+    :raises ValueError: When outside the allowed range.
+    """
+
+def async_workers(workers: int = None) -> int:
+    """
+    Used to get or change the maximum number of C worker threads performing awaitable requests,
+    i.e Parameter.aget()/aset() and ParameterList.apull()/apush(), independent of max_in_flight().
+    Each worker blocks on a single request, so this is the number of awaitable requests in flight at once,
+    the rest wait for a worker in the order they were awaited.
+    Workers are started when every running worker is busy, and stopped when the limit is lowered.
+
+    :param workers: Integer between 1 and 1024 to change the limit to (initial value = 64).
+    :return: The current limit.
+
+    :raises ValueError: When outside the allowed range.
+    """
+
+def coalesce(window_ms: float = None) -> float:
+    """
+    Used to get or change the window for coalescing single parameter requests into shared packets (initial value = 0, disabled).
+    When enabled, get(), set() and Parameter.remote_value requests for the same node from any thread are queued,
+    and sent as a single packet once it is full, or the window since its first request has elapsed.
+    Every caller blocks until the shared packet got a response (or timed out).
+
+    :param window_ms: Window in milliseconds between 0 and 1000, 0 disables coalescing.
+    :return: The current window in milliseconds.
+
+    :raises ValueError: When outside the allowed range.
+    """
+
+def sniffer_cache(enable: bool = None) -> bool:
+    """
+    Used to get or change whether the parameter sniffer writes the sniffed values of remote parameters
+    to their cached value (initial value = False).
+    When enabled, sniffed parameters count as received (at our local receive time) for max_age reads.
+
+    :param enable: Whether to write sniffed values to the cached values.
+    :return: Whether sniffed values are written to the cached values.
+    """
+
+def history_limit(limit: int = None) -> int:
+    """
+    Used to get or change the limit on the total memory (in bytes) used by parameter histories, see Parameter.history_size.
+    The limit is only checked when a history is enabled or resized (initial value = 64 MiB).
+
+    :param limit: Number of bytes to change the limit to.
+    :return: The current limit.
+    """
+
 def cmd() -> None:
     """ Print the current command. """
 
-def list(node: int = None, verbose: int = None, mask: str | int = None, globstr: str = None) -> ParameterList:
+def list(node: int = None, verbose: int = -1, mask: str | int = None, globstr: str = None, lazy: bool = False) -> ParameterList | ParameterListView:
     """
     List all known parameters, remote and local alike.
 
+    :param verbose: Verbosity to print the list with, nothing is printed when < 0 (default).
     :param mask: Mask on which to filter the list.
+    :param lazy: Return a ParameterListView, which only wraps Parameters as they are accessed.
+        Useful for filters matching very large parts of the list.
+        The view is read-only, its pull(), push() and such materialize it into a ParameterList on the first call.
     """
 
 def list_download(node: int = None, timeout: int = None, version: int = None) -> ParameterList:
@@ -0,0 +1,374 @@
+/*
+ * async_request.c
+ *
+ * Awaitable parameter requests.
+ * Requests are performed by C worker threads, which resolve asyncio futures using loop.call_soon_threadsafe(),
+ * so no Python threads are needed, regardless of how many requests are awaited.
+ * Each worker is blocked by its request, see async_request.h for the limits that follow.
+ * Workers are started on demand, when every running worker is busy.
+ *
+ */
+
+#include "async_request.h"
+
+#include <pthread.h>
+
+#include "pycsh.h"
+#include "utils.h"
+
+#define PYCSH_ASYNC_CAPSULE_NAME "pycsh.async_request"
+
+/* Pending requests, in the order they were submitted */
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static pycsh_async_request_t * pending_head = NULL;
+static pycsh_async_request_t * pending_tail = NULL;
+static unsigned int pending_count = 0;
+
+/* Worker pool, also protected by pending_mutex */
+static unsigned int workers_limit = PYCSH_ASYNC_WORKERS_DEFAULT;
+static unsigned int workers_running = 0;
+static unsigned int workers_idle = 0;
+
+pycsh_async_request_t * pycsh_async_request_new(param_queue_type_e type, param_t * param, int paramver, int timeout, int retries, double deadline) {
+
+	pycsh_async_request_t * request = calloc(1, sizeof(pycsh_async_request_t));
+	if (request == NULL) {
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	pycsh_segmented_queue_init(&request->queue, type, paramver);
+	/* Requests may wait in the pending list, so don't make other callers wait for them. */
+	request->queue.single_flight = 0;
+	request->param = param;
+	request->paramver = paramver;
+	request->timeout = timeout;
+	request->retries = retries;
+	request->deadline_ns = deadline > 0 ? pycsh_segmented_queue_now_ns() + (uint64_t)(deadline * 1E9) : 0;
+	request->queue.deadline_ns = request->deadline_ns;
+	atomic_init(&request->cancelled, 0);
+
+	return request;
+}
+
+void pycsh_async_request_free(pycsh_async_request_t * request) {
+	if (request == NULL) {
+		return;
+	}
+	pycsh_segmented_queue_free(&request->queue);
+	Py_XDECREF(request->loop);
+	Py_XDECREF(request->future);
+	free(request);
+}
+
+static void pycsh_async_capsule_destructor(PyObject * capsule) {
+	pycsh_async_request_free(PyCapsule_GetPointer(capsule, PYCSH_ASYNC_CAPSULE_NAME));
+}
+
+/* Builds the result of a performed request, must be called with the GIL.
+   Returns a new reference to the value, or NULL with the exception set. */
+static PyObject * pycsh_async_request_result(pycsh_async_request_t * request) {
+
+	static const char deadline_msg[] = "Deadline expired before every response was received.";
+
+	if (request->grouped) {
+		return pycsh_util_segmented_queue_results(&request->queue, request->timeout, request->retries,
+			request->expired ? PyExc_TimeoutError : NULL, deadline_msg);
+	}
+
+	if (request->expired) {
+		PyErr_SetString(PyExc_TimeoutError, deadline_msg);
+		return NULL;
+	}
+
+	if (pycsh_util_segmented_queue_raise(&request->queue, request->failed, request->timeout, request->retries) < 0) {
+		return NULL;
+	}
+
+	param_t * param = request->param;
+	if (param == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	if (param->array_size > 1 && param->type != PARAM_TYPE_STRING)
+		return _pycsh_util_get_array(param, 0, INT_MIN, request->timeout, request->retries, request->paramver, -1);
+	return _pycsh_util_get_single(param, INT_MIN, 0, INT_MIN, request->timeout, request->retries, request->paramver, -1);
+}
+
+/* Scheduled on the event loop by call_soon_threadsafe(), args: (future, value, is_exception) */
+static PyObject * pycsh_async_resolve(PyObject * self, PyObject * args) {
+
+	PyObject * future;
+	PyObject * value;
+	int is_exception;
+
+	if (!PyArg_ParseTuple(args, "OOp", &future, &value, &is_exception)) {
+		return NULL;
+	}
+
+	/* The future may have been cancelled while the request was in flight. */
+	PyObject * done AUTO_DECREF = PyObject_CallMethod(future, "done", NULL);
+	if (done == NULL) {
+		return NULL;
+	}
+	if (PyObject_IsTrue(done)) {
+		Py_RETURN_NONE;
+	}
+
+	return PyObject_CallMethod(future, is_exception ? "set_exception" : "set_result", "O", value);
+}
+
+static PyMethodDef pycsh_async_resolve_def = {"_pycsh_async_resolve", pycsh_async_resolve, METH_VARARGS, NULL};
+
+/* Added as done-callback to the future, 'self' is the capsule of the request. */
+static PyObject * pycsh_async_done_callback(PyObject * self, PyObject * future) {
+
+	PyObject * cancelled AUTO_DECREF = PyObject_CallMethod(future, "cancelled", NULL);
+	if (cancelled == NULL) {
+		return NULL;
+	}
+
+	if (PyObject_IsTrue(cancelled)) {
+		pycsh_async_request_t * request = PyCapsule_GetPointer(self, PYCSH_ASYNC_CAPSULE_NAME);
+		atomic_store(&request->cancelled, 1);  // Workers skip requests that are yet to be sent.
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef pycsh_async_done_callback_def = {"_pycsh_async_done_callback", pycsh_async_done_callback, METH_O, NULL};
+
+/* Hands the result of the request to its event loop. Must be called with the GIL. */
+static void pycsh_async_request_complete(pycsh_async_request_t * request) {
+
+	PyObject * value AUTO_DECREF = pycsh_async_request_result(request);
+	int is_exception = (value == NULL);
+	if (is_exception) {
+		PyObject *type, *traceback;
+		PyErr_Fetch(&type, &value, &traceback);
+		PyErr_NormalizeException(&type, &value, &traceback);
+		Py_XDECREF(type);
+		Py_XDECREF(traceback);
+	}
+
+	PyObject * resolve AUTO_DECREF = PyCFunction_New(&pycsh_async_resolve_def, NULL);
+	if (resolve == NULL) {
+		PyErr_Clear();
+		return;
+	}
+
+	PyObject * res AUTO_DECREF = PyObject_CallMethod(request->loop, "call_soon_threadsafe", "OOOi", resolve, request->future, value, is_exception);
+	if (res == NULL) {
+		PyErr_Clear();  // Most likely because the loop has been closed, nobody is waiting for the result anyway.
+	}
+}
+
+static void * pycsh_async_worker(void * arg) {
+
+	while (1) {
+
+		pthread_mutex_lock(&pending_mutex);
+		while (pending_head == NULL && workers_running <= workers_limit) {
+			workers_idle++;
+			pthread_cond_wait(&pending_cond, &pending_mutex);
+			workers_idle--;
+		}
+		/* The limit has been lowered, the remaining workers take over any pending requests. */
+		if (workers_running > workers_limit) {
+			workers_running--;
+			pthread_mutex_unlock(&pending_mutex);
+			return NULL;
+		}
+		pycsh_async_request_t * request = pending_head;
+		pending_head = request->next;
+		if (pending_head == NULL) {
+			pending_tail = NULL;
+		}
+		pending_count--;
+		pthread_mutex_unlock(&pending_mutex);
+
+		if (atomic_load(&request->cancelled)) {
+			request->failed = 0;  // Not sent, the result is discarded regardless.
+		} else {
+			/* Each worker is a request in flight, so segments are sent one at a time,
+				except that the nodes of a grouped request are waited for concurrently.
+				The queue stops at the deadline, also when it expired while waiting for a worker. */
+			unsigned int max_in_flight = request->grouped ? pycsh_segmented_queue_host_count(&request->queue) : 1;
+			request->failed = pycsh_segmented_queue_run(&request->queue, request->timeout, request->retries, max_in_flight, request->hwid);
+			request->expired = request->failed > 0 && request->deadline_ns && pycsh_segmented_queue_now_ns() >= request->deadline_ns;
+		}
+
+		/* Nobody is awaiting the result once the interpreter is shutting down,
+			and taking the GIL then would hang the worker, so the request is leaked. */
+		if (_Py_IsFinalizing()) {
+			pthread_mutex_lock(&pending_mutex);
+			workers_running--;
+			pthread_mutex_unlock(&pending_mutex);
+			return NULL;
+		}
+
+		PyGILState_STATE gstate = PyGILState_Ensure();
+		if (!atomic_load(&request->cancelled)) {
+			pycsh_async_request_complete(request);
+		}
+		Py_DECREF(request->capsule);  // Reference held by the pending list.
+		PyGILState_Release(gstate);
+	}
+
+	return NULL;
+}
+
+/* Starts another worker when every running worker is busy, pending_mutex must be held.
+	Returns -1 when no worker is running at all. */
+static int pycsh_async_start_worker(void) {
+
+	if (pending_count <= workers_idle || workers_running >= workers_limit) {
+		return 0;
+	}
+
+	pthread_t worker;
+	if (pthread_create(&worker, NULL, pycsh_async_worker, NULL) != 0) {
+		/* The running workers will get to the request eventually. */
+		return workers_running > 0 ? 0 : -1;
+	}
+	pthread_detach(worker);
+	workers_running++;
+	return 0;
+}
+
+unsigned int pycsh_async_get_workers(void) {
+	pthread_mutex_lock(&pending_mutex);
+	unsigned int limit = workers_limit;
+	pthread_mutex_unlock(&pending_mutex);
+	return limit;
+}
+
+void pycsh_async_set_workers(unsigned int limit) {
+	pthread_mutex_lock(&pending_mutex);
+	workers_limit = limit;
+	/* Requests already waiting for a worker may be taken by the new ones. */
+	unsigned int waiting = pending_count > workers_idle ? pending_count - workers_idle : 0;
+	for (unsigned int i = 0; i < waiting && workers_running < workers_limit; i++) {
+		pycsh_async_start_worker();
+	}
+	pthread_cond_broadcast(&pending_cond);  // Surplus idle workers exit.
+	pthread_mutex_unlock(&pending_mutex);
+}
+
+PyObject * pycsh_async_request_submit(pycsh_async_request_t * request) {
+
+	/* The capsule owns the request from here on. */
+	PyObject * capsule AUTO_DECREF = PyCapsule_New(request, PYCSH_ASYNC_CAPSULE_NAME, pycsh_async_capsule_destructor);
+	if (capsule == NULL) {
+		pycsh_async_request_free(request);
+		return NULL;
+	}
+	request->capsule = capsule;
+
+	PyObject * asyncio AUTO_DECREF = PyImport_ImportModule("asyncio");
+	if (asyncio == NULL) {
+		return NULL;
+	}
+
+	request->loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+	if (request->loop == NULL) {
+		return NULL;  // Raises RuntimeError when not called from a coroutine.
+	}
+
+	request->future = PyObject_CallMethod(request->loop, "create_future", NULL);
+	if (request->future == NULL) {
+		return NULL;
+	}
+
+	/* Local parameters don't need the network, and may have Python callbacks. */
+	if (request->queue.segment_count == 0) {
+		pycsh_async_request_complete(request);
+		return Py_NewRef(request->future);
+	}
+
+	PyObject * done_callback AUTO_DECREF = PyCFunction_New(&pycsh_async_done_callback_def, capsule);
+	if (done_callback == NULL) {
+		return NULL;
+	}
+	PyObject * res AUTO_DECREF = PyObject_CallMethod(request->future, "add_done_callback", "O", done_callback);
+	if (res == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&pending_mutex);
+	pending_count++;  // Counted before starting a worker, which is only done when the idle ones can't take it.
+	if (pycsh_async_start_worker() < 0) {
+		pending_count--;
+		pthread_mutex_unlock(&pending_mutex);
+		PyErr_SetString(PyExc_RuntimeError, "Failed to start worker thread for awaitable requests.");
+		return NULL;
+	}
+	Py_INCREF(capsule);  // Released by the worker once completed.
+	request->next = NULL;
+	if (pending_tail) {
+		pending_tail->next = request;
+	} else {
+		pending_head = request;
+	}
+	pending_tail = request;
+	pthread_cond_signal(&pending_cond);
+	pthread_mutex_unlock(&pending_mutex);
+
+	return Py_NewRef(request->future);
+}
+
+PyObject * pycsh_async_get(param_t * param, int host, int timeout, int retries, int paramver, double deadline) {
+
+	pycsh_async_request_t * request = pycsh_async_request_new(PARAM_QUEUE_TYPE_GET, param, paramver, timeout, retries, deadline);
+	if (request == NULL) {
+		return NULL;
+	}
+
+	int dest = (host != INT_MIN ? host : param->node);
+	if (dest != 0 && pycsh_util_segmented_queue_add(&request->queue, param, -1, NULL, dest) < 0) {
+		pycsh_async_request_free(request);
+		return NULL;
+	}
+
+	return pycsh_async_request_submit(request);
+}
+
+PyObject * pycsh_async_set(param_t * param, PyObject * value, int host, int timeout, int retries, int paramver, double deadline) {
+
+	pycsh_async_request_t * request = pycsh_async_request_new(PARAM_QUEUE_TYPE_SET, NULL, paramver, timeout, retries, deadline);
+	if (request == NULL) {
+		return NULL;
+	}
+
+	int dest = (host != INT_MIN ? host : param->node);
+	if (dest == 0) {
+		int res = ((PyIter_Check(value) || PySequence_Check(value)) && !PyUnicode_Check(value)) ?
+			_pycsh_util_set_array(param, value, dest, timeout, retries, paramver, -1) :
+			_pycsh_util_set_single(param, value, INT_MIN, dest, timeout, retries, paramver, 1, -1);
+		if (res != 0) {
+			pycsh_async_request_free(request);
+			return NULL;
+		}
+	} else if (pycsh_util_segmented_queue_add_value(&request->queue, param, value, dest) < 0) {
+		pycsh_async_request_free(request);
+		return NULL;
+	}
+
+	return pycsh_async_request_submit(request);
+}
+
+int pycsh_async_deadline_converter(PyObject * obj, double * deadline) {
+
+	if (obj == Py_None) {
+		*deadline = 0;
+		return 1;
+	}
+
+	*deadline = PyFloat_AsDouble(obj);
+	if (*deadline == -1.0 && PyErr_Occurred()) {
+		return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,101 @@
+/*
+ * async_request.h
+ *
+ * Awaitable parameter requests.
+ * Requests are performed by C worker threads, which resolve asyncio futures using loop.call_soon_threadsafe(),
+ * so no Python threads are needed, regardless of how many requests are awaited.
+ * The workers block on their request, so the size of the pool (pycsh.async_workers(), independent of pycsh.max_in_flight())
+ * is the number of requests in flight at once, the rest wait in the order they were submitted.
+ * A deadline bounds the whole request, including the time spent waiting for a worker, every segment and every retry.
+ *
+ */
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "segmented_queue.h"
+
+#define PYCSH_ASYNC_WORKERS_DEFAULT 64
+#define PYCSH_ASYNC_WORKERS_LIMIT 1024
+
+typedef struct pycsh_async_request_s pycsh_async_request_t;
+
+struct pycsh_async_request_s {
+	pycsh_segmented_queue_t queue;
+
+	int timeout;
+	int retries;
+	uint32_t hwid;
+	uint64_t deadline_ns;  // CLOCK_MONOTONIC (see pycsh_segmented_queue_now_ns()), 0 for no deadline
+
+	/* Parameter whose value the future should resolve to, NULL resolves to None */
+	param_t * param;
+	/* Resolve to a dict of {host: None | exception} rather than raising, see pycsh_util_segmented_queue_run_grouped() */
+	int grouped;
+	int paramver;
+
+	atomic_int cancelled;
+	int failed;  // Number of failed segments
+	int expired;  // Whether the deadline expired before every segment got a response
+
+	PyObject * loop;
+	PyObject * future;
+	PyObject * capsule;  // Owns this request, borrowed reference
+
+	pycsh_async_request_t * next;
+};
+
+/**
+ * @brief Allocate a new request, whose .queue should be filled before calling pycsh_async_request_submit().
+ *
+ * @param param Parameter to resolve the future with the value of, or NULL for None.
+ * @param deadline Seconds from now to give up on the request (whether sent or not), <= 0 for no deadline.
+ * @return pycsh_async_request_t* or NULL with MemoryError set.
+ */
+pycsh_async_request_t * pycsh_async_request_new(param_queue_type_e type, param_t * param, int paramver, int timeout, int retries, double deadline);
+
+/* Free a request that was never submitted, i.e because filling its queue failed. */
+void pycsh_async_request_free(pycsh_async_request_t * request);
+
+/**
+ * @brief Hands the request to the worker threads, and returns an asyncio future of its result.
+ *
+ * Must be called from a coroutine (running event loop) while holding the GIL.
+ * The request is freed by this function, also on failure.
+ *
+ * @return PyObject* New reference to an asyncio.Future, or NULL with an exception set.
+ */
+PyObject * pycsh_async_request_submit(pycsh_async_request_t * request);
+
+/**
+ * @brief Awaitable equivalent of pulling the remote value of the parameter.
+ *
+ * @param host INT_MIN for the node of the parameter.
+ * @return PyObject* New reference to an asyncio.Future resolving to the value.
+ */
+PyObject * pycsh_async_get(param_t * param, int host, int timeout, int retries, int paramver, double deadline);
+
+/**
+ * @brief Awaitable equivalent of pushing a new remote value for the parameter.
+ *
+ * Conversion errors are raised immediately, rather than through the future.
+ * Local parameters are set immediately, as they may have Python callbacks.
+ *
+ * @param host INT_MIN for the node of the parameter.
+ * @return PyObject* New reference to an asyncio.Future resolving to None.
+ */
+PyObject * pycsh_async_set(param_t * param, PyObject * value, int host, int timeout, int retries, int paramver, double deadline);
+
+/* Maximum number of worker threads, i.e awaitable requests in flight at once. */
+unsigned int pycsh_async_get_workers(void);
+
+/* Lowering the limit stops surplus workers once they are done with their current request. */
+void pycsh_async_set_workers(unsigned int limit);
+
+/* PyArg_Parse*() "O&" converter for deadline arguments, accepts None or seconds as float/int. */
+int pycsh_async_deadline_converter(PyObject * obj, double * deadline);
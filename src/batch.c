@@ -0,0 +1,234 @@
+/*
+ * batch.c
+ *
+ * Contains the Batch context manager,
+ * which queues remote sets made by the current thread, and pushes them in as few packets as possible on exit.
+ *
+ */
+
+#include "batch.h"
+
+#include "pycsh.h"
+#include "utils.h"
+#include "parameter/parameter.h"
+
+/* Batches are per thread, so sets from other threads are unaffected. */
+static _Thread_local BatchObject * active_batch = NULL;
+
+BatchObject * pycsh_batch_active(void) {
+	return active_batch;
+}
+
+static int pycsh_batch_dest(BatchObject * batch, param_t * param, int host) {
+	if (host != INT_MIN)
+		return host;
+	if (batch->node != INT_MIN)
+		return batch->node;
+	return param->node;
+}
+
+int pycsh_batch_add(param_t * param, int offset, void * value, int host) {
+
+	BatchObject * batch = active_batch;
+	if (batch == NULL) {
+		return 0;
+	}
+
+	if (pycsh_util_segmented_queue_add(&batch->queue, param, offset, value, pycsh_batch_dest(batch, param, host)) < 0) {
+		return -1;  // Raises ValueError or MemoryError
+	}
+	return 1;
+}
+
+int pycsh_batch_add_value(param_t * param, PyObject * value, int host) {
+
+	BatchObject * batch = active_batch;
+	if (batch == NULL) {
+		return 0;
+	}
+
+	if (pycsh_util_segmented_queue_add_value(&batch->queue, param, value, pycsh_batch_dest(batch, param, host)) < 0) {
+		return -1;
+	}
+	return 1;
+}
+
+/* Pushes the queued sets, recording failures in self->errors. */
+static int Batch_push(BatchObject *self) {
+
+	PyObject * errors = PyDict_New();
+	if (errors == NULL) {
+		return -1;
+	}
+	Py_XSETREF(self->errors, errors);
+
+	if (self->queue.item_count == 0) {
+		return 0;
+	}
+
+	int failed;
+	Py_BEGIN_ALLOW_THREADS;
+	failed = pycsh_segmented_queue_run(&self->queue, self->timeout, self->retries, self->max_in_flight, self->hwid);
+	Py_END_ALLOW_THREADS;
+
+	if (failed == 0) {
+		return 0;
+	}
+
+	param_t * last_param = NULL;
+	for (size_t i = 0; i < self->queue.item_count; i++) {
+		pycsh_segment_item_t * item = &self->queue.items[i];
+		if (!pycsh_segmented_queue_item_failed(&self->queue, i) || item->param == last_param) {
+			continue;  // Array indexes of the same parameter are consecutive.
+		}
+		last_param = item->param;
+
+		PyObject * key AUTO_DECREF = _pycsh_Parameter_from_param(&ParameterType, item->param, NULL, item->host, self->timeout, self->retries, self->queue.version);
+		PyObject * exc AUTO_DECREF = PyObject_CallFunction(PyExc_ConnectionError, "s", "No response.");
+		if (key == NULL || exc == NULL || PyDict_SetItem(errors, key, exc) < 0) {
+			return -1;
+		}
+	}
+
+	return pycsh_util_segmented_queue_raise(&self->queue, failed, self->timeout, self->retries);
+}
+
+static PyObject * Batch_enter(BatchObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	if (self->entered) {
+		PyErr_SetString(PyExc_RuntimeError, "Batch is already active");
+		return NULL;
+	}
+
+	self->entered = 1;
+	self->outer = active_batch;
+	Py_INCREF(self);
+	active_batch = self;  // Released by __exit__(), so the active batch outlives its last other reference.
+
+	return Py_NewRef(self);
+}
+
+static PyObject * Batch_exit(BatchObject *self, PyObject *args) {
+
+	PyObject * exc_type, * exc_value, * traceback;
+
+	if (!PyArg_ParseTuple(args, "OOO", &exc_type, &exc_value, &traceback))
+		return NULL;  // TypeError is thrown
+
+	if (!self->entered) {
+		PyErr_SetString(PyExc_RuntimeError, "Batch is not active");
+		return NULL;
+	}
+
+	/* Batches must be exited in the reverse order of entering (on the same thread), so the outer batch becomes active again. */
+	if (active_batch != self) {
+		PyErr_SetString(PyExc_RuntimeError, "Batch is not the innermost active batch of this thread");
+		return NULL;
+	}
+	active_batch = self->outer;
+	self->outer = NULL;
+	self->entered = 0;
+
+	/* Don't push a partial configuration when the block raised. */
+	int res = 0;
+	if (exc_type == Py_None) {
+		if (!csp_initialized()) {
+			PyErr_SetString(PyExc_RuntimeError, "Cannot perform operations before .init() has been called.");
+			res = -1;
+		} else {
+			res = Batch_push(self);
+		}
+	}
+
+	pycsh_segmented_queue_free(&self->queue);
+
+	Py_DECREF(self);  // Reference of active_batch, our caller still holds one.
+
+	if (res < 0) {
+		return NULL;
+	}
+	Py_RETURN_FALSE;
+}
+
+static PyObject * Batch_get_errors(BatchObject *self, void *closure) {
+	if (self->errors == NULL) {
+		return PyDict_New();
+	}
+	return Py_NewRef(self->errors);
+}
+
+static Py_ssize_t Batch_length(BatchObject *self) {
+	return self->queue.item_count;
+}
+
+static PyObject * Batch_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+
+	int node = INT_MIN;
+	int timeout = pycsh_dfl_timeout;
+	int retries = 1;
+	int paramver = 2;
+	uint32_t hwid = 0;
+	int max_in_flight = pycsh_dfl_max_in_flight;
+
+	static char *kwlist[] = {"node", "timeout", "retries", "paramver", "hwid", "max_in_flight", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iiiiIi", kwlist, &node, &timeout, &retries, &paramver, &hwid, &max_in_flight))
+		return NULL;  // TypeError is thrown
+
+	BatchObject * self = (BatchObject *)type->tp_alloc(type, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	pycsh_segmented_queue_init(&self->queue, PARAM_QUEUE_TYPE_SET, paramver);
+	self->node = node;
+	self->timeout = timeout;
+	self->retries = retries;
+	self->hwid = hwid;
+	self->max_in_flight = max_in_flight;
+
+	return (PyObject *)self;
+}
+
+static void Batch_dealloc(BatchObject *self) {
+	/* An entered batch holds a reference to itself until exited, so it can't be active here. */
+	pycsh_segmented_queue_free(&self->queue);
+	Py_XDECREF(self->errors);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+PyObject * pycsh_batch(PyObject * self, PyObject * args, PyObject * kwds) {
+	return PyObject_Call((PyObject *)&BatchType, args, kwds);
+}
+
+static PyMethodDef Batch_methods[] = {
+	{"__enter__", (PyCFunction)Batch_enter, METH_NOARGS,
+     PyDoc_STR("Queue remote sets made by the current thread in this batch.")},
+	{"__exit__", (PyCFunction)Batch_exit, METH_VARARGS,
+     PyDoc_STR("Push the queued sets, unless the block raised an exception.")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Batch_getsetters[] = {
+	{"errors", (getter)Batch_get_errors, NULL,
+     "dict of the Parameters (and their exceptions) that failed during the last push", NULL},
+    {NULL, NULL, NULL, NULL}  /* Sentinel */
+};
+
+static PySequenceMethods Batch_as_sequence = {
+	.sq_length = (lenfunc)Batch_length,
+};
+
+PyTypeObject BatchType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "pycsh.Batch",
+	.tp_doc = "Context manager which queues remote sets, and pushes them in as few packets as possible on exit.",
+	.tp_basicsize = sizeof(BatchObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_new = Batch_new,
+	.tp_dealloc = (destructor)Batch_dealloc,
+	.tp_methods = Batch_methods,
+	.tp_getset = Batch_getsetters,
+	.tp_as_sequence = &Batch_as_sequence,
+};
@@ -0,0 +1,51 @@
+/*
+ * batch.h
+ *
+ * Contains the Batch context manager,
+ * which queues remote sets made by the current thread, and pushes them in as few packets as possible on exit.
+ *
+ */
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <param/param.h>
+
+#include "segmented_queue.h"
+
+typedef struct BatchObject {
+	PyObject_HEAD
+
+	pycsh_segmented_queue_t queue;
+
+	int node;  // Destination of parameters without a host, INT_MIN for their own node.
+	int timeout;
+	int retries;
+	int max_in_flight;
+	uint32_t hwid;
+
+	PyObject * errors;  // dict[Parameter, Exception] of the last push.
+	struct BatchObject * outer;  // Batch that was active when we were entered.
+	int entered;
+} BatchObject;
+
+extern PyTypeObject BatchType;
+
+/* Innermost batch entered by the current thread, or NULL. */
+BatchObject * pycsh_batch_active(void);
+
+/**
+ * @brief Queue a remote set in the active batch of the current thread, if any.
+ *
+ * @param host Host of the set, INT_MIN for the node of the batch (or parameter).
+ * @return int 1 when queued, 0 when no batch is active, <0 with an exception set on failure.
+ */
+int pycsh_batch_add(param_t * param, int offset, void * value, int host);
+
+/* Like pycsh_batch_add(), but converts a Python value (or sequence of values for arrays) first. */
+int pycsh_batch_add_value(param_t * param, PyObject * value, int host);
+
+/* pycsh.batch(), creates a new BatchObject. */
+PyObject * pycsh_batch(PyObject * self, PyObject * args, PyObject * kwds);
@@ -0,0 +1,14 @@
+/*
+ * cleanup.h
+ *
+ * __attribute__((cleanup)) helpers without any Python API,
+ * so they may also be used by the CSH sources.
+ */
+
+#pragma once
+
+void cleanup_str(char ** obj);
+void cleanup_free(void ** obj);
+
+#define CLEANUP_STR __attribute__((cleanup(cleanup_str)))
+#define CLEANUP_FREE __attribute__((cleanup(cleanup_free)))
@@ -0,0 +1,175 @@
+/*
+ * coalescer.c
+ *
+ * Opt-in scheduler that coalesces single parameter requests from any thread into shared packets.
+ *
+ */
+
+#include "coalescer.h"
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <csp/csp.h>
+#include <param/param_client.h>
+#include <param/param_server.h>
+
+typedef struct coalescer_batch_s {
+	param_queue_type_e type;
+	int version;
+	int host;
+	int timeout;
+
+	int sealed;  // No more requests may be added, the owner sends it as soon as it notices.
+	int done;
+	int result;
+	int refs;  // Submitters yet to read the result.
+
+	param_queue_t queue;
+	char buffer[PARAM_SERVER_MTU] __attribute__((aligned(16)));
+
+	struct coalescer_batch_s * next;  // In the open list
+} coalescer_batch_t;
+
+static atomic_uint coalescer_window_us = 0;
+
+/* Batches that may still be added to, protected by coalescer_lock. */
+static coalescer_batch_t * open_batches = NULL;
+static pthread_mutex_t coalescer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t coalescer_cond;
+static pthread_once_t coalescer_cond_once = PTHREAD_ONCE_INIT;
+
+/* Windows are timed on CLOCK_MONOTONIC, so steps of the wall clock don't stretch or collapse them. */
+static void coalescer_cond_init(void) {
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&coalescer_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+unsigned int pycsh_coalescer_get_window(void) {
+	return atomic_load(&coalescer_window_us);
+}
+
+void pycsh_coalescer_set_window(unsigned int window_us) {
+	atomic_store(&coalescer_window_us, window_us);
+}
+
+/* Must be called with coalescer_lock held. */
+static void coalescer_seal(coalescer_batch_t * batch) {
+
+	if (batch->sealed) {
+		return;
+	}
+	batch->sealed = 1;
+
+	for (coalescer_batch_t ** link = &open_batches; *link != NULL; link = &(*link)->next) {
+		if (*link == batch) {
+			*link = batch->next;
+			break;
+		}
+	}
+
+	pthread_cond_broadcast(&coalescer_cond);
+}
+
+static coalescer_batch_t * coalescer_new_batch(param_queue_type_e type, int version, int host) {
+
+	coalescer_batch_t * batch = calloc(1, sizeof(coalescer_batch_t));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->type = type;
+	batch->version = version;
+	batch->host = host;
+	param_queue_init(&batch->queue, batch->buffer, PARAM_SERVER_MTU, 0, type, version);
+
+	batch->next = open_batches;
+	open_batches = batch;
+	return batch;
+}
+
+static int coalescer_send(coalescer_batch_t * batch) {
+	if (batch->type == PARAM_QUEUE_TYPE_GET) {
+		return param_pull_queue(&batch->queue, CSP_PRIO_NORM, 0, batch->host, batch->timeout);
+	}
+	int result = param_push_queue(&batch->queue, 0, batch->host, batch->timeout, 0, false);
+	return result < 0 ? result : 0;  // param_push_queue() only uses negative numbers for errors.
+}
+
+int pycsh_coalescer_submit(param_queue_type_e type, param_t * param, int offset, void * value, int host, int timeout, int version) {
+
+	pthread_once(&coalescer_cond_once, coalescer_cond_init);
+	pthread_mutex_lock(&coalescer_lock);
+
+	coalescer_batch_t * batch = NULL;
+	for (coalescer_batch_t * open = open_batches; open != NULL; open = open->next) {
+		if (open->type == type && open->version == version && open->host == host) {
+			batch = open;
+			break;
+		}
+	}
+
+	if (batch != NULL && param_queue_add(&batch->queue, param, offset, value) < 0) {
+		coalescer_seal(batch);  // Full, let its owner send it right away.
+		batch = NULL;
+	}
+
+	/* The submitter that opens a batch owns it, and sends it once the window has elapsed. */
+	int owner = (batch == NULL);
+	if (owner) {
+		batch = coalescer_new_batch(type, version, host);
+		if (batch == NULL || param_queue_add(&batch->queue, param, offset, value) < 0) {
+			if (batch != NULL) {
+				coalescer_seal(batch);
+				free(batch);
+			}
+			pthread_mutex_unlock(&coalescer_lock);
+			return -2;
+		}
+	}
+
+	batch->refs++;
+	if (timeout > batch->timeout) {
+		batch->timeout = timeout;
+	}
+
+	if (owner) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		unsigned long long nsec = deadline.tv_nsec + (unsigned long long)atomic_load(&coalescer_window_us) * 1000;
+		deadline.tv_sec += nsec / 1000000000;
+		deadline.tv_nsec = nsec % 1000000000;
+
+		while (!batch->sealed) {
+			if (pthread_cond_timedwait(&coalescer_cond, &coalescer_lock, &deadline) != 0) {
+				break;  // Window elapsed
+			}
+		}
+		coalescer_seal(batch);
+
+		pthread_mutex_unlock(&coalescer_lock);
+		int result = coalescer_send(batch);
+		pthread_mutex_lock(&coalescer_lock);
+
+		batch->result = result;
+		batch->done = 1;
+		pthread_cond_broadcast(&coalescer_cond);
+	} else {
+		while (!batch->done) {
+			pthread_cond_wait(&coalescer_cond, &coalescer_lock);
+		}
+	}
+
+	int result = batch->result;
+	if (--batch->refs == 0) {
+		free(batch);
+	}
+
+	pthread_mutex_unlock(&coalescer_lock);
+	return result;
+}
@@ -0,0 +1,31 @@
+/*
+ * coalescer.h
+ *
+ * Opt-in scheduler that coalesces single parameter requests from any thread into shared packets.
+ *
+ * Requests are queued per (destination, type, version), and the queue is sent as a single packet
+ * when it fills up, or once the window since its first request has elapsed.
+ * Every caller then gets the result of the shared packet.
+ *
+ * Contains no Python API, submitting must be done without holding the GIL.
+ */
+
+#pragma once
+
+#include <param/param.h>
+#include <param/param_queue.h>
+
+/* Current window in microseconds, 0 when coalescing is disabled. */
+unsigned int pycsh_coalescer_get_window(void);
+
+/* Set the window in microseconds, 0 disables coalescing (default). */
+void pycsh_coalescer_set_window(unsigned int window_us);
+
+/**
+ * @brief Add a request to the shared packet for 'host', and wait for it to be sent.
+ *
+ * @param value Value to serialize for PARAM_QUEUE_TYPE_SET, NULL otherwise.
+ * @param timeout Timeout of the shared packet is the largest of its requests.
+ * @return int 0 on success, <0 when the packet got no response, or the request didn't fit in a packet.
+ */
+int pycsh_coalescer_submit(param_queue_type_e type, param_t * param, int offset, void * value, int host, int timeout, int version);
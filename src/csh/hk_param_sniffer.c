@@ -19,6 +19,7 @@
 #include <slash/optparse.h>
 
 #include "prometheus.h"
+#include "../param_index.h"
 #include "param_sniffer.h"
 
 pthread_t hk_param_sniffer_thread;
@@ -129,7 +130,7 @@ bool hk_param_sniffer(csp_packet_t * packet) {
 		if (node == 0) {
 			node = packet->id.src;
 		}
-		param_t * param = param_list_find_id(node, id);
+		param_t * param = pycsh_param_index_find_id(node, id);
 		if (param) {
 			*param->timestamp = timestamp;
 			if (*param->timestamp == 0 || local_epoch == 0) {
@@ -6,6 +6,10 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <time.h>
 #include <sys/time.h>
 #include <pthread.h>
 #include <param/param_server.h>
@@ -14,8 +18,17 @@
 #include <csp/csp.h>
 #include <csp/csp_crc32.h>
 
+#include <slash/slash.h>
+#include <slash/optparse.h>
+
 #include "hk_param_sniffer.h"
 #include "prometheus.h"
+#include "../param_index.h"
+#include "../param_history.h"
+#include "../param_cache.h"
+#include "../param_shadow.h"
+#include "../spsc_ring.h"
+#include "sniffer_sample.h"
 #include "victoria_metrics.h"
 #include "vts.h"
 
@@ -26,9 +39,116 @@ int sniffer_running = 0;
 pthread_t param_sniffer_thread;
 FILE *logfile;
 
-int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offset, void *reader, long unsigned int timestamp) {
+/* Packets waiting to be decoded, and samples waiting for each sink. */
+#define SNIFFER_PACKET_QUEUE 256
+#define SNIFFER_SINK_QUEUE 8192
+
+/* Values of a parameter followed by the VTS sink */
+typedef struct {
+    uint16_t id;
+    int count;
+    double values[4];
+    uint64_t time_ns;
+} sniffer_vts_t;
+
+/**
+ * Stage of the sniffer pipeline, consuming from its own bounded queue on its own thread.
+ * The reader thread only feeds the decoder, which in turn feeds the sinks,
+ * so a slow sink only drops its own samples, instead of stalling csp_promisc_read().
+ */
+typedef struct {
+    const char * name;
+    size_t queue_size;
+    size_t elem_size;
+    void (*consume)(void * elem);
+    void (*idle)(void);  // Called when the queue runs empty, may be NULL.
+
+    pycsh_spsc_t queue;
+    pthread_t thread;
+    atomic_uint_fast64_t processed;
+
+    /* Previous "sniffer stats", for the rate. Only used by the command. */
+    uint64_t stats_processed;
+    uint64_t stats_time_us;
+} sniffer_stage_t;
+
+static void sniffer_decode(void * elem);
+static void sniffer_vm_consume(void * elem);
+static void sniffer_prometheus_consume(void * elem);
+static void sniffer_log_consume(void * elem);
+static void sniffer_log_idle(void);
+static void sniffer_vts_consume(void * elem);
+
+static sniffer_stage_t decoder_stage = {.name = "decoder", .queue_size = SNIFFER_PACKET_QUEUE, .elem_size = sizeof(csp_packet_t *), .consume = sniffer_decode};
+static sniffer_stage_t vm_stage = {.name = "vm", .queue_size = SNIFFER_SINK_QUEUE, .elem_size = sizeof(sniffer_sample_t), .consume = sniffer_vm_consume};
+static sniffer_stage_t prometheus_stage = {.name = "prometheus", .queue_size = SNIFFER_SINK_QUEUE, .elem_size = sizeof(sniffer_sample_t), .consume = sniffer_prometheus_consume};
+static sniffer_stage_t log_stage = {.name = "logfile", .queue_size = SNIFFER_SINK_QUEUE, .elem_size = sizeof(sniffer_sample_t), .consume = sniffer_log_consume, .idle = sniffer_log_idle};
+static sniffer_stage_t vts_stage = {.name = "vts", .queue_size = 256, .elem_size = sizeof(sniffer_vts_t), .consume = sniffer_vts_consume};
+
+static sniffer_stage_t * const sniffer_stages[] = {&decoder_stage, &vm_stage, &prometheus_stage, &log_stage, &vts_stage};
+#define SNIFFER_STAGE_COUNT (sizeof(sniffer_stages) / sizeof(sniffer_stages[0]))
+
+/* Passed as the 'ctx' of param_sniffer_log() to receive its samples instead of the sink queues, i.e for "sniffer bench". */
+typedef struct {
+    void (*emit)(const sniffer_sample_t * sample, void * arg);
+    void * arg;
+} sniffer_emit_t;
+
+static void * sniffer_stage_thread(void * arg) {
+
+    sniffer_stage_t * stage = arg;
+    _Alignas(16) char elem[stage->elem_size];
+
+    while (1) {
+        if (pycsh_spsc_try_pop(&stage->queue, elem) < 0) {
+            if (stage->idle) {
+                stage->idle();
+            }
+            pycsh_spsc_pop(&stage->queue, elem);
+        }
+        stage->consume(elem);
+        atomic_fetch_add_explicit(&stage->processed, 1, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+static void sniffer_vm_consume(void * elem) {
+    vm_add_sample(elem);
+}
+
+/* Only the latest sample is kept, and rendered when scraped. */
+static void sniffer_prometheus_consume(void * elem) {
+    prometheus_set(elem);
+}
+
+static void sniffer_log_consume(void * elem) {
+    char line[SNIFFER_LINE_MAX];
+    size_t len = sniffer_sample_line(elem, line);
+    fwrite(line, 1, len, logfile);
+}
+
+/* Flushing once the queue runs empty, rather than per sample, keeps up with bursts. */
+static void sniffer_log_idle(void) {
+    fflush(logfile);
+}
 
-    char tmp[1000] = {};
+static void sniffer_vts_consume(void * elem) {
+    sniffer_vts_t * vts = elem;
+    vts_add(vts->values, vts->id, vts->count, vts->time_ns / 1000000);
+}
+
+/* Store a decoded integer in the C type of the parameter, for pycsh_param_history_record() */
+static inline void sniffer_history_store(uint64_t * slot, int typesize, uint64_t value) {
+    switch (typesize) {
+        case 1: *(uint8_t *)slot = value; break;
+        case 2: *(uint16_t *)slot = value; break;
+        case 4: *(uint32_t *)slot = value; break;
+        default: *slot = value; break;
+    }
+}
+
+int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offset, void *reader, long unsigned int timestamp) {
 
     if (offset < 0)
         offset = 0;
@@ -41,20 +161,51 @@ int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offs
         count = mpack_expect_array(reader);
     }
 
-    double vts_arr[4];
-    int vts = check_vts(param->node, param->id);
+    const sniffer_emit_t * emit = ctx;
+
+    sniffer_vts_t vts_job = {.id = param->id};
+    int vts = (emit == NULL) && check_vts(param->node, param->id);
 
-    uint64_t time_ms;
+    uint64_t time_ns;
     if (timestamp > 0) {
-        time_ms = timestamp * 1000;
+        time_ns = (uint64_t)timestamp * 1000000000;
     } else {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        time_ms = ((uint64_t) tv.tv_sec * 1000000 + tv.tv_usec) / 1000;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        time_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    /* One slot per index of the parameter, values outside the parameter are not recorded. */
+    const int history_slots = param->array_size > 1 ? param->array_size : 1;
+    const int typesize = param_typesize(param->type);
+    uint64_t history_values[history_slots];
+    int decoded = 0;
+
+    /* Only copied into the queues of enabled sinks. */
+    int to_vm = (emit == NULL) && vm_running;
+    int to_prometheus = (emit == NULL) && prometheus_started;
+    int to_log = (emit == NULL) && (logfile != NULL);
+
+    sniffer_sample_t sample = {
+        .node = param->node,
+        .id = param->id,
+        .type = param->type,
+        .time_ns = time_ns,
+    };
+    if (emit || to_vm || to_prometheus || to_log) {
+        sample.series = sniffer_series_intern(param);
+        if (sample.series == NULL) {
+            emit = NULL;
+            to_vm = to_prometheus = to_log = 0;
+        }
     }
 
     for (int i = offset; i < offset + count; i++) {
 
+        uint64_t discard;
+        uint64_t * slot = (i < history_slots) ? &history_values[i] : &discard;
+        int exported = 1;
+
         switch (param->type) {
             case PARAM_TYPE_UINT8:
             case PARAM_TYPE_XINT8:
@@ -62,28 +213,49 @@ int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offs
             case PARAM_TYPE_XINT16:
             case PARAM_TYPE_UINT32:
             case PARAM_TYPE_XINT32:
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %u %"PRIu64"\n", param->name, param->node, i, mpack_expect_uint(reader), time_ms);
+            {
+                unsigned int tmp_uint = mpack_expect_uint(reader);
+                sample.value.u = tmp_uint;
+                sniffer_history_store(slot, typesize, tmp_uint);
                 break;
+            }
             case PARAM_TYPE_UINT64:
             case PARAM_TYPE_XINT64:
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %"PRIu64" %"PRIu64"\n", param->name, param->node, i, mpack_expect_u64(reader), time_ms);
+            {
+                uint64_t tmp_u64 = mpack_expect_u64(reader);
+                sample.value.u = tmp_u64;
+                *slot = tmp_u64;
                 break;
+            }
             case PARAM_TYPE_INT8:
             case PARAM_TYPE_INT16:
             case PARAM_TYPE_INT32:
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %d %"PRIu64"\n", param->name, param->node, i, mpack_expect_int(reader), time_ms);
+            {
+                int tmp_int = mpack_expect_int(reader);
+                sample.value.i = tmp_int;
+                sniffer_history_store(slot, typesize, tmp_int);
                 break;
+            }
             case PARAM_TYPE_INT64:
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %"PRIi64" %"PRIu64"\n", param->name, param->node, i, mpack_expect_i64(reader), time_ms);
+            {
+                int64_t tmp_i64 = mpack_expect_i64(reader);
+                sample.value.i = tmp_i64;
+                *(int64_t *)slot = tmp_i64;
                 break;
+            }
             case PARAM_TYPE_FLOAT:
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %e %"PRIu64"\n", param->name, param->node, i, mpack_expect_float(reader), time_ms);
+            {
+                float tmp_flt = mpack_expect_float(reader);
+                sample.value.f = tmp_flt;
+                *(float *)slot = tmp_flt;
                 break;
+            }
             case PARAM_TYPE_DOUBLE: {
                 double tmp_dbl = mpack_expect_double(reader);
-                sprintf(tmp, "%s{node=\"%u\", idx=\"%u\"} %.12e %"PRIu64"\n", param->name, param->node, i, tmp_dbl, time_ms);
-                if(vts){
-                    vts_arr[i] = tmp_dbl;
+                sample.value.d = tmp_dbl;
+                *(double *)slot = tmp_dbl;
+                if(vts && i < 4){
+                    vts_job.values[i] = tmp_dbl;
                 }
                 break;
             }
@@ -93,31 +265,61 @@ int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offs
             case PARAM_TYPE_DATA:
             default:
                 mpack_discard(reader);
+                exported = 0;  // Strings and data are not exported.
                 break;
         }
 
         if (mpack_reader_error(reader) != mpack_ok) {
             break;
         }
+        decoded++;
 
-        if(vm_running){
-            vm_add(tmp);
+        if (!exported) {
+            continue;
         }
 
-        if(prometheus_started){
-            prometheus_add(tmp);
+        sample.idx = i;
+
+        if (emit) {
+            emit->emit(&sample, emit->arg);
         }
 
-        if (logfile) {
-            fprintf(logfile, "%s", tmp);
-            fflush(logfile);
+        if (to_vm) {
+            pycsh_spsc_push(&vm_stage.queue, &sample);
+        }
+
+        if (to_prometheus) {
+            pycsh_spsc_push(&prometheus_stage.queue, &sample);
+        }
+
+        if (to_log) {
+            pycsh_spsc_push(&log_stage.queue, &sample);
         }
     }
 
     if(vts){
-        vts_add(vts_arr, param->id, count, time_ms);
+        vts_job.count = count;
+        vts_job.time_ns = time_ns;
+        pycsh_spsc_push(&vts_stage.queue, &vts_job);
     } 
 
+    if (decoded > 0 && offset < history_slots) {
+        int history_count = (offset + decoded > history_slots) ? history_slots - offset : decoded;
+        pycsh_param_history_record(param, offset, history_count, &history_values[offset], sizeof(uint64_t), time_ns / 1e9);
+        /* When enabled, sniffed values of remote parameters are as good as pulled ones, so update their cached value.
+            Local parameters are left alone, as they may have callbacks.
+            Freshness uses our own receive time, as the clock of the remote may be ahead of ours. */
+        if (param->node != 0 && pycsh_param_cache_get_sniffed()) {
+            for (int i = offset; i < offset + history_count; i++) {
+                param_set(param, i, &history_values[i]);
+            }
+            pycsh_param_shadow_update_cached(param, param->node, offset, history_count);
+            if (offset == 0 && history_count >= history_slots) {
+                pycsh_param_cache_touch(param, pycsh_param_history_now());
+            }
+        }
+    }
+
     return 0;
 }
 
@@ -139,68 +341,225 @@ int param_sniffer_crc(csp_packet_t * packet) {
     return 0;
 }
 
+/* Decoder stage, packets are decoded in the order they were read. */
+static void sniffer_decode(void * elem) {
+
+    csp_packet_t * packet = *(csp_packet_t **)elem;
+
+    if(hk_param_sniffer(packet)){
+        csp_buffer_free(packet);
+        return;
+    }
+
+    if (packet->id.sport != PARAM_PORT_SERVER) {
+        csp_buffer_free(packet);
+        return;
+    }
+
+    if (param_sniffer_crc(packet) < 0) {
+        csp_buffer_free(packet);
+        return;
+    }
+
+    uint8_t type = packet->data[0];
+    if ((type != PARAM_PULL_RESPONSE) && (type != PARAM_PULL_RESPONSE_V2)) {
+        csp_buffer_free(packet);
+        return;
+    }
+
+    int queue_version;
+    if (type == PARAM_PULL_RESPONSE) {
+        queue_version = 1;
+    } else {
+        queue_version = 2;
+    }
+
+    param_queue_t queue;
+    param_queue_init(&queue, &packet->data[2], packet->length - 2, packet->length - 2, PARAM_QUEUE_TYPE_SET, queue_version);
+    queue.last_node = packet->id.src;
+
+    mpack_reader_t reader;
+    mpack_reader_init_data(&reader, queue.buffer, queue.used);
+    while(reader.data < reader.end) {
+        int id, node, offset = -1;
+        long unsigned int timestamp = 0;
+        param_deserialize_id(&reader, &id, &node, &timestamp, &offset, &queue);
+        if (node == 0) {
+            node = packet->id.src;
+        }
+        /* If parameter timestamp is not inside the header, and the lower layer found a timestamp*/
+        if ((timestamp == 0) && (packet->timestamp_rx != 0)) {
+            timestamp = packet->timestamp_rx;
+        }
+        param_t * param = pycsh_param_index_find_id(node, id);
+        if (param) {	
+            param_sniffer_log(NULL, &queue, param, offset, &reader, timestamp);
+        } else {
+            printf("Found unknown param node %d id %d\n", node, id);
+            break;
+        }
+    }
+    csp_buffer_free(packet);
+}
+
+/* Reader stage, only hands packets to the decoder, so promiscuous packets are drained as fast as possible. */
 static void * param_sniffer(void * param) {
     csp_promisc_enable(100);
     while(1) {
         csp_packet_t * packet = csp_promisc_read(CSP_MAX_DELAY);
-
-        if(hk_param_sniffer(packet)){
-            csp_buffer_free(packet);
+        if (packet == NULL) {
             continue;
         }
 
-        if (packet->id.sport != PARAM_PORT_SERVER) {
+        if (pycsh_spsc_push(&decoder_stage.queue, &packet) < 0) {
             csp_buffer_free(packet);
-            continue;
         }
+    }
+    return NULL;
+}
 
-        if (param_sniffer_crc(packet) < 0) {
-            csp_buffer_free(packet);
-            continue;
-        }
+static uint64_t sniffer_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
 
-        uint8_t type = packet->data[0];
-        if ((type != PARAM_PULL_RESPONSE) && (type != PARAM_PULL_RESPONSE_V2)) {
-            csp_buffer_free(packet);
-            continue;
-        }
+static void sniffer_stats_row(const char * name, uint64_t processed, uint64_t * last_processed, uint64_t * last_time_us, pycsh_spsc_t * queue) {
 
-        int queue_version;
-        if (type == PARAM_PULL_RESPONSE) {
-            queue_version = 1;
-        } else {
-            queue_version = 2;
-        }
+    uint64_t now = sniffer_now_us();
+    double rate = 0;
+    if (*last_time_us > 0 && now > *last_time_us) {
+        rate = (processed - *last_processed) * 1e6 / (now - *last_time_us);
+    }
+    *last_processed = processed;
+    *last_time_us = now;
+
+    printf("%-12s %14"PRIu64" %12.1f %8zu %8zu %12"PRIu64"\n", name, processed, rate,
+        pycsh_spsc_depth(queue), queue->capacity, atomic_load_explicit(&queue->dropped, memory_order_relaxed));
+}
 
-        param_queue_t queue;
-        param_queue_init(&queue, &packet->data[2], packet->length - 2, packet->length - 2, PARAM_QUEUE_TYPE_SET, queue_version);
-        queue.last_node = packet->id.src;
+static int sniffer_stats_slash(struct slash *slash) {
 
+    if (!sniffer_running) {
+        printf("Parameter sniffer is not running\n");
+        return SLASH_EINVAL;
+    }
+
+    /* The reader drops into the queue of the decoder, so it shares its row of drops. */
+    static uint64_t reader_processed, reader_time_us;
+    uint64_t read = atomic_load_explicit(&decoder_stage.queue.pushed, memory_order_relaxed)
+        + atomic_load_explicit(&decoder_stage.queue.dropped, memory_order_relaxed);
+
+    printf("%-12s %14s %12s %8s %8s %12s\n", "Stage", "Processed", "Rate [/s]", "Depth", "Capacity", "Dropped");
+    sniffer_stats_row("reader", read, &reader_processed, &reader_time_us, &decoder_stage.queue);
+    for (size_t i = 0; i < SNIFFER_STAGE_COUNT; i++) {
+        sniffer_stage_t * stage = sniffer_stages[i];
+        sniffer_stats_row(stage->name, atomic_load_explicit(&stage->processed, memory_order_relaxed),
+            &stage->stats_processed, &stage->stats_time_us, &stage->queue);
+    }
+
+    return SLASH_SUCCESS;
+}
+slash_command_sub(sniffer, stats, sniffer_stats_slash, "", "Throughput, queue depth and drops of each stage of the parameter sniffer");
+
+static uint64_t sniffer_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sniffer_bench_decode(const sniffer_sample_t * sample, void * arg) {
+    (*(uint64_t *)arg)++;
+}
+
+/* Renders the line of the Victoria Metrics and logfile sinks, and of Prometheus scrapes. */
+static void sniffer_bench_render(const sniffer_sample_t * sample, void * arg) {
+    char line[SNIFFER_LINE_MAX];
+    *(uint64_t *)arg += sniffer_sample_line(sample, line);
+}
+
+/* Returns the CPU time of decoding 'packets' times the encoded values of the parameter. */
+static uint64_t sniffer_bench_run(param_t * param, const char * data, size_t size, int packets, const sniffer_emit_t * emit) {
+    uint64_t start = sniffer_cpu_ns();
+    for (int i = 0; i < packets; i++) {
         mpack_reader_t reader;
-        mpack_reader_init_data(&reader, queue.buffer, queue.used);
-        while(reader.data < reader.end) {
-            int id, node, offset = -1;
-            long unsigned int timestamp = 0;
-            param_deserialize_id(&reader, &id, &node, &timestamp, &offset, &queue);
-            if (node == 0) {
-                node = packet->id.src;
-            }
-            /* If parameter timestamp is not inside the header, and the lower layer found a timestamp*/
-            if ((timestamp == 0) && (packet->timestamp_rx != 0)) {
-                timestamp = packet->timestamp_rx;
-            }
-            param_t * param = param_list_find_id(node, id);
-            if (param) {	
-                param_sniffer_log(NULL, &queue, param, offset, &reader, timestamp);
-            } else {
-                printf("Found unknown param node %d id %d\n", node, id);
-                break;
-            }
+        mpack_reader_init_data(&reader, data, size);
+        param_sniffer_log((void *)emit, NULL, param, 0, &reader, 1700000000);
+        mpack_reader_destroy(&reader);
+    }
+    return sniffer_cpu_ns() - start;
+}
+
+static int sniffer_bench_slash(struct slash *slash) {
+
+    int samples = 1000000;
+    int array_size = 8;
+    int integer = 0;
+
+    optparse_t * parser = optparse_new("sniffer bench", "");
+    optparse_add_help(parser);
+    optparse_add_int(parser, 'n', "samples", "NUM", 0, &samples, "Number of samples to decode (default = 1000000)");
+    optparse_add_int(parser, 'a', "array", "NUM", 0, &array_size, "Array size of the synthetic parameter, i.e samples per packet (default = 8)");
+    optparse_add_set(parser, 'i', "integer", 1, &integer, "Use an uint32 parameter, instead of a float");
+
+    int argi = optparse_parse(parser, slash->argc - 1, (const char **)slash->argv + 1);
+    optparse_del(parser);
+    if (argi < 0) {
+        return SLASH_EINVAL;
+    }
+
+    if (array_size < 1 || array_size > 256 || samples < array_size) {
+        printf("Expected 1 <= array <= 256, and samples >= array\n");
+        return SLASH_EINVAL;
+    }
+
+    /* Local (node 0) so decoding leaves the cached value alone, and does not depend on the parameter index. */
+    param_t param = {
+        .id = 0x3FF,
+        .node = 0,
+        .type = integer ? PARAM_TYPE_UINT32 : PARAM_TYPE_FLOAT,
+        .array_size = array_size,
+        .name = "sniffer_bench",
+    };
+
+    /* Values of a pull response, as param_sniffer_log() would find them after the parameter ID. */
+    char data[256 * 8];
+    mpack_writer_t writer;
+    mpack_writer_init(&writer, data, sizeof(data));
+    mpack_start_array(&writer, array_size);
+    for (int i = 0; i < array_size; i++) {
+        if (integer) {
+            mpack_write_uint(&writer, 100000 + i * 12345);
+        } else {
+            mpack_write_float(&writer, 1.5f + i * 0.001f);
         }
-        csp_buffer_free(packet);
     }
-    return NULL;
+    mpack_finish_array(&writer);
+    size_t size = mpack_writer_buffer_used(&writer);
+    if (mpack_writer_destroy(&writer) != mpack_ok) {
+        return SLASH_EINVAL;
+    }
+
+    const int packets = samples / array_size;
+    uint64_t decoded = 0, rendered = 0;
+    const sniffer_emit_t decode_emit = {.emit = sniffer_bench_decode, .arg = &decoded};
+    const sniffer_emit_t render_emit = {.emit = sniffer_bench_render, .arg = &rendered};
+
+    uint64_t decode_ns = sniffer_bench_run(&param, data, size, packets, &decode_emit);
+    uint64_t render_ns = sniffer_bench_run(&param, data, size, packets, &render_emit);
+
+    if (decoded == 0) {
+        printf("No samples decoded\n");
+        return SLASH_EINVAL;
+    }
+
+    printf("%"PRIu64" %s samples in packets of %d\n", decoded, integer ? "uint32" : "float", array_size);
+    printf("decode          %8.1f ns/sample\n", (double)decode_ns / decoded);
+    printf("decode + render %8.1f ns/sample (%.1f bytes/line)\n", (double)render_ns / decoded, (double)rendered / decoded);
+
+    return SLASH_SUCCESS;
 }
+slash_command_sub(sniffer, bench, sniffer_bench_slash, "", "Measure the CPU time per sample of decoding and rendering synthetic sniffed packets");
 
 void param_sniffer_init(int add_logfile) {
 
@@ -217,6 +576,22 @@ void param_sniffer_init(int add_logfile) {
         }
     }	
 
+    for (size_t i = 0; i < SNIFFER_STAGE_COUNT; i++) {
+        sniffer_stage_t * stage = sniffer_stages[i];
+        if (pycsh_spsc_init(&stage->queue, stage->queue_size, stage->elem_size) < 0) {
+            printf("Couldn't allocate the %s queue of the parameter sniffer\n", stage->name);
+            for (size_t j = 0; j < i; j++) {
+                pycsh_spsc_free(&sniffer_stages[j]->queue);
+            }
+            return;
+        }
+    }
+
+    /* Idle stages just sleep on their queue, so start them all, in case a sink is enabled later. */
+    for (size_t i = 0; i < SNIFFER_STAGE_COUNT; i++) {
+        pthread_create(&sniffer_stages[i]->thread, NULL, &sniffer_stage_thread, sniffer_stages[i]);
+    }
+
     sniffer_running = 1;
     pthread_create(&param_sniffer_thread, NULL, &param_sniffer, NULL);
 }
@@ -11,6 +11,8 @@
 #include <csp/csp.h>
 
 int param_sniffer_crc(csp_packet_t * packet);
+/* Decodes the value of a sniffed parameter and queues it for the enabled sinks.
+    The sink queues have a single producer, so this must only be called from the decoder thread. */
 int param_sniffer_log(void * ctx, param_queue_t *queue, param_t *param, int offset, void *reader, long unsigned int timestamp);
 void param_sniffer_init(int add_logfile);
 
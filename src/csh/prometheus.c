@@ -7,9 +7,15 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <time.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <arpa/inet.h>
 
 #include <slash/slash.h>
@@ -18,20 +24,444 @@
 #include <param/param.h>
 #include <param/param_queue.h>
 
+#include "pycshconfig.h"
+#ifdef PYCSH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "prometheus.h"
 #include "param_sniffer.h"
 
+#define PROMETHEUS_PORT 9101
+#define PROMETHEUS_MAX_PROBES 64
+#define PROMETHEUS_MAX_CONNECTIONS 16
+#define PROMETHEUS_IDLE_TIMEOUT_S 30
+#define PROMETHEUS_REQUEST_MAX 4096
+
 static pthread_t prometheus_tread;
 int prometheus_started = 0;
 
-static char prometheus_buf[10*1024*1024] = {0};
-static int prometheus_buf_len = 0;
 static int listen_fd;
 
-static char header[1024] =
-		"HTTP/1.1 200 OK;\r\n"
-		"Content-Type: text/plain;\r\n\r\n";
+/* Latest sample of a (node, id, index) series, only rendered as text when scraped.
+	Written under a per-series sequence lock, so scrapes never block the sniffer. */
+typedef struct {
+	_Atomic uint64_t key;  // 0 while unused, see prometheus_key()
+	atomic_uint seq;  // Odd while being written, 0 until written once
+	sniffer_sample_t sample;
+} prometheus_series_t;
+
+/* Open addressing table of PROMETHEUS_MAX_SERIES entries, series are never removed. */
+static prometheus_series_t * series_table = NULL;
+
+static atomic_uint series_count = 0;
+static atomic_uint_fast64_t dropped_samples = 0;
+static atomic_uint_fast64_t scrape_count = 0;
+static atomic_uint_fast64_t render_count = 0;
+static atomic_uint_fast64_t render_ns_last = 0;
+static atomic_uint_fast64_t render_ns_total = 0;
+static atomic_int connection_count = 0;
+
+/* Rendered /metrics text, shared by every scrape that arrived before it was rendered.
+	Replaced by swapping 'published', and freed when the last scrape sending it is done. */
+typedef struct {
+	int refs;  // Protected by snapshot_lock
+	uint64_t rendered_ns;  // CLOCK_MONOTONIC when rendering started
+	char * text;
+	size_t len;
+	pthread_mutex_t gzip_lock;
+	char * gzip;  // Compressed on the first scrape accepting gzip
+	size_t gzip_len;
+} prometheus_snapshot_t;
+
+static prometheus_snapshot_t * published = NULL;
+static pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t prometheus_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t prometheus_key(uint16_t node, uint16_t id, int idx) {
+	return (1ULL << 63) | ((uint64_t)node << 47) | ((uint64_t)id << 31) | ((uint32_t)idx & 0x7FFFFFFF);
+}
+
+static inline uint64_t prometheus_hash(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return key;
+}
+
+static prometheus_series_t * prometheus_series_find(uint64_t key) {
+
+	size_t slot = prometheus_hash(key) & (PROMETHEUS_MAX_SERIES - 1);
+
+	for (int probe = 0; probe < PROMETHEUS_MAX_PROBES; probe++, slot = (slot + 1) & (PROMETHEUS_MAX_SERIES - 1)) {
+		prometheus_series_t * series = &series_table[slot];
+		uint64_t current = atomic_load_explicit(&series->key, memory_order_acquire);
+		if (current == key) {
+			return series;
+		}
+		if (current == 0) {
+			if (atomic_compare_exchange_strong(&series->key, &current, key)) {
+				atomic_fetch_add(&series_count, 1);
+				return series;
+			}
+			if (current == key) {
+				return series;  // Claimed by another sniffer thread in the meantime.
+			}
+		}
+	}
+
+	return NULL;
+}
+
+void prometheus_set(const sniffer_sample_t * sample) {
+
+	if (series_table == NULL) {
+		return;
+	}
+
+	prometheus_series_t * series = prometheus_series_find(prometheus_key(sample->node, sample->id, sample->idx));
+	if (series == NULL) {
+		atomic_fetch_add(&dropped_samples, 1);
+		return;
+	}
+
+	/* Writers of the same series take turns, scrapes retry while the sequence is odd. */
+	unsigned int seq = atomic_load_explicit(&series->seq, memory_order_relaxed);
+	do {
+		while (seq & 1) {
+			seq = atomic_load_explicit(&series->seq, memory_order_relaxed);
+		}
+	} while (!atomic_compare_exchange_weak_explicit(&series->seq, &seq, seq + 1, memory_order_acquire, memory_order_relaxed));
+
+	series->sample = *sample;
+
+	atomic_store_explicit(&series->seq, seq + 2, memory_order_release);
+}
+
+/* Copies a consistent sample of the series, returns 0 when it has never been written or is too busy. */
+static int prometheus_series_read(prometheus_series_t * series, sniffer_sample_t * out) {
+
+	for (int attempt = 0; attempt < 16; attempt++) {
+		unsigned int seq = atomic_load_explicit(&series->seq, memory_order_acquire);
+		if (seq == 0) {
+			return 0;
+		}
+		if (seq & 1) {
+			continue;
+		}
+		*out = series->sample;
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&series->seq, memory_order_relaxed) == seq) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void prometheus_snapshot_free(prometheus_snapshot_t * snapshot) {
+	pthread_mutex_destroy(&snapshot->gzip_lock);
+	free(snapshot->text);
+	free(snapshot->gzip);
+	free(snapshot);
+}
+
+static void prometheus_snapshot_release(prometheus_snapshot_t * snapshot) {
+	if (snapshot == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&snapshot_lock);
+	int refs = --snapshot->refs;
+	pthread_mutex_unlock(&snapshot_lock);
+	if (refs == 0) {
+		prometheus_snapshot_free(snapshot);
+	}
+}
+
+/* Renders every series, followed by the counters of the exporter itself. */
+static prometheus_snapshot_t * prometheus_render(void) {
+
+	uint64_t start = prometheus_now_ns();
+
+	prometheus_snapshot_t * snapshot = calloc(1, sizeof(prometheus_snapshot_t));
+	size_t capacity = 64 * 1024;
+	char * text = malloc(capacity);
+	if (snapshot == NULL || text == NULL) {
+		free(snapshot);
+		free(text);
+		return NULL;
+	}
+
+	/* Longest line we format, so we only check the capacity once per line. */
+	const size_t line_max = SNIFFER_LINE_MAX;
+	size_t len = 0;
+
+	for (size_t slot = 0; slot < PROMETHEUS_MAX_SERIES; slot++) {
+
+		if (atomic_load_explicit(&series_table[slot].key, memory_order_relaxed) == 0) {
+			continue;
+		}
+
+		sniffer_sample_t sample;
+		if (!prometheus_series_read(&series_table[slot], &sample)) {
+			continue;
+		}
+
+		if (len + line_max > capacity) {
+			char * grown = realloc(text, capacity * 2);
+			if (grown == NULL) {
+				break;  // Serve what we have.
+			}
+			text = grown;
+			capacity *= 2;
+		}
+
+		len += sniffer_sample_line(&sample, text + len);
+	}
+
+	if (len + 6 * line_max > capacity) {
+		char * grown = realloc(text, len + 6 * line_max);
+		if (grown != NULL) {
+			text = grown;
+			capacity = len + 6 * line_max;
+		}
+	}
+	if (len + 6 * line_max <= capacity) {
+		len += snprintf(text + len, capacity - len,
+			"pycsh_prometheus_series %u\n"
+			"pycsh_prometheus_dropped_samples_total %"PRIuFAST64"\n"
+			"pycsh_prometheus_scrapes_total %"PRIuFAST64"\n"
+			"pycsh_prometheus_renders_total %"PRIuFAST64"\n"
+			"pycsh_prometheus_render_seconds_last %.6f\n"
+			"pycsh_prometheus_render_seconds_total %.6f\n",
+			atomic_load(&series_count), atomic_load(&dropped_samples), atomic_load(&scrape_count),
+			atomic_load(&render_count), atomic_load(&render_ns_last) / 1e9, atomic_load(&render_ns_total) / 1e9);
+	}
+
+	pthread_mutex_init(&snapshot->gzip_lock, NULL);
+	snapshot->rendered_ns = start;
+	snapshot->text = text;
+	snapshot->len = len;
+
+	uint64_t elapsed = prometheus_now_ns() - start;
+	atomic_fetch_add(&render_count, 1);
+	atomic_store(&render_ns_last, elapsed);
+	atomic_fetch_add(&render_ns_total, elapsed);
+
+	return snapshot;
+}
+
+/**
+ * @brief Get a snapshot rendered no earlier than 'requested_ns', rendering a new one when needed.
+ *
+ * Concurrent scrapes wait for the same render, instead of rendering one each.
+ *
+ * @return Snapshot to prometheus_snapshot_release(), NULL when out of memory.
+ */
+static prometheus_snapshot_t * prometheus_snapshot_get(uint64_t requested_ns) {
+
+	pthread_mutex_lock(&render_lock);
+
+	pthread_mutex_lock(&snapshot_lock);
+	prometheus_snapshot_t * snapshot = published;
+	if (snapshot != NULL && snapshot->rendered_ns >= requested_ns) {
+		snapshot->refs++;
+		pthread_mutex_unlock(&snapshot_lock);
+		pthread_mutex_unlock(&render_lock);
+		return snapshot;
+	}
+	pthread_mutex_unlock(&snapshot_lock);
+
+	snapshot = prometheus_render();
+	if (snapshot == NULL) {
+		pthread_mutex_unlock(&render_lock);
+		return NULL;
+	}
+	snapshot->refs = 2;  // Published, and returned.
+
+	pthread_mutex_lock(&snapshot_lock);
+	prometheus_snapshot_t * old = published;
+	published = snapshot;
+	pthread_mutex_unlock(&snapshot_lock);
+
+	pthread_mutex_unlock(&render_lock);
+
+	prometheus_snapshot_release(old);
+	return snapshot;
+}
+
+#ifdef PYCSH_HAVE_ZLIB
+/* Compresses the snapshot once, returns 0 when it could not be compressed. */
+static int prometheus_snapshot_gzip(prometheus_snapshot_t * snapshot) {
+
+	pthread_mutex_lock(&snapshot->gzip_lock);
+
+	if (snapshot->gzip == NULL) {
+		z_stream zs = {0};
+		/* 16 + MAX_WBITS selects the gzip wrapper. Scrapes favour speed over ratio. */
+		if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+			uLong bound = deflateBound(&zs, snapshot->len);
+			char * out = malloc(bound);
+			if (out != NULL) {
+				zs.next_in = (Bytef *)snapshot->text;
+				zs.avail_in = snapshot->len;
+				zs.next_out = (Bytef *)out;
+				zs.avail_out = bound;
+				if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+					snapshot->gzip = out;
+					snapshot->gzip_len = zs.total_out;
+				} else {
+					free(out);
+				}
+			}
+			deflateEnd(&zs);
+		}
+	}
+
+	int compressed = (snapshot->gzip != NULL);
+	pthread_mutex_unlock(&snapshot->gzip_lock);
+	return compressed;
+}
+#endif
+
+static int prometheus_send_all(int fd, const char * buf, size_t len) {
+	while (len > 0) {
+		ssize_t sent = send(fd, buf, len, MSG_NOSIGNAL);
+		if (sent <= 0) {
+			return -1;
+		}
+		buf += sent;
+		len -= sent;
+	}
+	return 0;
+}
+
+/* Whether the header 'name' (including the colon) is present, and its value contains 'token', case-insensitively. */
+static int prometheus_header_has(const char * headers, const char * name, const char * token) {
+
+	size_t name_len = strlen(name);
+	size_t token_len = strlen(token);
 
+	for (const char * line = strstr(headers, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+		line += 2;
+		if (strncasecmp(line, name, name_len) != 0) {
+			continue;
+		}
+		const char * value = line + name_len;
+		const char * eol = strstr(value, "\r\n");
+		size_t value_len = eol ? (size_t)(eol - value) : strlen(value);
+		for (size_t i = 0; i + token_len <= value_len; i++) {
+			if (strncasecmp(value + i, token, token_len) == 0) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	return 0;
+}
+
+static int prometheus_respond(int conn_fd, const char * headers, int keep_alive) {
+
+	char header[256];
+
+	if (strncmp(headers, "GET /metrics", 12) != 0) {
+		int len = snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n", keep_alive ? "keep-alive" : "close");
+		return prometheus_send_all(conn_fd, header, len);
+	}
+
+	atomic_fetch_add(&scrape_count, 1);
+
+	prometheus_snapshot_t * snapshot = prometheus_snapshot_get(prometheus_now_ns());
+	if (snapshot == NULL) {
+		int len = snprintf(header, sizeof(header), "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		prometheus_send_all(conn_fd, header, len);
+		return -1;
+	}
+
+	const char * body = snapshot->text;
+	size_t body_len = snapshot->len;
+	const char * encoding = "";
+#ifdef PYCSH_HAVE_ZLIB
+	if (prometheus_header_has(headers, "Accept-Encoding:", "gzip") && prometheus_snapshot_gzip(snapshot)) {
+		body = snapshot->gzip;
+		body_len = snapshot->gzip_len;
+		encoding = "Content-Encoding: gzip\r\n";
+	}
+#endif
+
+	int len = snprintf(header, sizeof(header),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %zu\r\n"
+		"%s"
+		"Connection: %s\r\n\r\n",
+		body_len, encoding, keep_alive ? "keep-alive" : "close");
+
+	int res = prometheus_send_all(conn_fd, header, len);
+	if (res == 0) {
+		res = prometheus_send_all(conn_fd, body, body_len);
+	}
+
+	prometheus_snapshot_release(snapshot);
+	return res;
+}
+
+/* Serves requests on the connection until the client closes it, asks us to, or goes idle. */
+static void * prometheus_connection(void * arg) {
+
+	int conn_fd = (int)(intptr_t)arg;
+
+	struct timeval idle = {.tv_sec = PROMETHEUS_IDLE_TIMEOUT_S};
+	setsockopt(conn_fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+
+	char request[PROMETHEUS_REQUEST_MAX + 1];
+	size_t used = 0;
+	int keep_alive = 1;
+
+	while (keep_alive) {
+
+		/* Read until the end of the headers, requests we serve have no body. */
+		char * end;
+		request[used] = '\0';
+		while ((end = strstr(request, "\r\n\r\n")) == NULL) {
+			if (used >= PROMETHEUS_REQUEST_MAX) {
+				goto close;
+			}
+			ssize_t bread = recv(conn_fd, request + used, PROMETHEUS_REQUEST_MAX - used, 0);
+			if (bread <= 0) {
+				goto close;
+			}
+			used += bread;
+			request[used] = '\0';
+		}
+
+		size_t consumed = (end - request) + 4;
+		end[2] = '\0';  // Headers as a string, keeping the line ending of the last header.
+
+		keep_alive = (strstr(request, "HTTP/1.1\r\n") != NULL) && !prometheus_header_has(request, "Connection:", "close");
+
+		if (prometheus_respond(conn_fd, request, keep_alive) < 0) {
+			break;
+		}
+
+		/* Keep pipelined requests. */
+		memmove(request, request + consumed, used - consumed);
+		used -= consumed;
+	}
+
+close:
+	shutdown(conn_fd, SHUT_RDWR);
+	close(conn_fd);
+	atomic_fetch_sub(&connection_count, 1);
+	return NULL;
+}
 
 void * prometheus_exporter(void * param) {
 
@@ -43,15 +473,15 @@ void * prometheus_exporter(void * param) {
 	struct sockaddr_in server_addr = {0};
 	server_addr.sin_family = AF_INET;
 	server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-	server_addr.sin_port = htons(9101);
+	server_addr.sin_port = htons(PROMETHEUS_PORT);
 
 retry_bind:
 	if (bind(listen_fd, (struct sockaddr *) &server_addr, sizeof(server_addr)) < 0) {
-		printf("Cannot bind prometheus to port 9101\n");
+		printf("Cannot bind prometheus to port %d\n", PROMETHEUS_PORT);
 		sleep(1);
 		goto retry_bind;
 	} else {
-		printf("Prometheus exporter listening on port 9101\n");
+		printf("Prometheus exporter listening on port %d\n", PROMETHEUS_PORT);
 	}
 
 	listen(listen_fd, 100);
@@ -59,52 +489,42 @@ retry_bind:
 	while(1) {
 
 		struct sockaddr_in client_addr;
-		socklen_t client_addr_len;
+		socklen_t client_addr_len = sizeof(client_addr);
 		int conn_fd = accept(listen_fd, (struct sockaddr*)&client_addr, &client_addr_len);
-
-		char in[1024];
-		int bread = recv(conn_fd, in, 1024, MSG_NOSIGNAL);
-		if (bread == 0) {
-			close(conn_fd);
+		if (conn_fd < 0) {
 			continue;
 		}
 
-		if (strncmp(in, "GET /metrics", 12) != 0) {
+		/* Each connection gets its own thread, so a slow scraper doesn't hold up the others. */
+		if (atomic_fetch_add(&connection_count, 1) >= PROMETHEUS_MAX_CONNECTIONS) {
+			atomic_fetch_sub(&connection_count, 1);
 			close(conn_fd);
 			continue;
 		}
 
-		int written = send(conn_fd, header, strlen(header), MSG_NOSIGNAL);
-
-		/* Dump queued data */
-		written += send(conn_fd, prometheus_buf, prometheus_buf_len, MSG_NOSIGNAL);
-		//printf("Prometheus sent %d bytes\n", written);
-
-		prometheus_clear();
-
-		shutdown(conn_fd, SHUT_RDWR);
-
-		close(conn_fd);
-
+		pthread_t thread;
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		if (pthread_create(&thread, &attr, prometheus_connection, (void *)(intptr_t)conn_fd) != 0) {
+			atomic_fetch_sub(&connection_count, 1);
+			close(conn_fd);
+		}
+		pthread_attr_destroy(&attr);
 	}
 
 	return NULL;
 
 }
 
-void prometheus_add(char * str) {
-	if (prometheus_buf_len + strlen(str) < 1024 * 1024 * 10) {
-		strcpy(prometheus_buf + prometheus_buf_len, str);
-		prometheus_buf_len += strlen(str);
-	}
-	printf("prometheus add %s", str);
-}
-
-void prometheus_clear(void) {
-	prometheus_buf_len = 0;
-}
-
 void prometheus_init(void) {
+	if (series_table == NULL) {
+		series_table = calloc(PROMETHEUS_MAX_SERIES, sizeof(prometheus_series_t));
+		if (series_table == NULL) {
+			printf("Not enough memory for the prometheus exporter\n");
+			return;
+		}
+	}
 	pthread_create(&prometheus_tread, NULL, &prometheus_exporter, NULL);
 }
 
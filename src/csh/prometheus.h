@@ -8,8 +8,23 @@
 #ifndef SRC_PROMETHEUS_H_
 #define SRC_PROMETHEUS_H_
 
-void prometheus_clear(void);
-void prometheus_add(char * str);
+#include <stdint.h>
+#include <param/param.h>
+
+#include "sniffer_sample.h"
+
+/* Upper limit of distinct (node, id, index) series, samples of further series are dropped. Must be a power of 2. */
+#define PROMETHEUS_MAX_SERIES 32768
+
+/**
+ * @brief Sets the latest value of the series of the parameter index, to be served on the next scrape.
+ *
+ * Only the binary sample is stored, it is rendered as text when scraped, so samples overwritten before the next scrape cost no formatting.
+ *
+ * Lock-free for distinct series, so it may be called from the sniffer threads.
+ */
+void prometheus_set(const sniffer_sample_t * sample);
+
 void prometheus_init(void);
 void prometheus_close(void);
 
@@ -0,0 +1,131 @@
+/*
+ * sniffer_sample.c
+ *
+ * Binary samples decoded by the parameter sniffer, and their text rendering.
+ */
+
+#include "sniffer_sample.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../pointer_map.h"
+
+/* Leaves room for the labels in the key. */
+#define SNIFFER_NAME_MAX (SNIFFER_KEY_MAX - 32)
+
+/* param_t * -> sniffer_series_t *, protected by series_lock. */
+static pycsh_ptrmap_t series_map;
+static pthread_mutex_t series_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const sniffer_series_t * sniffer_series_intern(const param_t * param) {
+
+    pthread_mutex_lock(&series_lock);
+
+    sniffer_series_t * series = pycsh_ptrmap_get(&series_map, param);
+
+    /* The param_t may have been freed, and another allocated in its place. */
+    if (series != NULL && series->node == param->node && series->id == param->id
+            && strncmp(series->key, param->name, series->name_len) == 0
+            && (param->name[series->name_len] == '\0' || series->name_len == SNIFFER_NAME_MAX)) {
+        pthread_mutex_unlock(&series_lock);
+        return series;
+    }
+
+    /* A replaced series is leaked on purpose, as queued samples and exporters may still point to it. */
+    series = malloc(sizeof(sniffer_series_t) + SNIFFER_KEY_MAX);
+    if (series == NULL) {
+        pthread_mutex_unlock(&series_lock);
+        return NULL;
+    }
+
+    series->node = param->node;
+    series->id = param->id;
+    series->name_len = strnlen(param->name, SNIFFER_NAME_MAX);
+    series->key_len = snprintf(series->key, SNIFFER_KEY_MAX, "%.*s{node=\"%u\", idx=\"", (int)series->name_len, param->name, param->node);
+
+    if (pycsh_ptrmap_set(&series_map, param, series) < 0) {
+        free(series);
+        series = NULL;
+    }
+
+    pthread_mutex_unlock(&series_lock);
+    return series;
+}
+
+/* Writes the decimal digits of the value, returning the end. Faster than snprintf() for the common integer samples. */
+static char * sniffer_utoa(char * out, uint64_t value) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+static char * sniffer_itoa(char * out, int64_t value) {
+    if (value < 0) {
+        *out++ = '-';
+        return sniffer_utoa(out, -(uint64_t)value);
+    }
+    return sniffer_utoa(out, value);
+}
+
+size_t sniffer_sample_value_str(const sniffer_sample_t * sample, char out[SNIFFER_VALUE_MAX]) {
+
+    char * end = out;
+
+    switch (sample->type) {
+        case PARAM_TYPE_UINT8:
+        case PARAM_TYPE_XINT8:
+        case PARAM_TYPE_UINT16:
+        case PARAM_TYPE_XINT16:
+        case PARAM_TYPE_UINT32:
+        case PARAM_TYPE_XINT32:
+        case PARAM_TYPE_UINT64:
+        case PARAM_TYPE_XINT64:
+            end = sniffer_utoa(out, sample->value.u);
+            break;
+        case PARAM_TYPE_INT8:
+        case PARAM_TYPE_INT16:
+        case PARAM_TYPE_INT32:
+        case PARAM_TYPE_INT64:
+            end = sniffer_itoa(out, sample->value.i);
+            break;
+        case PARAM_TYPE_FLOAT:
+            return snprintf(out, SNIFFER_VALUE_MAX, "%e", sample->value.f);
+        case PARAM_TYPE_DOUBLE:
+            return snprintf(out, SNIFFER_VALUE_MAX, "%.12e", sample->value.d);
+        default:
+            *end++ = '0';
+            break;
+    }
+
+    *end = '\0';
+    return end - out;
+}
+
+size_t sniffer_sample_line(const sniffer_sample_t * sample, char out[SNIFFER_LINE_MAX]) {
+
+    const sniffer_series_t * series = sample->series;
+    char * end = out;
+
+    memcpy(end, series->key, series->key_len);
+    end += series->key_len;
+    end = sniffer_utoa(end, sample->idx);
+    memcpy(end, "\"} ", 3);
+    end += 3;
+    end += sniffer_sample_value_str(sample, end);
+    *end++ = ' ';
+    end = sniffer_utoa(end, sample->time_ns / 1000000);
+    *end++ = '\n';
+    *end = '\0';
+
+    return end - out;
+}
@@ -0,0 +1,55 @@
+/*
+ * sniffer_sample.h
+ *
+ * Binary samples decoded by the parameter sniffer.
+ * The decoder only fills in these records, each sink renders them in its own format when it consumes them.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <param/param.h>
+
+/* Longest series key, longer parameter names are truncated. */
+#define SNIFFER_KEY_MAX 128
+/* Buffer size for sniffer_sample_value_str() */
+#define SNIFFER_VALUE_MAX 40
+/* Buffer size for sniffer_sample_line() */
+#define SNIFFER_LINE_MAX (SNIFFER_KEY_MAX + SNIFFER_VALUE_MAX + 40)
+
+/**
+ * Identity of a sniffed parameter, interned once per param_t.
+ * Never freed, so samples and exporters may keep pointers to it after the parameter is gone.
+ */
+typedef struct {
+    uint16_t node;
+    uint16_t id;
+    size_t name_len;
+    size_t key_len;
+    char key[];  // 'name{node="N", idx="', the name is the first 'name_len' characters.
+} sniffer_series_t;
+
+typedef struct {
+    const sniffer_series_t * series;
+    uint16_t node;
+    uint16_t id;
+    uint32_t idx;
+    uint8_t type;  // param_type_e, only numeric types are sampled.
+    union {
+        uint64_t u;
+        int64_t i;
+        float f;
+        double d;
+    } value;
+    uint64_t time_ns;  // Since the epoch
+} sniffer_sample_t;
+
+/* Returns the interned series of the parameter, NULL when out of memory. */
+const sniffer_series_t * sniffer_series_intern(const param_t * param);
+
+/* Formats the value as it appears in the exported metrics, returns the length. */
+size_t sniffer_sample_value_str(const sniffer_sample_t * sample, char out[SNIFFER_VALUE_MAX]);
+
+/* Renders the sample as a Prometheus text line (with a millisecond timestamp), returns the length. */
+size_t sniffer_sample_line(const sniffer_sample_t * sample, char out[SNIFFER_LINE_MAX]);
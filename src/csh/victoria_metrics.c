@@ -8,9 +8,16 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <dirent.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <curl/curl.h>
 
 #include <slash/slash.h>
@@ -19,7 +26,14 @@
 #include <csp/csp.h>
 #include <param/param_queue.h>
 #include <param/param_string.h>
+#include "pycshconfig.h"
+#ifdef PYCSH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "param_sniffer.h"
+#include "victoria_metrics.h"
+#include "../cleanup.h"
 
 static pthread_t vm_push_thread;
 int vm_running = 0;
@@ -27,11 +41,29 @@ int vm_running = 0;
 #define SERVER_PORT      8428
 #define SERVER_PORT_AUTH 8427
 #define BUFFER_SIZE      10 * 1024 * 1024
+#define SPOOL_DEFAULT_MAX_MB 256
+#define CONNECT_TIMEOUT_S 5   // Stalled requests fail into the spool, rather than blocking the push thread
+#define REQUEST_TIMEOUT_S 30
 
-static char buffer[BUFFER_SIZE];
+/* vm_add() fills the active buffer, while vm_push() sends the other one without holding the lock. */
+static char buffers[2][BUFFER_SIZE];
+static char * buffer = buffers[0];
 static size_t buffer_size = 0;
 static pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Counters of the push thread, printed by "vm stats" */
+static atomic_uint_fast64_t stat_pushed_batches = 0;
+static atomic_uint_fast64_t stat_pushed_bytes = 0;
+static atomic_uint_fast64_t stat_wire_bytes = 0;  // After encoding and compression
+static atomic_uint_fast64_t stat_failed_pushes = 0;
+static atomic_uint_fast64_t stat_dropped_lines = 0;
+static atomic_uint_fast64_t stat_spooled_batches = 0;
+static atomic_uint_fast64_t stat_replayed_batches = 0;
+static atomic_uint_fast64_t stat_spool_dropped_batches = 0;
+static atomic_uint_fast64_t stat_latency_last_us = 0;
+static atomic_uint_fast64_t stat_latency_max_us = 0;
+static atomic_uint_fast64_t stat_latency_total_us = 0;
+
 typedef struct {
     int use_ssl;
     int port;
@@ -40,12 +72,454 @@ typedef struct {
     char * username;
     char * password;
     char * server_ip;
+    char * spool_dir;
+    int spool_max_mb;
+    int gzip;
+    int json;
 } vm_args;
 
+/* Batches that failed to push, stored as one file per batch in 'dir', and replayed oldest first.
+    Only used by the push thread. */
+typedef struct {
+    char * dir;
+    size_t max_bytes;
+    size_t bytes;
+    uint64_t head;  // Oldest batch
+    uint64_t tail;  // Sequence number of the next batch
+} vm_spool_t;
+
 static size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
     return size * nmemb;
 }
 
+static void vm_spool_path(vm_spool_t * spool, uint64_t seq, char * out, size_t len) {
+    snprintf(out, len, "%s/%020"PRIu64".prom", spool->dir, seq);
+}
+
+/* Opens the spool directory, resuming batches spooled by a previous run. */
+static int vm_spool_open(vm_spool_t * spool, const char * dir, size_t max_bytes) {
+
+    *spool = (vm_spool_t){.max_bytes = max_bytes};
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        printf("Cannot create spool directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    DIR * d = opendir(dir);
+    if (d == NULL) {
+        printf("Cannot open spool directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    spool->dir = strdup(dir);
+    spool->head = UINT64_MAX;
+
+    struct dirent * entry;
+    while ((entry = readdir(d)) != NULL) {
+        uint64_t seq;
+        char suffix[8];
+        if (sscanf(entry->d_name, "%"SCNu64".%7s", &seq, suffix) != 2 || strcmp(suffix, "prom") != 0) {
+            continue;
+        }
+        char path[512];
+        struct stat st;
+        vm_spool_path(spool, seq, path, sizeof(path));
+        if (stat(path, &st) == 0) {
+            spool->bytes += st.st_size;
+        }
+        if (seq < spool->head) {
+            spool->head = seq;
+        }
+        if (seq + 1 > spool->tail) {
+            spool->tail = seq + 1;
+        }
+    }
+    closedir(d);
+
+    if (spool->head == UINT64_MAX) {
+        spool->head = spool->tail;
+    } else {
+        printf("Resuming %"PRIu64" spooled batches from %s\n", spool->tail - spool->head, dir);
+    }
+
+    return 0;
+}
+
+static int vm_spool_empty(vm_spool_t * spool) {
+    return spool->dir == NULL || spool->head == spool->tail;
+}
+
+/* Removes the oldest batch */
+static void vm_spool_pop(vm_spool_t * spool) {
+    char path[512];
+    struct stat st;
+    vm_spool_path(spool, spool->head, path, sizeof(path));
+    if (stat(path, &st) == 0) {
+        spool->bytes -= (st.st_size < (off_t)spool->bytes) ? st.st_size : spool->bytes;
+    }
+    unlink(path);
+    spool->head++;
+}
+
+/* Appends a batch, dropping the oldest batches when the spool is full. */
+static int vm_spool_push(vm_spool_t * spool, const char * data, size_t len) {
+
+    if (len > spool->max_bytes) {
+        atomic_fetch_add(&stat_spool_dropped_batches, 1);
+        return -1;
+    }
+
+    while (spool->bytes + len > spool->max_bytes && !vm_spool_empty(spool)) {
+        vm_spool_pop(spool);
+        atomic_fetch_add(&stat_spool_dropped_batches, 1);
+    }
+
+    char path[512];
+    char tmp_path[520];
+    vm_spool_path(spool, spool->tail, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    /* Written under a temporary name, so a crash never leaves a partial batch to replay. */
+    FILE * f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        atomic_fetch_add(&stat_spool_dropped_batches, 1);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, len, f);
+    if (fclose(f) != 0 || written != len || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        atomic_fetch_add(&stat_spool_dropped_batches, 1);
+        return -1;
+    }
+
+    spool->bytes += len;
+    spool->tail++;
+    atomic_fetch_add(&stat_spooled_batches, 1);
+    return 0;
+}
+
+/* Reads the oldest batch into 'out' (of BUFFER_SIZE bytes), skipping batches that have gone missing. */
+static int vm_spool_peek(vm_spool_t * spool, char * out, size_t * len) {
+
+    while (!vm_spool_empty(spool)) {
+        char path[512];
+        vm_spool_path(spool, spool->head, path, sizeof(path));
+        FILE * f = fopen(path, "rb");
+        if (f == NULL) {
+            spool->head++;
+            continue;
+        }
+        *len = fread(out, 1, BUFFER_SIZE, f);
+        fclose(f);
+        return 0;
+    }
+
+    return -1;
+}
+
+static uint64_t vm_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Growable output buffer for the encoders, 'failed' is set when out of memory. */
+typedef struct {
+    char * data;
+    size_t len;
+    size_t cap;
+    int failed;
+} vm_buf_t;
+
+static void vm_buf_append(vm_buf_t * buf, const char * str, size_t len) {
+    if (buf->failed) {
+        return;
+    }
+    if (buf->len + len > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 64 * 1024;
+        while (buf->len + len > cap) {
+            cap *= 2;
+        }
+        char * data = realloc(buf->data, cap);
+        if (data == NULL) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, str, len);
+    buf->len += len;
+}
+
+#define vm_buf_append_str(buf, str) vm_buf_append(buf, str, strlen(str))
+
+/* A sample line "series value timestamp", pointing into the batch. */
+typedef struct {
+    const char * series;
+    size_t series_len;
+    const char * value;
+    size_t value_len;
+    const char * timestamp;
+    size_t timestamp_len;
+    size_t order;  // Keeps samples of a series in the order they were added
+} vm_sample_t;
+
+static int vm_sample_compare(const void * a, const void * b) {
+    const vm_sample_t * x = a;
+    const vm_sample_t * y = b;
+    size_t len = x->series_len < y->series_len ? x->series_len : y->series_len;
+    int cmp = memcmp(x->series, y->series, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (x->series_len != y->series_len) {
+        return x->series_len < y->series_len ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+/* Writes the "metric" object of a series such as: name{node="1", idx="0"} */
+static void vm_encode_metric(vm_buf_t * out, const char * series, size_t len) {
+
+    const char * brace = memchr(series, '{', len);
+    size_t name_len = brace ? (size_t)(brace - series) : len;
+
+    vm_buf_append_str(out, "{\"metric\":{\"__name__\":\"");
+    vm_buf_append(out, series, name_len);
+    vm_buf_append_str(out, "\"");
+
+    const char * end = series + len;
+    const char * pos = brace ? brace + 1 : end;
+    while (pos < end) {
+        while (pos < end && (*pos == ' ' || *pos == ',')) {
+            pos++;
+        }
+        const char * eq = memchr(pos, '=', end - pos);
+        if (eq == NULL || eq + 1 >= end || eq[1] != '"') {
+            break;
+        }
+        const char * value = eq + 2;
+        const char * quote = memchr(value, '"', end - value);
+        if (quote == NULL) {
+            break;
+        }
+        vm_buf_append_str(out, ",\"");
+        vm_buf_append(out, pos, eq - pos);
+        vm_buf_append_str(out, "\":\"");
+        vm_buf_append(out, value, quote - value);
+        vm_buf_append_str(out, "\"");
+        pos = quote + 1;
+    }
+
+    vm_buf_append_str(out, "}");
+}
+
+/**
+ * @brief Converts Prometheus text lines to the JSON line format of /api/v1/import,
+ *  with one line per series holding all of its samples, so names and labels are only sent once per batch.
+ *
+ * Non-finite values can't be represented in JSON, so they are left out.
+ *
+ * @return char* malloc()'ed JSON lines, or NULL when out of memory.
+ */
+static char * vm_encode_json(const char * text, size_t len, size_t * out_len) {
+
+    size_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += (text[i] == '\n');
+    }
+
+    vm_sample_t * samples = malloc((lines + 1) * sizeof(vm_sample_t));
+    if (samples == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    const char * line = text;
+    const char * end = text + len;
+    while (line < end) {
+        const char * eol = memchr(line, '\n', end - line);
+        if (eol == NULL) {
+            eol = end;
+        }
+
+        /* Split from the end, as labels may contain spaces. */
+        const char * ts_space = eol - 1;
+        while (ts_space > line && *ts_space != ' ') {
+            ts_space--;
+        }
+        const char * value_space = ts_space - 1;
+        while (value_space > line && *value_space != ' ') {
+            value_space--;
+        }
+
+        if (value_space > line) {
+            vm_sample_t * sample = &samples[count];
+            sample->series = line;
+            sample->series_len = value_space - line;
+            sample->value = value_space + 1;
+            sample->value_len = ts_space - sample->value;
+            sample->timestamp = ts_space + 1;
+            sample->timestamp_len = eol - sample->timestamp;
+            sample->order = count;
+            char first = sample->value[sample->value_len > 1 && sample->value[0] == '-' ? 1 : 0];
+            if (first != 'n' && first != 'N' && first != 'i' && first != 'I') {
+                count++;
+            }
+        }
+
+        line = eol + 1;
+    }
+
+    qsort(samples, count, sizeof(vm_sample_t), vm_sample_compare);
+
+    vm_buf_t out = {0};
+    for (size_t start = 0; start < count && !out.failed;) {
+
+        size_t stop = start + 1;
+        while (stop < count && samples[stop].series_len == samples[start].series_len
+                && memcmp(samples[stop].series, samples[start].series, samples[start].series_len) == 0) {
+            stop++;
+        }
+
+        vm_encode_metric(&out, samples[start].series, samples[start].series_len);
+        vm_buf_append_str(&out, ",\"values\":[");
+        for (size_t i = start; i < stop; i++) {
+            if (i > start) {
+                vm_buf_append_str(&out, ",");
+            }
+            vm_buf_append(&out, samples[i].value, samples[i].value_len);
+        }
+        vm_buf_append_str(&out, "],\"timestamps\":[");
+        for (size_t i = start; i < stop; i++) {
+            if (i > start) {
+                vm_buf_append_str(&out, ",");
+            }
+            vm_buf_append(&out, samples[i].timestamp, samples[i].timestamp_len);
+        }
+        vm_buf_append_str(&out, "]}\n");
+
+        start = stop;
+    }
+
+    free(samples);
+
+    if (out.failed) {
+        free(out.data);
+        return NULL;
+    }
+
+    *out_len = out.len;
+    return out.data ? out.data : calloc(1, 1);
+}
+
+#ifdef PYCSH_HAVE_ZLIB
+/* Compresses the batch with gzip, returns a malloc()'ed buffer, or NULL on failure. */
+static char * vm_gzip(const char * data, size_t len, size_t * out_len) {
+
+    z_stream zs = {0};
+    /* 16 + MAX_WBITS selects the gzip wrapper. The backhaul is the bottleneck, so we favour ratio over speed. */
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+
+    uLong bound = deflateBound(&zs, len);
+    char * out = malloc(bound);
+    if (out != NULL) {
+        zs.next_in = (Bytef *)data;
+        zs.avail_in = len;
+        zs.next_out = (Bytef *)out;
+        zs.avail_out = bound;
+        if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+            *out_len = zs.total_out;
+        } else {
+            free(out);
+            out = NULL;
+        }
+    }
+
+    deflateEnd(&zs);
+    return out;
+}
+#endif
+
+/* POSTs a batch of metric lines, encoded as configured, returns 0 when it was accepted. */
+static int vm_post(CURL * curl, vm_args * args, const char * data, size_t len) {
+
+    const char * body = data;
+    size_t body_len = len;
+
+    char * json CLEANUP_STR = NULL;
+    if (args->json) {
+        json = vm_encode_json(body, body_len, &body_len);
+        if (json == NULL) {
+            atomic_fetch_add(&stat_failed_pushes, 1);
+            return -1;
+        }
+        body = json;
+    }
+
+#ifdef PYCSH_HAVE_ZLIB
+    char * compressed CLEANUP_STR = NULL;
+    if (args->gzip) {
+        compressed = vm_gzip(body, body_len, &body_len);
+        if (compressed == NULL) {
+            atomic_fetch_add(&stat_failed_pushes, 1);
+            return -1;
+        }
+        body = compressed;
+    }
+#endif
+
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body_len);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+
+    uint64_t start = vm_now_us();
+    CURLcode res = curl_easy_perform(curl);
+    uint64_t latency = vm_now_us() - start;
+
+    atomic_store(&stat_latency_last_us, latency);
+    atomic_fetch_add(&stat_latency_total_us, latency);
+    if (latency > atomic_load(&stat_latency_max_us)) {
+        atomic_store(&stat_latency_max_us, latency);  // Only the push thread writes it.
+    }
+
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    if (res != CURLE_OK || response_code < 200 || response_code >= 300) {
+        if (res != CURLE_OK) {
+            printf("Failed push: %s\n", curl_easy_strerror(res));
+        } else {
+            printf("Failed push with response code: %ld\n", response_code);
+        }
+        atomic_fetch_add(&stat_failed_pushes, 1);
+        return -1;
+    }
+
+    atomic_fetch_add(&stat_pushed_batches, 1);
+    atomic_fetch_add(&stat_pushed_bytes, len);
+    atomic_fetch_add(&stat_wire_bytes, body_len);
+    return 0;
+}
+
+/* Replays spooled batches oldest first, until the spool is empty or a push fails. */
+static int vm_spool_replay(vm_spool_t * spool, CURL * curl, vm_args * args, char * scratch) {
+
+    size_t len;
+    while (vm_running && vm_spool_peek(spool, scratch, &len) == 0) {
+        if (vm_post(curl, args, scratch, len) < 0) {
+            return -1;
+        }
+        vm_spool_pop(spool);
+        atomic_fetch_add(&stat_replayed_batches, 1);
+    }
+
+    return 0;
+}
+
 void * vm_push(void * arg) {
 
     vm_args * args = arg;
@@ -53,6 +527,7 @@ void * vm_push(void * arg) {
     CURL * curl;
     CURLcode res;
     struct curl_slist * headers = NULL;
+    int connected = 1;
 
     curl = curl_easy_init();
     const char * hostname = csp_get_conf()->hostname;
@@ -73,6 +548,9 @@ void * vm_push(void * arg) {
         }else
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
 
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);  // Timeouts must not raise signals in our thread.
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)CONNECT_TIMEOUT_S);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)REQUEST_TIMEOUT_S);
 
         if (args->username && args->password) {
             curl_easy_setopt(curl, CURLOPT_USERNAME, args->username);
@@ -86,21 +564,33 @@ void * vm_push(void * arg) {
         curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "query=test42");
         curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 12);
         res = curl_easy_perform(curl);
+        long response_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
         if (res != CURLE_OK) {
             printf("Failed test of connection: %s\n", curl_easy_strerror(res));
-            vm_running = 0;
-        }
-        long response_code;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200 && res == CURLE_OK) {
+            connected = 0;
+        } else if (response_code != 200) {
             printf("Failed test with response code: %ld\n", response_code);
+            connected = 0;
+        }
+
+        /* With a spool, we keep running and spool until the server is reachable. */
+        if (!connected && args->spool_dir == NULL) {
             vm_running = 0;
         }
 
         // Resume building of header for push
-        snprintf(url, sizeof(url), "%s://%s:%d/api/v1/import/prometheus?extra_label=instance=%s", protocol, args->server_ip, args->port, hostname);
+        if (args->json) {
+            snprintf(url, sizeof(url), "%s://%s:%d/api/v1/import?extra_label=instance=%s", protocol, args->server_ip, args->port, hostname);
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+        } else {
+            snprintf(url, sizeof(url), "%s://%s:%d/api/v1/import/prometheus?extra_label=instance=%s", protocol, args->server_ip, args->port, hostname);
+            headers = curl_slist_append(headers, "Content-Type: text/plain");
+        }
+        if (args->gzip) {
+            headers = curl_slist_append(headers, "Content-Encoding: gzip");
+        }
         curl_easy_setopt(curl, CURLOPT_URL, url);
-        headers = curl_slist_append(headers, "Content-Type: text/plain");
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
         if (args->verbose) {
@@ -112,34 +602,75 @@ void * vm_push(void * arg) {
         printf("curl_easy_init() failed\n");
     }
 
-    if (vm_running) {
+    vm_spool_t spool = {0};
+    char * scratch = NULL;  // Replayed batches are read into this
+    if (vm_running && args->spool_dir) {
+        scratch = malloc(BUFFER_SIZE);
+        if (scratch == NULL || vm_spool_open(&spool, args->spool_dir, (size_t)args->spool_max_mb * 1024 * 1024) < 0) {
+            free(scratch);
+            scratch = NULL;
+            free(spool.dir);
+            spool.dir = NULL;
+            if (!connected) {
+                vm_running = 0;  // Nowhere to put batches
+            }
+        }
+    }
+
+    if (vm_running && connected) {
         printf("Connection established to %s://%s:%d\n", protocol, args->server_ip, args->port);
+    } else if (vm_running) {
+        printf("Spooling to %s until %s://%s:%d is reachable\n", spool.dir, protocol, args->server_ip, args->port);
     }
 
+    /* Batch being pushed, not accessed by vm_add() */
+    char * sending = NULL;
+    size_t sending_size = 0;
+
     while (vm_running) {
-        // Lock the buffer mutex
-        pthread_mutex_lock(&buffer_mutex);
-        if (buffer_size == 0) {
-            pthread_mutex_unlock(&buffer_mutex);
-            sleep(1);
-            continue;
-        }
 
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, buffer_size);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, buffer);
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            printf("Failed push: %s\n", curl_easy_strerror(res));
-        } else {
+        /* Only swap when the previous batch is out of our hands, otherwise it's retried first. */
+        if (sending_size == 0) {
+            pthread_mutex_lock(&buffer_mutex);
+            sending = buffer;
+            sending_size = buffer_size;
+            buffer = (buffer == buffers[0]) ? buffers[1] : buffers[0];
             buffer_size = 0;
+            pthread_mutex_unlock(&buffer_mutex);
         }
 
-        // Unlock the buffer mutex
-        pthread_mutex_unlock(&buffer_mutex);
+        /* Batches are pushed in order, so new batches wait behind spooled ones. */
+        if (!vm_spool_empty(&spool)) {
+            if (sending_size > 0) {
+                vm_spool_push(&spool, sending, sending_size);
+                sending_size = 0;
+            }
+            vm_spool_replay(&spool, curl, args, scratch);
+        } else if (sending_size > 0) {
+            if (vm_post(curl, args, sending, sending_size) == 0) {
+                sending_size = 0;
+            } else if (spool.dir != NULL) {
+                vm_spool_push(&spool, sending, sending_size);
+                sending_size = 0;
+            }
+        }
 
         sleep(1);
     }
 
+    /* Keep what we couldn't push for the next run. */
+    if (spool.dir != NULL) {
+        if (sending_size > 0) {
+            vm_spool_push(&spool, sending, sending_size);
+        }
+        pthread_mutex_lock(&buffer_mutex);
+        if (buffer_size > 0) {
+            vm_spool_push(&spool, buffer, buffer_size);
+            buffer_size = 0;
+        }
+        pthread_mutex_unlock(&buffer_mutex);
+    }
+
     printf("vm push stopped\n");
     // Clean up
     if (curl) {
@@ -148,6 +679,8 @@ void * vm_push(void * arg) {
     if (headers) {
         curl_slist_free_all(headers);
     }
+    free(scratch);
+    free(spool.dir);
     if (args->username) {
         free(args->username);
         args->username = NULL;
@@ -160,27 +693,43 @@ void * vm_push(void * arg) {
         free(args->server_ip);
         args->server_ip = NULL;
     }
+    if (args->spool_dir) {
+        free(args->spool_dir);
+        args->spool_dir = NULL;
+    }
     free(args);
     return NULL;
 }
 
-void vm_add(char * metric_line) {
+static void vm_append(const char * metric_line, size_t line_len) {
 
     // Lock the buffer mutex
     pthread_mutex_lock(&buffer_mutex);
 
     // Check if there's enough space in the buffer
-    size_t line_len = strlen(metric_line);
     if (buffer_size + line_len < BUFFER_SIZE) {
         // Add the new metric line to the buffer
-        strcpy(buffer + buffer_size, metric_line);
+        memcpy(buffer + buffer_size, metric_line, line_len);
         buffer_size += line_len;
+    } else {
+        atomic_fetch_add(&stat_dropped_lines, 1);
     }
 
     // Unlock the buffer mutex
     pthread_mutex_unlock(&buffer_mutex);
 }
 
+void vm_add(char * metric_line) {
+    vm_append(metric_line, strlen(metric_line));
+}
+
+void vm_add_sample(const sniffer_sample_t * sample) {
+    /* Rendered before taking the lock, so the push thread is held up by a copy at most. */
+    char line[SNIFFER_LINE_MAX];
+    size_t len = sniffer_sample_line(sample, line);
+    vm_append(line, len);
+}
+
 void vm_add_param(param_t * param) {
 
     if(param->type == PARAM_TYPE_STRING || param->type == PARAM_TYPE_DATA){
@@ -221,6 +770,12 @@ static int vm_start_cmd(struct slash * slash) {
     optparse_add_set(parser, 'l', "logfile", 1, &logfile, "Enable logging to param_sniffer.log");
     optparse_add_set(parser, 'S', "skip-verify", 1, &(args->skip_verify), "Skip verification of the server's cert and hostname");
     optparse_add_set(parser, 'v', "verbose", 1, &(args->verbose), "Verbose connect");
+    char * tmp_spool_dir = NULL;
+    args->spool_max_mb = SPOOL_DEFAULT_MAX_MB;
+    optparse_add_string(parser, 'd', "spool", "DIR", &tmp_spool_dir, "Spool failed pushes to DIR, also when the server is unreachable at start, and replay them when it is back");
+    optparse_add_int(parser, 'm', "spool-max", "MB", 0, &(args->spool_max_mb), "Size limit of the spool, oldest batches are dropped first (default = 256)");
+    optparse_add_set(parser, 'z', "gzip", 1, &(args->gzip), "Compress pushes with gzip");
+    optparse_add_set(parser, 'j', "json", 1, &(args->json), "Push one JSON line per series to /api/v1/import, instead of one text line per sample");
 
     int argi = optparse_parse(parser, slash->argc - 1, (const char **)slash->argv + 1);
 
@@ -230,6 +785,13 @@ static int vm_start_cmd(struct slash * slash) {
         return SLASH_EINVAL;
     }
 
+#ifndef PYCSH_HAVE_ZLIB
+    if (args->gzip) {
+        printf("Built without zlib, pushing uncompressed\n");
+        args->gzip = 0;
+    }
+#endif
+
     if (++argi >= slash->argc) {
         printf("Missing server ip/domain\n");
         optparse_del(parser);
@@ -253,6 +815,9 @@ static int vm_start_cmd(struct slash * slash) {
         args->port = SERVER_PORT;
     }
     args->server_ip = strdup(slash->argv[argi]);
+    if (tmp_spool_dir) {
+        args->spool_dir = strdup(tmp_spool_dir);
+    }
 
     param_sniffer_init(logfile);
     pthread_create(&vm_push_thread, NULL, &vm_push, args);
@@ -272,3 +837,24 @@ static int vm_stop_cmd(struct slash * slash) {
     return SLASH_SUCCESS;
 }
 slash_command_sub(vm, stop, vm_stop_cmd, "", "Stop Victoria Metrics push thread");
+
+static int vm_stats_cmd(struct slash * slash) {
+
+    uint64_t pushed = atomic_load(&stat_pushed_batches);
+    uint64_t failed = atomic_load(&stat_failed_pushes);
+    uint64_t posts = pushed + failed;
+
+    printf("Pushed batches:         %"PRIuFAST64" (%"PRIuFAST64" bytes, %"PRIuFAST64" on the wire)\n", pushed, atomic_load(&stat_pushed_bytes), atomic_load(&stat_wire_bytes));
+    printf("Failed pushes:          %"PRIuFAST64"\n", failed);
+    printf("Dropped lines:          %"PRIuFAST64"\n", atomic_load(&stat_dropped_lines));
+    printf("Spooled batches:        %"PRIuFAST64"\n", atomic_load(&stat_spooled_batches));
+    printf("Replayed batches:       %"PRIuFAST64"\n", atomic_load(&stat_replayed_batches));
+    printf("Spool dropped batches:  %"PRIuFAST64"\n", atomic_load(&stat_spool_dropped_batches));
+    printf("Push latency last/avg/max: %.1f / %.1f / %.1f ms\n",
+        atomic_load(&stat_latency_last_us) / 1e3,
+        posts ? atomic_load(&stat_latency_total_us) / 1e3 / posts : 0.0,
+        atomic_load(&stat_latency_max_us) / 1e3);
+
+    return SLASH_SUCCESS;
+}
+slash_command_sub(vm, stats, vm_stats_cmd, "", "Show Victoria Metrics push counters");
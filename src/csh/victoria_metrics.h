@@ -7,6 +7,9 @@
 #pragma once
 
 #include <param/param.h>
+#include "sniffer_sample.h"
 
 void vm_add(char * metric_line);
 void vm_add_param(param_t * param);
+/* Renders the sample straight into the pending batch. */
+void vm_add_sample(const sniffer_sample_t * sample);
@@ -0,0 +1,97 @@
+/*
+ * param_cache.c
+ *
+ * Tracks when the cached value of remote parameters was last received.
+ *
+ */
+
+#include "param_cache.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "pointer_map.h"
+#include "param_history.h"
+
+/* param_t * -> receive time, protected by cache_lock.
+	The double is stored in the value pointer itself, to avoid an allocation per parameter. */
+static pycsh_ptrmap_t cache_map;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_int cache_sniffed = 0;
+
+static atomic_uint_fast64_t cache_hits = 0;
+static atomic_uint_fast64_t cache_misses = 0;
+
+_Static_assert(sizeof(double) <= sizeof(void *), "Receive times are stored in pointers");
+
+static inline void * cache_pack(double timestamp) {
+	void * packed = NULL;
+	memcpy(&packed, &timestamp, sizeof(timestamp));
+	return packed;
+}
+
+static inline double cache_unpack(void * packed) {
+	double timestamp;
+	memcpy(&timestamp, &packed, sizeof(timestamp));
+	return timestamp;
+}
+
+void pycsh_param_cache_set_sniffed(int enable) {
+	atomic_store(&cache_sniffed, enable != 0);
+}
+
+int pycsh_param_cache_get_sniffed(void) {
+	return atomic_load(&cache_sniffed);
+}
+
+void pycsh_param_cache_touch(const param_t * param, double timestamp) {
+	/* NULL means "not present" to the map, which is the packed value of 0.0 */
+	if (timestamp <= 0)
+		return;
+	pthread_mutex_lock(&cache_lock);
+	pycsh_ptrmap_set(&cache_map, param, cache_pack(timestamp));  // Fails only when out of memory, the next read is then just a miss.
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void pycsh_param_cache_remove(const param_t * param) {
+	pthread_mutex_lock(&cache_lock);
+	pycsh_ptrmap_remove(&cache_map, param);
+	pthread_mutex_unlock(&cache_lock);
+}
+
+double pycsh_param_cache_received(const param_t * param) {
+
+	pthread_mutex_lock(&cache_lock);
+	double received = cache_unpack(pycsh_ptrmap_get(&cache_map, param));
+	pthread_mutex_unlock(&cache_lock);
+
+	if (received <= 0 && param->timestamp != NULL)
+		received = *param->timestamp;
+
+	return received > 0 ? received : 0;
+}
+
+int pycsh_param_cache_fresh(const param_t * param, double max_age) {
+
+	double received = pycsh_param_cache_received(param);
+
+	if (received > 0 && pycsh_param_history_now() - received <= max_age) {
+		atomic_fetch_add(&cache_hits, 1);
+		return 1;
+	}
+
+	atomic_fetch_add(&cache_misses, 1);
+	return 0;
+}
+
+void pycsh_param_cache_counters(uint64_t * hits, uint64_t * misses, int reset) {
+	if (reset) {
+		*hits = atomic_exchange(&cache_hits, 0);
+		*misses = atomic_exchange(&cache_misses, 0);
+	} else {
+		*hits = atomic_load(&cache_hits);
+		*misses = atomic_load(&cache_misses);
+	}
+}
@@ -0,0 +1,39 @@
+/*
+ * param_cache.h
+ *
+ * Tracks when the cached value of remote parameters was last received,
+ * such that reads with a max age may be served without a round trip.
+ *
+ * Thread-safe, and does not require the GIL, so it may be fed from the sniffer threads.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <param/param.h>
+
+/* Marks every index of the cached value as received at 'timestamp' (seconds since the epoch). */
+void pycsh_param_cache_touch(const param_t * param, double timestamp);
+
+/* Forgets the receive time of a param_t, must be called before it is destroyed. */
+void pycsh_param_cache_remove(const param_t * param);
+
+/* Time (seconds since the epoch) the cached value was last received,
+	the (remote) *param->timestamp when not known locally, or 0 when neither is known. */
+double pycsh_param_cache_received(const param_t * param);
+
+/**
+ * @brief Check whether the cached value is at most 'max_age' seconds old, counting a hit or miss.
+ *
+ * The local receive time is used when known, otherwise the (remote) *param->timestamp.
+ *
+ * @return int 1 when the cached value may be used, 0 when it must be pulled.
+ */
+int pycsh_param_cache_fresh(const param_t * param, double max_age);
+
+/* Whether the parameter sniffer writes sniffed values of remote parameters to their cached value, disabled by default. */
+void pycsh_param_cache_set_sniffed(int enable);
+int pycsh_param_cache_get_sniffed(void);
+
+/* Hit and miss counts of pycsh_param_cache_fresh() */
+void pycsh_param_cache_counters(uint64_t * hits, uint64_t * misses, int reset);
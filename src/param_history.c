@@ -0,0 +1,331 @@
+/*
+ * param_history.c
+ *
+ * Optional bounded ring buffer of timestamped values per param_t.
+ *
+ */
+
+#include "param_history.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "pointer_map.h"
+
+typedef struct {
+	size_t capacity;  // In samples
+	size_t head;  // Index of the next sample to write
+	size_t count;
+	size_t typesize;
+	int array_size;
+	size_t rowsize;  // typesize * array_size
+	double * timestamps;
+	uint8_t * values;  // capacity rows of rowsize bytes
+} param_history_t;
+
+/* param_t * -> param_history_t *, protected by history_lock. */
+static pycsh_ptrmap_t history_map;
+static pthread_mutex_t history_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t history_used = 0;
+static size_t history_limit = PYCSH_HISTORY_DEFAULT_LIMIT;
+
+/* Number of histories, allows recording to skip the lock when there are none. */
+static atomic_size_t history_active = 0;
+
+static size_t history_bytes(size_t capacity, size_t rowsize) {
+	if (capacity == 0)
+		return 0;
+	return sizeof(param_history_t) + capacity * (sizeof(double) + rowsize);
+}
+
+static void history_free(param_history_t * history) {
+	if (history == NULL)
+		return;
+	history_used -= history_bytes(history->capacity, history->rowsize);
+	free(history->timestamps);
+	free(history->values);
+	free(history);
+	atomic_fetch_sub(&history_active, 1);
+}
+
+static int history_supported_type(param_type_e type) {
+	switch (type) {
+		case PARAM_TYPE_STRING:
+		case PARAM_TYPE_DATA:
+		case PARAM_TYPE_INVALID:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
+/* Index of the i'th oldest sample. */
+static inline size_t history_index(const param_history_t * history, size_t i) {
+	return (history->head + history->capacity - history->count + i) % history->capacity;
+}
+
+double pycsh_param_history_now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int pycsh_param_history_resize(param_t * param, size_t capacity) {
+
+	if (capacity > 0 && !history_supported_type(param->type))
+		return -3;
+
+	pthread_mutex_lock(&history_lock);
+
+	param_history_t * old = pycsh_ptrmap_get(&history_map, param);
+
+	if (capacity == 0) {
+		pycsh_ptrmap_remove(&history_map, param);
+		history_free(old);
+		pthread_mutex_unlock(&history_lock);
+		return 0;
+	}
+
+	size_t typesize = param_typesize(param->type);
+	int array_size = param->array_size > 1 ? param->array_size : 1;
+	size_t rowsize = typesize * array_size;
+
+	size_t old_bytes = old ? history_bytes(old->capacity, old->rowsize) : 0;
+	size_t new_bytes = history_bytes(capacity, rowsize);
+	if (history_used - old_bytes + new_bytes > history_limit) {
+		pthread_mutex_unlock(&history_lock);
+		return -2;
+	}
+
+	param_history_t * history = calloc(1, sizeof(param_history_t));
+	double * timestamps = calloc(capacity, sizeof(double));
+	uint8_t * values = calloc(capacity, rowsize);
+	if (history == NULL || timestamps == NULL || values == NULL || pycsh_ptrmap_set(&history_map, param, history) < 0) {
+		free(history);
+		free(timestamps);
+		free(values);
+		pthread_mutex_unlock(&history_lock);
+		return -1;
+	}
+
+	*history = (param_history_t){
+		.capacity = capacity,
+		.typesize = typesize,
+		.array_size = array_size,
+		.rowsize = rowsize,
+		.timestamps = timestamps,
+		.values = values,
+	};
+
+	/* Keep the newest samples, unless the layout of the parameter has changed. */
+	if (old && old->rowsize == rowsize) {
+		size_t keep = old->count < capacity ? old->count : capacity;
+		for (size_t i = 0; i < keep; i++) {
+			size_t src = history_index(old, old->count - keep + i);
+			timestamps[i] = old->timestamps[src];
+			memcpy(&values[i * rowsize], &old->values[src * rowsize], rowsize);
+		}
+		history->count = keep;
+		history->head = keep % capacity;
+	}
+
+	atomic_fetch_add(&history_active, 1);
+	history_used += new_bytes;
+	history_free(old);
+
+	pthread_mutex_unlock(&history_lock);
+	return 0;
+}
+
+size_t pycsh_param_history_capacity(const param_t * param) {
+	pthread_mutex_lock(&history_lock);
+	param_history_t * history = pycsh_ptrmap_get(&history_map, param);
+	size_t capacity = history ? history->capacity : 0;
+	pthread_mutex_unlock(&history_lock);
+	return capacity;
+}
+
+void pycsh_param_history_remove(const param_t * param) {
+	if (atomic_load(&history_active) == 0)
+		return;
+	pthread_mutex_lock(&history_lock);
+	history_free(pycsh_ptrmap_remove(&history_map, param));
+	pthread_mutex_unlock(&history_lock);
+}
+
+void pycsh_param_history_set_limit(size_t bytes) {
+	pthread_mutex_lock(&history_lock);
+	history_limit = bytes;
+	pthread_mutex_unlock(&history_lock);
+}
+
+size_t pycsh_param_history_get_limit(void) {
+	pthread_mutex_lock(&history_lock);
+	size_t limit = history_limit;
+	pthread_mutex_unlock(&history_lock);
+	return limit;
+}
+
+size_t pycsh_param_history_used(void) {
+	pthread_mutex_lock(&history_lock);
+	size_t used = history_used;
+	pthread_mutex_unlock(&history_lock);
+	return used;
+}
+
+void pycsh_param_history_record(const param_t * param, int offset, int count, const void * values, size_t stride, double timestamp) {
+
+	if (atomic_load(&history_active) == 0)
+		return;
+
+	if (offset < 0)
+		offset = 0;
+
+	pthread_mutex_lock(&history_lock);
+
+	param_history_t * history = pycsh_ptrmap_get(&history_map, param);
+	/* The layout may differ if the param_t was freed and another allocated in its place. */
+	if (history == NULL || history->typesize != (size_t)param_typesize(param->type)) {
+		pthread_mutex_unlock(&history_lock);
+		return;
+	}
+
+	uint8_t * row = &history->values[history->head * history->rowsize];
+
+	/* Carry the indexes we are not writing over from the previous sample. */
+	if (history->count > 0) {
+		size_t prev = (history->head + history->capacity - 1) % history->capacity;
+		if (prev != history->head)
+			memcpy(row, &history->values[prev * history->rowsize], history->rowsize);
+	} else {
+		memset(row, 0, history->rowsize);
+	}
+
+	const uint8_t * src = values;
+	for (int i = offset; i < offset + count && i < history->array_size; i++, src += stride) {
+		memcpy(&row[i * history->typesize], src, history->typesize);
+	}
+
+	history->timestamps[history->head] = timestamp;
+	history->head = (history->head + 1) % history->capacity;
+	if (history->count < history->capacity)
+		history->count++;
+
+	pthread_mutex_unlock(&history_lock);
+}
+
+void pycsh_param_history_record_cached(param_t * param, int offset, int count, double timestamp) {
+
+	if (atomic_load(&history_active) == 0 || pycsh_param_history_capacity(param) == 0)
+		return;
+
+	if (offset < 0) {
+		offset = 0;
+		count = param->array_size > 1 ? param->array_size : 1;
+	}
+
+	size_t typesize = param_typesize(param->type);
+	uint8_t * values = malloc(count * typesize);
+	if (values == NULL)
+		return;
+
+	for (int i = 0; i < count; i++) {
+		void * dst = &values[i * typesize];
+		unsigned int index = offset + i;
+		switch (param->type) {
+			case PARAM_TYPE_UINT8:
+			case PARAM_TYPE_XINT8:
+				*(uint8_t *)dst = param_get_uint8_array(param, index);
+				break;
+			case PARAM_TYPE_UINT16:
+			case PARAM_TYPE_XINT16:
+				*(uint16_t *)dst = param_get_uint16_array(param, index);
+				break;
+			case PARAM_TYPE_UINT32:
+			case PARAM_TYPE_XINT32:
+				*(uint32_t *)dst = param_get_uint32_array(param, index);
+				break;
+			case PARAM_TYPE_UINT64:
+			case PARAM_TYPE_XINT64:
+				*(uint64_t *)dst = param_get_uint64_array(param, index);
+				break;
+			case PARAM_TYPE_INT8:
+				*(int8_t *)dst = param_get_int8_array(param, index);
+				break;
+			case PARAM_TYPE_INT16:
+				*(int16_t *)dst = param_get_int16_array(param, index);
+				break;
+			case PARAM_TYPE_INT32:
+				*(int32_t *)dst = param_get_int32_array(param, index);
+				break;
+			case PARAM_TYPE_INT64:
+				*(int64_t *)dst = param_get_int64_array(param, index);
+				break;
+			case PARAM_TYPE_FLOAT:
+				*(float *)dst = param_get_float_array(param, index);
+				break;
+			case PARAM_TYPE_DOUBLE:
+				*(double *)dst = param_get_double_array(param, index);
+				break;
+			default:
+				free(values);
+				return;
+		}
+	}
+
+	pycsh_param_history_record(param, offset, count, values, typesize, timestamp);
+	free(values);
+}
+
+long pycsh_param_history_copy(const param_t * param, double since, size_t max, double ** timestamps_out, void ** values_out) {
+
+	pthread_mutex_lock(&history_lock);
+
+	param_history_t * history = pycsh_ptrmap_get(&history_map, param);
+	if (history == NULL) {
+		pthread_mutex_unlock(&history_lock);
+		return -2;
+	}
+
+	/* Sniffed timestamps are not necessarily ordered, so filter every sample. */
+	size_t matching = 0;
+	for (size_t i = 0; i < history->count; i++) {
+		if (history->timestamps[history_index(history, i)] >= since)
+			matching++;
+	}
+	size_t skip = (max > 0 && matching > max) ? matching - max : 0;
+	size_t n = matching - skip;
+
+	double * timestamps = malloc((n ? n : 1) * sizeof(double));
+	uint8_t * values = malloc((n ? n : 1) * history->rowsize);
+	if (timestamps == NULL || values == NULL) {
+		free(timestamps);
+		free(values);
+		pthread_mutex_unlock(&history_lock);
+		return -1;
+	}
+
+	size_t out = 0;
+	for (size_t i = 0; i < history->count && out < n; i++) {
+		size_t index = history_index(history, i);
+		if (history->timestamps[index] < since)
+			continue;
+		if (skip > 0) {
+			skip--;
+			continue;
+		}
+		timestamps[out] = history->timestamps[index];
+		memcpy(&values[out * history->rowsize], &history->values[index * history->rowsize], history->rowsize);
+		out++;
+	}
+
+	pthread_mutex_unlock(&history_lock);
+
+	*timestamps_out = timestamps;
+	*values_out = values;
+	return out;
+}
@@ -0,0 +1,69 @@
+/*
+ * param_history.h
+ *
+ * Optional bounded ring buffer of timestamped values per param_t.
+ *
+ * Each sample holds a full row of the parameter (every array index),
+ * writes to only some indexes carry the remaining indexes over from the previous sample.
+ * Only numeric parameter types are supported.
+ *
+ * Thread-safe, and does not require the GIL, so it may be fed from the sniffer threads.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <param/param.h>
+
+/* Default for pycsh_param_history_set_limit(), in bytes. */
+#define PYCSH_HISTORY_DEFAULT_LIMIT (64 * 1024 * 1024)
+
+/**
+ * @brief Set the number of samples kept for the parameter, keeping the newest existing samples.
+ *
+ * @param capacity 0 disables (and frees) the history of the parameter.
+ * @return int 0 on success, -1 when out of memory, -2 when exceeding the global limit, -3 for unsupported types.
+ */
+int pycsh_param_history_resize(param_t * param, size_t capacity);
+
+/* Number of samples the parameter keeps, 0 when disabled. */
+size_t pycsh_param_history_capacity(const param_t * param);
+
+/* Frees the history of a param_t, must be called before it is destroyed. */
+void pycsh_param_history_remove(const param_t * param);
+
+/* Global limit (in bytes) of the memory used by all histories, only checked when resizing. */
+void pycsh_param_history_set_limit(size_t bytes);
+size_t pycsh_param_history_get_limit(void);
+
+/* Bytes currently used by all histories. */
+size_t pycsh_param_history_used(void);
+
+/**
+ * @brief Append a sample, where 'count' indexes starting at 'offset' are set from 'values'.
+ *
+ * Cheap no-op when no parameter has a history.
+ *
+ * @param offset First index, <0 is treated as 0.
+ * @param values Values of the C type of the parameter.
+ * @param stride Bytes between consecutive values, 0 sets every index to the same value.
+ * @param timestamp Seconds since the epoch.
+ */
+void pycsh_param_history_record(const param_t * param, int offset, int count, const void * values, size_t stride, double timestamp);
+
+/* Append a sample with the cached values of 'count' indexes starting at 'offset' (<0 for every index).
+	Reads the values through param_get_*(), so should only be used for remote parameters. */
+void pycsh_param_history_record_cached(param_t * param, int offset, int count, double timestamp);
+
+/* Current time in seconds since the epoch, for pycsh_param_history_record(). */
+double pycsh_param_history_now(void);
+
+/**
+ * @brief Copy the samples with a timestamp >= since, oldest first.
+ *
+ * @param max Only copy the newest 'max' samples, 0 for no limit.
+ * @param timestamps_out malloc()'ed array of 'count' timestamps, to be free()'d by the caller.
+ * @param values_out malloc()'ed array of 'count' rows of 'array_size' values, to be free()'d by the caller.
+ * @return long Number of samples copied, -1 when out of memory, -2 when the parameter has no history.
+ */
+long pycsh_param_history_copy(const param_t * param, double since, size_t max, double ** timestamps_out, void ** values_out);
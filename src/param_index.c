@@ -0,0 +1,353 @@
+/*
+ * param_index.c
+ *
+ * Hash index of the parameter list, for O(1) lookups by (node, id) and (node, name).
+ *
+ */
+
+#include "param_index.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <param/param_list.h>
+
+#include "pycshconfig.h"
+
+/* Marks a removed entry, so probing continues past it. */
+#define INDEX_TOMBSTONE ((param_t *)1)
+#define INDEX_MIN_CAPACITY 64
+
+/* In an APM, CSH and other APMs change the list without telling us, so hits are checked against the list before use. */
+#ifdef PYCSH_HAVE_APM
+#define INDEX_VERIFY_HITS 1
+#else
+#define INDEX_VERIFY_HITS 0
+#endif
+
+/* Keys are copied from the param_t when indexed, so probing never dereferences a param_t that may have been freed. */
+typedef struct {
+	param_t * param;  // NULL when empty, INDEX_TOMBSTONE when removed
+	int node;
+	int id;
+	char * name;  // Own copy, only used by by_name
+} index_entry_t;
+
+/* Open addressing with linear probing, capacity is always a power of 2. */
+typedef struct {
+	index_entry_t * slots;
+	size_t capacity;
+	size_t used;  // Including tombstones
+} index_table_t;
+
+static index_table_t by_id;
+static index_table_t by_name;
+
+/* Rebuilt from the list on the next lookup when false. */
+static bool index_valid = false;
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static inline uint64_t index_mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static inline uint64_t index_hash_id(int node, int id) {
+	return index_mix(((uint64_t)(uint32_t)node << 32) | (uint32_t)id);
+}
+
+static inline uint64_t index_hash_name(int node, const char * name) {
+	uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a
+	for (; *name; name++) {
+		h ^= (uint8_t)*name;
+		h *= 0x100000001b3ULL;
+	}
+	return index_mix(h ^ (uint32_t)node);
+}
+
+static inline uint64_t index_hash_entry(const index_table_t * table, const index_entry_t * entry) {
+	return (table == &by_id) ? index_hash_id(entry->node, entry->id) : index_hash_name(entry->node, entry->name);
+}
+
+static inline bool index_entry_live(const index_entry_t * entry) {
+	return entry->param != NULL && entry->param != INDEX_TOMBSTONE;
+}
+
+static void index_table_clear(index_table_t * table) {
+	for (size_t i = 0; i < table->capacity; i++) {
+		free(table->slots[i].name);
+		table->slots[i] = (index_entry_t){0};
+	}
+	table->used = 0;
+}
+
+/* Places the entry (taking over its name) in a free slot, there must be room for it. */
+static void index_table_place(index_table_t * table, index_entry_t entry) {
+	size_t mask = table->capacity - 1;
+	for (size_t i = index_hash_entry(table, &entry) & mask;; i = (i + 1) & mask) {
+		if (table->slots[i].param == NULL) {
+			table->slots[i] = entry;
+			table->used++;
+			return;
+		}
+	}
+}
+
+static bool index_table_grow(index_table_t * table) {
+
+	index_table_t old = *table;
+
+	/* Tombstones are dropped by rehashing, so only grow when the live entries need it. */
+	size_t live = 0;
+	for (size_t i = 0; i < old.capacity; i++) {
+		live += index_entry_live(&old.slots[i]);
+	}
+
+	size_t capacity = INDEX_MIN_CAPACITY;
+	while ((live + 1) * 2 > capacity) {
+		capacity *= 2;
+	}
+	index_entry_t * slots = calloc(capacity, sizeof(index_entry_t));
+	if (slots == NULL) {
+		return false;
+	}
+
+	table->slots = slots;
+	table->capacity = capacity;
+	table->used = 0;
+
+	for (size_t i = 0; i < old.capacity; i++) {
+		if (index_entry_live(&old.slots[i])) {
+			index_table_place(table, old.slots[i]);
+		} else {
+			free(old.slots[i].name);
+		}
+	}
+
+	free(old.slots);
+	return true;
+}
+
+static bool index_table_insert(index_table_t * table, param_t * param) {
+
+	/* Keep the load factor (including tombstones) below 3/4 */
+	if ((table->used + 1) * 4 > table->capacity * 3 && !index_table_grow(table)) {
+		return false;
+	}
+
+	index_entry_t entry = {
+		.param = param,
+		.node = param->node,
+		.id = param->id,
+	};
+
+	size_t mask = table->capacity - 1;
+	uint64_t hash = (table == &by_id) ? index_hash_id(param->node, param->id) : index_hash_name(param->node, param->name);
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		if (table->slots[i].param == param) {
+			return true;  // Already indexed
+		}
+		if (table->slots[i].param == NULL) {
+			break;
+		}
+	}
+
+	if (table == &by_name && (entry.name = strdup(param->name)) == NULL) {
+		return false;
+	}
+
+	index_table_place(table, entry);
+	return true;
+}
+
+/* Must only be called while the param_t is still alive, as its keys are needed to find it. */
+static void index_table_remove(index_table_t * table, param_t * param) {
+
+	if (table->capacity == 0) {
+		return;
+	}
+
+	size_t mask = table->capacity - 1;
+	uint64_t hash = (table == &by_id) ? index_hash_id(param->node, param->id) : index_hash_name(param->node, param->name);
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		if (table->slots[i].param == NULL) {
+			return;  // Not indexed
+		}
+		if (table->slots[i].param == param) {
+			free(table->slots[i].name);
+			table->slots[i] = (index_entry_t){.param = INDEX_TOMBSTONE};
+			return;
+		}
+	}
+}
+
+static param_t * index_lookup_id(int node, int id) {
+
+	if (by_id.capacity == 0) {
+		return NULL;
+	}
+
+	size_t mask = by_id.capacity - 1;
+	for (size_t i = index_hash_id(node, id) & mask;; i = (i + 1) & mask) {
+		const index_entry_t * entry = &by_id.slots[i];
+		if (entry->param == NULL) {
+			return NULL;
+		}
+		if (entry->param != INDEX_TOMBSTONE && entry->node == node && entry->id == id) {
+			return entry->param;
+		}
+	}
+}
+
+static param_t * index_lookup_name(int node, const char * name) {
+
+	if (by_name.capacity == 0) {
+		return NULL;
+	}
+
+	size_t mask = by_name.capacity - 1;
+	for (size_t i = index_hash_name(node, name) & mask;; i = (i + 1) & mask) {
+		const index_entry_t * entry = &by_name.slots[i];
+		if (entry->param == NULL) {
+			return NULL;
+		}
+		if (entry->param != INDEX_TOMBSTONE && entry->node == node && strcmp(entry->name, name) == 0) {
+			return entry->param;
+		}
+	}
+}
+
+/* Whether the param_t is still in the list. Only compares pointers, so a freed param_t is never dereferenced. */
+static bool index_in_list(const param_t * param) {
+	param_t * iter;
+	param_list_iterator i = {};
+	while ((iter = param_list_iterate(&i)) != NULL) {
+		if (iter == param) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Must be called with the write lock held. */
+static void index_rebuild(void) {
+
+	index_table_clear(&by_id);
+	index_table_clear(&by_name);
+
+	param_t * param;
+	param_list_iterator i = {};
+	while ((param = param_list_iterate(&i)) != NULL) {
+		index_table_insert(&by_id, param);
+		index_table_insert(&by_name, param);
+	}
+
+	index_valid = true;
+}
+
+/* Takes the read lock, after rebuilding the index if needed. */
+static void index_read_lock(void) {
+
+	pthread_rwlock_rdlock(&index_lock);
+	if (index_valid) {
+		return;
+	}
+	pthread_rwlock_unlock(&index_lock);
+
+	pthread_rwlock_wrlock(&index_lock);
+	if (!index_valid) {
+		index_rebuild();
+	}
+	pthread_rwlock_unlock(&index_lock);
+
+	pthread_rwlock_rdlock(&index_lock);
+}
+
+/* Checks a hit when the list may have changed without us knowing, otherwise falls back to walking the list on a miss.
+	Found parameters are indexed, so the next lookup hits. */
+static param_t * index_resolve(param_t * hit, param_t * (*find)(int, const void *), int node, const void * key) {
+
+	if (hit != NULL && (!INDEX_VERIFY_HITS || index_in_list(hit))) {
+		return hit;
+	}
+
+	if (hit != NULL) {
+		pycsh_param_index_invalidate();  // Forgotten behind our back, drop it along with any others.
+	}
+
+	param_t * param = find(node, key);
+	if (param != NULL) {
+		pycsh_param_index_add(param);
+	}
+	return param;
+}
+
+static param_t * index_list_find_id(int node, const void * id) {
+	return param_list_find_id(node, *(const int *)id);
+}
+
+static param_t * index_list_find_name(int node, const void * name) {
+	return param_list_find_name(node, name);
+}
+
+param_t * pycsh_param_index_find_id(int node, int id) {
+
+	index_read_lock();
+	param_t * param = index_lookup_id(node, id);
+	pthread_rwlock_unlock(&index_lock);
+
+	return index_resolve(param, index_list_find_id, node, &id);
+}
+
+param_t * pycsh_param_index_find_name(int node, const char * name) {
+
+	if (name == NULL) {
+		return NULL;
+	}
+
+	index_read_lock();
+	param_t * param = index_lookup_name(node, name);
+	pthread_rwlock_unlock(&index_lock);
+
+	return index_resolve(param, index_list_find_name, node, name);
+}
+
+void pycsh_param_index_add(param_t * param) {
+
+	pthread_rwlock_wrlock(&index_lock);
+	if (index_valid) {  // Otherwise it will be included in the next rebuild.
+		if (!index_table_insert(&by_id, param) || !index_table_insert(&by_name, param)) {
+			index_valid = false;  // Out of memory, try again with a rebuild.
+		}
+	}
+	pthread_rwlock_unlock(&index_lock);
+}
+
+void pycsh_param_index_remove(param_t * param) {
+
+	pthread_rwlock_wrlock(&index_lock);
+	if (index_valid) {
+		index_table_remove(&by_id, param);
+		index_table_remove(&by_name, param);
+	}
+	pthread_rwlock_unlock(&index_lock);
+}
+
+void pycsh_param_index_invalidate(void) {
+	pycsh_param_index_begin_change();
+	pycsh_param_index_end_change();
+}
+
+void pycsh_param_index_begin_change(void) {
+	pthread_rwlock_wrlock(&index_lock);
+	index_valid = false;
+}
+
+void pycsh_param_index_end_change(void) {
+	pthread_rwlock_unlock(&index_lock);
+}
@@ -0,0 +1,40 @@
+/*
+ * param_index.h
+ *
+ * Hash index of the parameter list, for O(1) lookups by (node, id) and (node, name).
+ *
+ * The index should be kept up to date by whoever adds to and removes from the parameter list,
+ * or be invalidated (and then lazily rebuilt) when the list may have changed in unknown ways.
+ * Lookups that miss fall back to param_list_find_id()/param_list_find_name(), so parameters added behind our back are still found.
+ * When running as an APM, CSH (and other APMs) may also forget parameters behind our back,
+ * so hits are checked against the list before they are returned.
+ *
+ * Contains no Python API, and is safe to use from threads without the GIL (i.e the sniffer).
+ */
+
+#pragma once
+
+#include <param/param.h>
+
+/* Drop-in replacements for param_list_find_id() and param_list_find_name() */
+param_t * pycsh_param_index_find_id(int node, int id);
+param_t * pycsh_param_index_find_name(int node, const char * name);
+
+/* Call after param_list_add() has added a new param_t to the list. */
+void pycsh_param_index_add(param_t * param);
+
+/* Call before param_list_remove_specific() removes (and possibly frees) the param_t. */
+void pycsh_param_index_remove(param_t * param);
+
+/* Call when parameters may have been added in unknown ways, i.e after slash commands. */
+void pycsh_param_index_invalidate(void);
+
+/**
+ * @brief Surround local changes to the list that may free param_t's in unknown ways, i.e "list forget".
+ *
+ * Invalidates the index and blocks lookups from other threads until pycsh_param_index_end_change(),
+ * so they can't be handed param_t's while they are being freed.
+ * Lookups from the calling thread in between would deadlock, so must not surround network I/O or Python code.
+ */
+void pycsh_param_index_begin_change(void);
+void pycsh_param_index_end_change(void);
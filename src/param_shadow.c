@@ -0,0 +1,134 @@
+/*
+ * param_shadow.c
+ *
+ * Last known remote value of each index of a param_t.
+ *
+ */
+
+#include "param_shadow.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pointer_map.h"
+
+typedef struct {
+	size_t typesize;
+	int array_size;
+	uint8_t * known;  // Per index
+	uint8_t * values;  // array_size values of typesize
+} param_shadow_t;
+
+/* param_t * -> param_shadow_t *, protected by shadow_lock. */
+static pycsh_ptrmap_t shadow_map;
+static pthread_mutex_t shadow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void shadow_free(param_shadow_t * shadow) {
+	if (shadow == NULL)
+		return;
+	free(shadow->known);
+	free(shadow->values);
+	free(shadow);
+}
+
+/* Returns the shadow of the parameter, creating it when needed. Must be called with shadow_lock held. */
+static param_shadow_t * shadow_get(const param_t * param) {
+
+	size_t typesize = param_typesize(param->type);
+	int array_size = param->array_size > 1 ? param->array_size : 1;
+
+	param_shadow_t * shadow = pycsh_ptrmap_get(&shadow_map, param);
+	if (shadow != NULL && shadow->typesize == typesize && shadow->array_size == array_size) {
+		return shadow;
+	}
+
+	/* The layout differs if the param_t was freed and another allocated in its place. */
+	shadow_free(pycsh_ptrmap_remove(&shadow_map, param));
+
+	shadow = calloc(1, sizeof(param_shadow_t));
+	if (shadow == NULL) {
+		return NULL;
+	}
+	shadow->typesize = typesize;
+	shadow->array_size = array_size;
+	shadow->known = calloc(array_size, 1);
+	shadow->values = calloc(array_size, typesize);
+	if (shadow->known == NULL || shadow->values == NULL || pycsh_ptrmap_set(&shadow_map, param, shadow) < 0) {
+		shadow_free(shadow);
+		return NULL;
+	}
+
+	return shadow;
+}
+
+/* Address of the cached value of the index. */
+static inline const uint8_t * shadow_cached(const param_t * param, int index, size_t typesize) {
+	size_t step = param->array_step > 0 ? (size_t)param->array_step : typesize;
+	return (const uint8_t *)param->addr + index * step;
+}
+
+/* Records the values from 'values' (packed) or, when NULL, from the cached value of the parameter. */
+static void shadow_update(const param_t * param, int node, int offset, int count, const uint8_t * values) {
+
+	if (param->addr == NULL || node != param->node)
+		return;  // vmem parameters and other nodes aren't tracked.
+
+	pthread_mutex_lock(&shadow_lock);
+
+	param_shadow_t * shadow = shadow_get(param);
+	if (shadow == NULL) {
+		pthread_mutex_unlock(&shadow_lock);
+		return;
+	}
+
+	if (offset < 0) {
+		offset = 0;
+		count = shadow->array_size;
+	}
+
+	for (int i = offset; i < offset + count && i < shadow->array_size; i++) {
+		const uint8_t * value = values != NULL ? &values[(i - offset) * shadow->typesize] : shadow_cached(param, i, shadow->typesize);
+		memcpy(&shadow->values[i * shadow->typesize], value, shadow->typesize);
+		shadow->known[i] = 1;
+	}
+
+	pthread_mutex_unlock(&shadow_lock);
+}
+
+void pycsh_param_shadow_update_cached(const param_t * param, int node, int offset, int count) {
+	shadow_update(param, node, offset, count, NULL);
+}
+
+void pycsh_param_shadow_update(const param_t * param, int node, int offset, int count, const void * values) {
+	shadow_update(param, node, offset, count, values);
+}
+
+int pycsh_param_shadow_unchanged(const param_t * param, int node, int index) {
+
+	if (param->addr == NULL || node != param->node)
+		return 0;
+
+	pthread_mutex_lock(&shadow_lock);
+
+	int unchanged = 0;
+	param_shadow_t * shadow = pycsh_ptrmap_get(&shadow_map, param);
+	if (shadow != NULL && shadow->typesize == (size_t)param_typesize(param->type)) {
+		int start = index < 0 ? 0 : index;
+		int end = index < 0 ? shadow->array_size : index + 1;
+		unchanged = (end <= shadow->array_size);
+		for (int i = start; i < end && unchanged; i++) {
+			unchanged = shadow->known[i] && memcmp(&shadow->values[i * shadow->typesize], shadow_cached(param, i, shadow->typesize), shadow->typesize) == 0;
+		}
+	}
+
+	pthread_mutex_unlock(&shadow_lock);
+	return unchanged;
+}
+
+void pycsh_param_shadow_remove(const param_t * param) {
+	pthread_mutex_lock(&shadow_lock);
+	shadow_free(pycsh_ptrmap_remove(&shadow_map, param));
+	pthread_mutex_unlock(&shadow_lock);
+}
@@ -0,0 +1,27 @@
+/*
+ * param_shadow.h
+ *
+ * Last known remote value of each index of a param_t,
+ * i.e the value last pulled from, or pushed to, its node.
+ * Used by ParameterList.push(only_changed=True) to skip unchanged values.
+ *
+ * Only parameters with a RAM buffer (param->addr) are tracked,
+ * and only values exchanged with the node of the parameter itself, other nodes are ignored.
+ * Thread-safe, and does not require the GIL.
+ */
+
+#pragma once
+
+#include <param/param.h>
+
+/* Record the current cached values of 'count' indexes starting at 'offset' (<0 for every index) as known remote values of 'node'. */
+void pycsh_param_shadow_update_cached(const param_t * param, int node, int offset, int count);
+
+/* Record 'count' packed values (of param_typesize()) starting at 'offset' (<0 for every index) as known remote values of 'node'. */
+void pycsh_param_shadow_update(const param_t * param, int node, int offset, int count, const void * values);
+
+/* Whether the cached value of the index is known to equal the remote value of 'node', -1 for every index. */
+int pycsh_param_shadow_unchanged(const param_t * param, int node, int index);
+
+/* Forgets the known remote values of a param_t, must be called before it is destroyed. */
+void pycsh_param_shadow_remove(const param_t * param);
@@ -15,9 +15,14 @@
 
 #include "../pycsh.h"
 #include "../utils.h"
+#include "../async_request.h"
+#include "../param_index.h"
+#include "../param_history.h"
+#include "../param_cache.h"
+#include "../param_shadow.h"
 
 /* Maps param_t to its corresponding PythonParameter for use by C callbacks. */
-PyDictObject * param_callback_dict = NULL;
+pycsh_ptrmap_t param_wrapper_map = {0};
 
 /* 1 for success. Compares the wrapped param_t for parameters, otherwise 0. Assumes self to be a ParameterObject. */
 static int Parameter_equal(PyObject *self, PyObject *other) {
@@ -123,7 +128,7 @@ static int Parameter_set_node(ParameterObject *self, PyObject *value, void *clos
 		return -1;
 	}
 
-	param_t * param = param_list_find_id(node, self->param->id);
+	param_t * param = pycsh_param_index_find_id(node, self->param->id);
 
 	if (param == NULL)  // Did not find a match.
 		return -1;  // Raises either TypeError or ValueError.
@@ -183,6 +188,8 @@ static int Parameter_set_oldvalue(ParameterObject *self, PyObject *value, void *
 }
 
 static PyObject * Parameter_get_value(ParameterObject *self, int remote) {
+	if (remote && self->max_age >= 0 && pycsh_param_cache_fresh(self->param, self->max_age))
+		remote = 0;  // Recent enough to skip the round trip.
 	if (self->param->array_size > 1 && self->param->type != PARAM_TYPE_STRING)
 		return _pycsh_util_get_array(self->param, remote, self->host, self->timeout, self->retries, self->paramver, pycsh_dfl_verbose);
 	return _pycsh_util_get_single(self->param, INT_MIN, remote, self->host, self->timeout, self->retries, self->paramver, pycsh_dfl_verbose);
@@ -295,6 +302,39 @@ static int Parameter_set_retries(ParameterObject *self, PyObject *value, void *c
 	return 0;
 }
 
+static PyObject * Parameter_get_max_age(ParameterObject *self, void *closure) {
+	if (self->max_age < 0)
+		Py_RETURN_NONE;
+	return PyFloat_FromDouble(self->max_age);
+}
+
+static int Parameter_set_max_age(ParameterObject *self, PyObject *value, void *closure) {
+
+	if (value == NULL) {
+        PyErr_SetString(PyExc_TypeError, "Cannot delete the max_age attribute");
+        return -1;
+    }
+
+	if (value == Py_None) {
+		self->max_age = -1;
+		return 0;
+	}
+
+	double max_age = PyFloat_AsDouble(value);
+
+	if (PyErr_Occurred())
+		return -1;  // 'Reraise' the current exception.
+
+	if (max_age < 0) {
+		PyErr_SetString(PyExc_ValueError, "max_age must not be negative, use None to always pull");
+		return -1;
+	}
+
+	self->max_age = max_age;
+
+	return 0;
+}
+
 static long Parameter_hash(ParameterObject *self) {
 	/* Use the ID of the parameter as the hash, as it is assumed unique. */
     return self->param->id;
@@ -302,20 +342,18 @@ static long Parameter_hash(ParameterObject *self) {
 
 static void Parameter_dealloc(ParameterObject *self) {
 
-	{   /* Remove ourselves from the callback/lookup dictionary */
-        PyObject *key AUTO_DECREF = PyLong_FromVoidPtr(self->param);
-        assert(key != NULL);
-        if (PyDict_GetItem((PyObject*)param_callback_dict, key) != NULL) {
-            PyDict_DelItem((PyObject*)param_callback_dict, key);
-        }
-    }
+	/* Remove ourselves from the callback/lookup map */
+	pycsh_ptrmap_remove(&param_wrapper_map, self->param);
 
 	/* Somehow we hold a reference to a parameter that is not in the list,
 		this should only be possible if it was "list forget"en, after we wrapped it.
 		It should therefore follow that we are now responsible for its memory.
 		We must therefore free() it, now that we are being deallocated.
 		We check that (self->param != NULL), just in case we allow that to raise exceptions in the future. */
-	if (param_list_find_id(self->param->node, self->param->id) != self->param && self->param != NULL) {
+	if (self->param != NULL && pycsh_param_index_find_id(self->param->node, self->param->id) != self->param) {
+		pycsh_param_history_remove(self->param);
+		pycsh_param_cache_remove(self->param);
+		pycsh_param_shadow_remove(self->param);
 		param_list_destroy(self->param);
 	}
 
@@ -323,6 +361,159 @@ static void Parameter_dealloc(ParameterObject *self) {
     baseclass->tp_dealloc((PyObject*)self);
 }
 
+static PyObject * Parameter_aget(ParameterObject *self, PyObject *args, PyObject *kwds) {
+
+	double deadline = 0;
+
+	static char *kwlist[] = {"deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&", kwlist, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	return pycsh_async_get(self->param, self->host, self->timeout, self->retries, self->paramver, deadline);
+}
+
+static PyObject * Parameter_aset(ParameterObject *self, PyObject *args, PyObject *kwds) {
+
+	PyObject * value;
+	double deadline = 0;
+
+	static char *kwlist[] = {"value", "deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&", kwlist, &value, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	return pycsh_async_set(self->param, value, self->host, self->timeout, self->retries, self->paramver, deadline);
+}
+
+static PyObject * Parameter_get_history_size(ParameterObject *self, void *closure) {
+	return PyLong_FromSize_t(pycsh_param_history_capacity(self->param));
+}
+
+static int Parameter_set_history_size(ParameterObject *self, PyObject *value, void *closure) {
+
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete the history_size attribute");
+		return -1;
+	}
+
+	size_t capacity = 0;
+	if (value != Py_None) {
+		capacity = PyLong_AsSize_t(value);
+		if (PyErr_Occurred())
+			return -1;  // 'Reraise' the current exception.
+	}
+
+	switch (pycsh_param_history_resize(self->param, capacity)) {
+		case 0:
+			return 0;
+		case -2:
+			PyErr_Format(PyExc_MemoryError, "History of %zu samples would exceed the history_limit() of %zu bytes", capacity, pycsh_param_history_get_limit());
+			return -1;
+		case -3:
+			PyErr_SetString(PyExc_TypeError, "History is only supported for numeric parameters");
+			return -1;
+		default:
+			PyErr_NoMemory();
+			return -1;
+	}
+}
+
+/* Wraps the malloc()'ed buffer in a memoryview of the specified format and shape, taking ownership of it. */
+static PyObject * Parameter_history_memoryview(void * buf, Py_ssize_t len, const char * format, Py_ssize_t rows, Py_ssize_t columns) {
+
+	PyObject * bytes AUTO_DECREF = PyBytes_FromStringAndSize(buf, len);
+	free(buf);
+	if (bytes == NULL) {
+		return NULL;
+	}
+
+	PyObject * view AUTO_DECREF = PyMemoryView_FromObject(bytes);
+	if (view == NULL) {
+		return NULL;
+	}
+
+	/* memoryview.cast() does not allow 0 in the shape, so empty histories are 1-dimensional. */
+	if (columns > 1 && rows > 0) {
+		return PyObject_CallMethod(view, "cast", "s(nn)", format, rows, columns);
+	}
+	return PyObject_CallMethod(view, "cast", "s", format);
+}
+
+static PyObject * Parameter_history(ParameterObject *self, PyObject *args, PyObject *kwds) {
+
+	double since = -INFINITY;
+	Py_ssize_t max = 0;
+
+	static char *kwlist[] = {"since", "max", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|dn", kwlist, &since, &max))
+		return NULL;  // TypeError is thrown
+
+	if (max < 0) {
+		PyErr_SetString(PyExc_ValueError, "max must not be negative");
+		return NULL;
+	}
+
+	const char * format = pycsh_util_param_type_format(self->param->type);
+	if (format == NULL) {
+		PyErr_SetString(PyExc_TypeError, "History is only supported for numeric parameters");
+		return NULL;
+	}
+
+	double * timestamps;
+	void * values;
+	long count = pycsh_param_history_copy(self->param, since, max, &timestamps, &values);
+	if (count == -2) {
+		PyErr_SetString(PyExc_ValueError, "Parameter has no history, enable it by setting .history_size");
+		return NULL;
+	} else if (count < 0) {
+		return PyErr_NoMemory();
+	}
+
+	Py_ssize_t columns = self->param->array_size > 1 ? self->param->array_size : 1;
+	Py_ssize_t rowsize = columns * param_typesize(self->param->type);
+
+	PyObject * timestamps_view AUTO_DECREF = Parameter_history_memoryview(timestamps, count * sizeof(double), "d", count, 1);
+	PyObject * values_view AUTO_DECREF = Parameter_history_memoryview(values, count * rowsize, format, count, columns);
+	if (timestamps_view == NULL || values_view == NULL) {
+		return NULL;
+	}
+
+	return PyTuple_Pack(2, timestamps_view, values_view);
+}
+
+/* Invalidates the per-type cache of _pycsh_Parameter_from_param(),
+	as a new subclass may change which ParameterArray subclass a type resolves to. */
+static PyObject * Parameter_init_subclass(PyObject *cls, PyObject *args, PyObject *kwds) {
+
+	pycsh_parameter_type_cache_clear();
+
+	PyObject *super AUTO_DECREF = PyObject_CallFunctionObjArgs((PyObject *)&PySuper_Type, (PyObject *)&ParameterType, cls, NULL);
+	if (super == NULL) {
+		return NULL;
+	}
+
+	PyObject *super_init_subclass AUTO_DECREF = PyObject_GetAttrString(super, "__init_subclass__");
+	if (super_init_subclass == NULL) {
+		return NULL;
+	}
+
+	return PyObject_Call(super_init_subclass, args, kwds);
+}
+
+static PyMethodDef Parameter_methods[] = {
+	{"__init_subclass__", (PyCFunction)Parameter_init_subclass, METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+     PyDoc_STR("Invalidates cached subclass lookups when Parameter is subclassed.")},
+	{"aget", (PyCFunction)Parameter_aget, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Awaitable equivalent of .remote_value")},
+	{"aset", (PyCFunction)Parameter_aset, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Awaitable equivalent of assigning .remote_value")},
+	{"history", (PyCFunction)Parameter_history, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Returns the (timestamps, values) recorded since the history was enabled")},
+    {NULL, NULL, 0, NULL}
+};
+
 /* 
 The Python binding 'Parameter' class exposes most of its attributes through getters, 
 as only its 'value', 'host' and 'node' are mutable, and even those are through setters.
@@ -363,6 +554,10 @@ static PyGetSetDef Parameter_getsetters[] = {
      "timeout of the parameter", NULL},
 	{"retries", (getter)Parameter_get_retries, (setter)Parameter_set_retries,
      "available retries of the parameter", NULL},
+	{"max_age", (getter)Parameter_get_max_age, (setter)Parameter_set_max_age,
+     "seconds a pulled or sniffed value may be used for by .remote_value, None to always pull", NULL},
+	{"history_size", (getter)Parameter_get_history_size, (setter)Parameter_set_history_size,
+     "number of samples kept in the history of the parameter, 0 when disabled", NULL},
 #endif
     {NULL, NULL, NULL, NULL}  /* Sentinel */
 };
@@ -378,7 +573,7 @@ PyTypeObject ParameterType = {
     .tp_dealloc = (destructor)Parameter_dealloc,
 	.tp_getset = Parameter_getsetters,
 	// .tp_members = Parameter_members,
-	// .tp_methods = Parameter_methods,
+	.tp_methods = Parameter_methods,
 	.tp_str = (reprfunc)Parameter_str,
 	.tp_richcompare = (richcmpfunc)Parameter_richcompare,
 	.tp_hash = (hashfunc)Parameter_hash,
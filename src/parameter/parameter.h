@@ -25,6 +25,7 @@ typedef struct {
 	int timeout;
 	int retries;  // TODO Kevin: The 'retries' code was implemented rather hastily, consider refactoring of removing it. 
 	int paramver;
+	double max_age;  // Seconds a cached value may be used for by .remote_value, <0 to always pull.
 } ParameterObject;
 
 extern PyTypeObject ParameterType;
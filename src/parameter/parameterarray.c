@@ -70,6 +70,176 @@ static Py_ssize_t ParameterArray_length(ParameterObject *self) {
 	return self->param->array_size;
 }
 
+/* Shape, strides and (for VMEM parameters) value snapshot of an exported buffer.
+	Stored in Py_buffer.internal, and freed by ParameterArray_releasebuffer(). */
+typedef struct {
+	Py_ssize_t shape[1];
+	Py_ssize_t strides[1];
+	void * snapshot;  // NULL when exporting param->addr directly.
+} ParameterArrayBufferInternal;
+
+/* Copies every index of a VMEM parameter into a contiguous buffer of its C type.
+	Used when the values don't live in RAM at param->addr, i.e for PythonGetSetParameters. */
+void ParameterArray_copy_values(param_t * param, void * out) {
+
+	switch (param->type) {
+		case PARAM_TYPE_STRING:
+			param_get_string(param, out, param->array_size);
+			return;
+		case PARAM_TYPE_DATA:
+			param_get_data(param, out, param->array_size);
+			return;
+		default:
+			break;
+	}
+
+	const int array_size = (param->array_size > 1) ? param->array_size : 1;
+	for (int i = 0; i < array_size; i++) {
+		switch (param->type) {
+			case PARAM_TYPE_UINT8:
+			case PARAM_TYPE_XINT8:
+				((uint8_t *)out)[i] = param_get_uint8_array(param, i);
+				break;
+			case PARAM_TYPE_UINT16:
+			case PARAM_TYPE_XINT16:
+				((uint16_t *)out)[i] = param_get_uint16_array(param, i);
+				break;
+			case PARAM_TYPE_UINT32:
+			case PARAM_TYPE_XINT32:
+				((uint32_t *)out)[i] = param_get_uint32_array(param, i);
+				break;
+			case PARAM_TYPE_UINT64:
+			case PARAM_TYPE_XINT64:
+				((uint64_t *)out)[i] = param_get_uint64_array(param, i);
+				break;
+			case PARAM_TYPE_INT8:
+				((int8_t *)out)[i] = param_get_int8_array(param, i);
+				break;
+			case PARAM_TYPE_INT16:
+				((int16_t *)out)[i] = param_get_int16_array(param, i);
+				break;
+			case PARAM_TYPE_INT32:
+				((int32_t *)out)[i] = param_get_int32_array(param, i);
+				break;
+			case PARAM_TYPE_INT64:
+				((int64_t *)out)[i] = param_get_int64_array(param, i);
+				break;
+			case PARAM_TYPE_FLOAT:
+				((float *)out)[i] = param_get_float_array(param, i);
+				break;
+			case PARAM_TYPE_DOUBLE:
+				((double *)out)[i] = param_get_double_array(param, i);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/**
+ * @brief Exports the cached values of the parameter through the buffer protocol,
+ *	i.e: memoryview(param), numpy.frombuffer(param) or array.array(fmt, param).
+ *
+ * RAM parameters are exported directly from param->addr (without copying),
+ *	with strides matching param->array_step.
+ * VMEM parameters (such as PythonGetSetParameters) are copied into a snapshot first,
+ *	as their values may not be contiguous in memory.
+ * Buffers are read-only, as writing to them would bypass parameter callbacks.
+ */
+static int ParameterArray_getbuffer(ParameterObject *self, Py_buffer *view, int flags) {
+
+	param_t * param = self->param;
+
+	if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+		PyErr_SetString(PyExc_BufferError, "Parameter buffers are read-only, use .cached_value to set values.");
+		view->obj = NULL;
+		return -1;
+	}
+
+	const char * format = pycsh_util_param_type_format(param->type);
+	if (format == NULL) {
+		PyErr_Format(PyExc_BufferError, "Parameter type %d cannot be exported as a buffer.", param->type);
+		view->obj = NULL;
+		return -1;
+	}
+
+	const Py_ssize_t itemsize = param_typesize(param->type);
+	const Py_ssize_t array_size = (param->array_size > 1) ? param->array_size : 1;
+
+	ParameterArrayBufferInternal * internal = PyMem_Calloc(1, sizeof(ParameterArrayBufferInternal));
+	if (internal == NULL) {
+		PyErr_NoMemory();
+		view->obj = NULL;
+		return -1;
+	}
+
+	void * buf = NULL;
+	Py_ssize_t stride = itemsize;
+
+	if (param->vmem == NULL) {
+		buf = param->addr;
+		if (param->array_step > 0) {
+			stride = param->array_step;
+		}
+	} else {
+		internal->snapshot = PyMem_Malloc(array_size * itemsize);
+		if (internal->snapshot == NULL) {
+			PyMem_Free(internal);
+			PyErr_NoMemory();
+			view->obj = NULL;
+			return -1;
+		}
+		ParameterArray_copy_values(param, internal->snapshot);
+		if (PyErr_Occurred()) {  // Error may occur during Parameter_getter()
+			PyMem_Free(internal->snapshot);
+			PyMem_Free(internal);
+			view->obj = NULL;
+			return -1;
+		}
+		buf = internal->snapshot;
+	}
+
+	if (stride != itemsize && (flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+		PyMem_Free(internal);
+		PyErr_SetString(PyExc_BufferError, "Parameter values are not contiguous, a strided buffer must be requested.");
+		view->obj = NULL;
+		return -1;
+	}
+
+	internal->shape[0] = array_size;
+	internal->strides[0] = stride;
+
+	view->buf = buf;
+	view->obj = Py_NewRef(self);
+	view->len = array_size * itemsize;
+	view->itemsize = itemsize;
+	view->readonly = 1;
+	view->ndim = 1;
+	view->format = ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) ? (char *)format : NULL;
+	view->shape = ((flags & PyBUF_ND) == PyBUF_ND) ? internal->shape : NULL;
+	view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? internal->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = internal;
+
+	return 0;
+}
+
+static void ParameterArray_releasebuffer(ParameterObject *self, Py_buffer *view) {
+	ParameterArrayBufferInternal * internal = view->internal;
+	if (internal == NULL) {
+		return;
+	}
+	PyMem_Free(internal->snapshot);
+	PyMem_Free(internal);
+	view->internal = NULL;
+}
+
+/* NOTE: PythonArrayParameterType is created dynamically, and inherits these from ParameterArrayType. */
+static PyBufferProcs ParameterArray_as_buffer = {
+	.bf_getbuffer = (getbufferproc)ParameterArray_getbuffer,
+	.bf_releasebuffer = (releasebufferproc)ParameterArray_releasebuffer,
+};
+
 static PyMappingMethods ParameterArray_as_mapping = {
     (lenfunc)ParameterArray_length,
     (binaryfunc)ParameterArray_GetItem,
@@ -88,6 +258,7 @@ PyTypeObject ParameterArrayType = {
 	// .tp_getset = Parameter_getsetters,
 	// .tp_str = (reprfunc)Parameter_str,
 	.tp_as_mapping = &ParameterArray_as_mapping,
+	.tp_as_buffer = &ParameterArray_as_buffer,
 	// .tp_richcompare = (richcmpfunc)Parameter_richcompare,
 	.tp_base = &ParameterType,
 };
@@ -18,4 +18,7 @@ typedef struct {
 	ParameterObject parameter;
 } ParameterArrayObject;
 
-extern PyTypeObject ParameterArrayType;
\ No newline at end of file
+extern PyTypeObject ParameterArrayType;
+/* Copies every index of the parameter into a contiguous buffer of its C type, through param_get_*().
+	Needed for VMEM parameters, whose values don't live in RAM at param->addr. May raise from Python getters. */
+void ParameterArray_copy_values(param_t * param, void * out);
@@ -9,13 +9,21 @@
 
 #include "parameterlist.h"
 
+#include <math.h>
+#include <limits.h>
 #include <param/param_queue.h>
 #include <param/param_server.h>
 #include <param/param_client.h>
+#include <param/param_string.h>
 
 #include "../pycsh.h"
 #include "../utils.h"
+#include "../async_request.h"
+#include "../poller.h"
+#include "../param_shadow.h"
+#include "../param_cache.h"
 #include "parameter.h"
+#include "parameterarray.h"
 
 
 /**
@@ -37,7 +45,13 @@ PyObject * ParameterList_append(PyObject * self, PyObject * args) {
 		return NULL;
 	}
 
-	//PyList_Append(self, obj);
+	/* Without subclasses, super().append() can only be list.append() */
+	if (Py_TYPE(self) == &ParameterListType) {
+		if (PyList_Append(self, obj) < 0) {
+			return NULL;
+		}
+		Py_RETURN_NONE;
+	}
 
 	/* 
 	Finding the name in the superclass is likely not nearly as efficient 
@@ -49,23 +63,223 @@ PyObject * ParameterList_append(PyObject * self, PyObject * args) {
 	Py_RETURN_NONE;
 }
 
-/* Pulls all Parameters in the list as a single request. */
+/* Node the Parameter is sent to, 'node' is INT_MIN when the list is grouped by the node of each Parameter.
+	Local Parameters are then sent to the default node, as they would be without grouping. */
+static inline int ParameterList_dest(param_t *param, int node) {
+	if (node != INT_MIN) {
+		return node;
+	}
+	return param->node != 0 ? param->node : (int)pycsh_dfl_node;
+}
+
+/* Adds every Parameter in the list to the queue, using their cached value for PARAM_QUEUE_TYPE_SET. */
+static int ParameterList_fill_queue(ParameterListObject *self, pycsh_segmented_queue_t *queue, int node) {
+
+	// Would likely segfault if 'self' is not a sequence, not that this ever seems be possible.
+	// Python seems to perform a sanity check on the type of 'self' before running the method.
+	// Source: cpython/Objects/descrobject.c->descr_check().
+	int seqlen = PySequence_Fast_GET_SIZE(self);
+
+	for (int i = 0; i < seqlen; i++) {
+
+		PyObject *item = PySequence_Fast_GET_ITEM(self, i);
+
+		if(!item) {
+			PyErr_SetString(PyExc_RuntimeError, "Iterator went outside the bounds of the list.");
+            return -1;
+        }
+
+		if (!PyObject_TypeCheck(item, &ParameterType)) {  // Sanity check
+			fprintf(stderr, "Skipping non-parameter object (of type: %s) in Parameter list.", item->ob_type->tp_name);
+			continue;
+		}
+
+		param_t * param = ((ParameterObject *)item)->param;
+		void * value = (queue->type == PARAM_QUEUE_TYPE_SET) ? param->addr : NULL;
+		if (pycsh_util_segmented_queue_add(queue, param, -1, value, ParameterList_dest(param, node)) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void ParameterList_plan_clear(ParameterListPlan *plan) {
+	pycsh_segmented_queue_free(&plan->queue);
+	PyMem_Free(plan->params);
+	plan->params = NULL;
+	plan->count = 0;
+	plan->valid = 0;
+}
+
+/* Whether the plan was built from the current members of the list, and the same arguments. */
+static int ParameterList_plan_matches(ParameterListObject *self, ParameterListPlan *plan, int node, int paramver) {
+
+	Py_ssize_t seqlen = PyList_GET_SIZE(self);
+
+	if (!plan->valid || plan->node != node || plan->queue.version != paramver || plan->count != seqlen) {
+		return 0;
+	}
+
+	if (node == INT_MIN && plan->dfl_node != (int)pycsh_dfl_node) {
+		return 0;  // Local Parameters are sent elsewhere now.
+	}
+
+	for (Py_ssize_t i = 0; i < seqlen; i++) {
+		PyObject *item = PyList_GET_ITEM(self, i);
+		param_t * param = PyObject_TypeCheck(item, &ParameterType) ? ((ParameterObject *)item)->param : NULL;
+		if (param != plan->params[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Serializes the members of the list into the plan, replacing what was there before. */
+static int ParameterList_plan_build(ParameterListObject *self, ParameterListPlan *plan, int node, int paramver) {
+
+	ParameterList_plan_clear(plan);
+
+	Py_ssize_t seqlen = PyList_GET_SIZE(self);
+	plan->params = PyMem_Malloc((seqlen ? seqlen : 1) * sizeof(param_t *));
+	if (plan->params == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	pycsh_segmented_queue_init(&plan->queue, PARAM_QUEUE_TYPE_GET, paramver);
+	/* Single-flight claims are made per pull by pycsh_segmented_queue_claim(), as they can't be held by a plan between pulls. */
+	plan->queue.single_flight = 0;
+
+	if (ParameterList_fill_queue(self, &plan->queue, node) < 0) {
+		ParameterList_plan_clear(plan);
+		return -1;
+	}
+
+	for (Py_ssize_t i = 0; i < seqlen; i++) {
+		PyObject *item = PyList_GET_ITEM(self, i);
+		plan->params[i] = PyObject_TypeCheck(item, &ParameterType) ? ((ParameterObject *)item)->param : NULL;
+	}
+	plan->count = seqlen;
+	plan->node = node;
+	plan->dfl_node = pycsh_dfl_node;
+	plan->valid = 1;
+
+	return 0;
+}
+
+/* Performs the pull queue, either raising or returning the results per node when grouped. */
+static PyObject * ParameterList_run_pull(pycsh_segmented_queue_t *queue, int node, int timeout, int retries, int max_in_flight) {
+
+	if (node == INT_MIN) {
+		return pycsh_util_segmented_queue_run_grouped(queue, timeout, retries, max_in_flight, 0);
+	}
+
+	if (pycsh_util_segmented_queue_run(queue, timeout, retries, max_in_flight, 0) < 0) {
+		return NULL;  // Raises ConnectionError or PartialResponseError
+	}
+
+	Py_RETURN_NONE;
+}
+
+/* Pulls all Parameters in the list, split into as few packets as possible. */
 static PyObject * ParameterList_pull(ParameterListObject *self, PyObject *args, PyObject *kwds) {
 	
 	CSP_INIT_CHECK()
 
-	unsigned int node = pycsh_dfl_node;
+	int node = INT_MIN;
 	unsigned int timeout = pycsh_dfl_timeout;
 	int paramver = 2;
+	int retries = 1;
+	unsigned int max_in_flight = pycsh_dfl_max_in_flight;
 
-	static char *kwlist[] = {"node", "timeout", "paramver", NULL};
+	static char *kwlist[] = {"node", "timeout", "paramver", "retries", "max_in_flight", NULL};
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IIi", kwlist, &node, &timeout, &paramver))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&IiiI", kwlist, pycsh_util_node_converter, &node, &timeout, &paramver, &retries, &max_in_flight))
 		return NULL;  // TypeError is thrown
 
-	void * queuebuffer CLEANUP_FREE = malloc(PARAM_SERVER_MTU);
-	param_queue_t queue = { };
-	param_queue_init(&queue, queuebuffer, PARAM_SERVER_MTU, 0, PARAM_QUEUE_TYPE_GET, paramver);
+	/* Repeated pulls of an unchanged list reuse the serialized request.
+		When another thread is already performing the plan, we fall back to a queue of our own. */
+	ParameterListPlan *plan = &self->pull_plan;
+	if (!plan->busy) {
+
+		if (!ParameterList_plan_matches(self, plan, node, paramver) && ParameterList_plan_build(self, plan, node, paramver) < 0) {
+			return NULL;
+		}
+
+		plan->busy = 1;
+		pycsh_segmented_queue_claim(&plan->queue);
+		PyObject * res = ParameterList_run_pull(&plan->queue, node, timeout, retries, max_in_flight);
+		plan->busy = 0;
+
+		return res;
+	}
+
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_GET, paramver);
+
+	if (ParameterList_fill_queue(self, &queue, node) < 0) {
+		return NULL;
+	}
+
+	return ParameterList_run_pull(&queue, node, timeout, retries, max_in_flight);
+}
+
+/* Values left out of a push by ParameterList_fill_queue_changed(), per node. */
+typedef struct {
+	int node;
+	size_t elements;
+	size_t bytes;
+} ParameterListSkipped;
+
+typedef struct {
+	ParameterListSkipped *nodes;
+	size_t count;
+} ParameterListSkips;
+
+static void cleanup_skips(ParameterListSkips *skips) {
+	PyMem_Free(skips->nodes);
+	skips->nodes = NULL;
+	skips->count = 0;
+}
+
+static int ParameterList_skip(ParameterListSkips *skips, int node, size_t bytes) {
+
+	size_t i = 0;
+	while (i < skips->count && skips->nodes[i].node != node) {
+		i++;
+	}
+
+	if (i == skips->count) {
+		ParameterListSkipped *nodes = PyMem_Realloc(skips->nodes, (skips->count + 1) * sizeof(ParameterListSkipped));
+		if (nodes == NULL) {
+			PyErr_NoMemory();
+			return -1;
+		}
+		skips->nodes = nodes;
+		skips->nodes[skips->count++] = (ParameterListSkipped){.node = node};
+	}
+
+	skips->nodes[i].elements++;
+	skips->nodes[i].bytes += bytes;
+	return 0;
+}
+
+/* Address of the cached value of the index, for PARAM_QUEUE_TYPE_SET. */
+static void * ParameterList_cached_value(param_t *param, int index) {
+	size_t step = param->array_step > 0 ? (size_t)param->array_step : param_typesize(param->type);
+	return (char *)param->addr + index * step;
+}
+
+/**
+ * @brief Adds only the values of the list that differ from their last known remote value.
+ *
+ * Arrays where only some indexes changed are added per index,
+ * strings and data are compared and added as a whole.
+ * Parameters without a RAM buffer, and values pushed to another node than that of the parameter, are always added.
+ */
+static int ParameterList_fill_queue_changed(ParameterListObject *self, pycsh_segmented_queue_t *queue, int node, ParameterListSkips *skips) {
 
 	int seqlen = PySequence_Fast_GET_SIZE(self);
 
@@ -73,90 +287,518 @@ static PyObject * ParameterList_pull(ParameterListObject *self, PyObject *args,
 
 		PyObject *item = PySequence_Fast_GET_ITEM(self, i);
 
-		if(!item) {
-			PyErr_SetString(PyExc_RuntimeError, "Iterator went outside the bounds of the list.");
-            return NULL;
-        }
-
 		if (!PyObject_TypeCheck(item, &ParameterType)) {  // Sanity check
 			fprintf(stderr, "Skipping non-parameter object (of type: %s) in Parameter list.", item->ob_type->tp_name);
 			continue;
 		}
 
-		if (param_queue_add(&queue, ((ParameterObject *)item)->param, -1, NULL) < 0) {
-			PyErr_SetString(PyExc_MemoryError, "Queue full");
-			return NULL;
+		param_t * param = ((ParameterObject *)item)->param;
+		int dest = ParameterList_dest(param, node);
+		int whole = param->addr == NULL || param->array_size <= 1 || param->type == PARAM_TYPE_STRING || param->type == PARAM_TYPE_DATA;
+
+		if (whole) {
+			if (param->addr != NULL && pycsh_param_shadow_unchanged(param, dest, -1)) {
+				if (ParameterList_skip(skips, dest, param_typesize(param->type) * (param->array_size > 1 ? param->array_size : 1)) < 0) {
+					return -1;
+				}
+				continue;
+			}
+			if (pycsh_util_segmented_queue_add(queue, param, -1, param->addr, dest) < 0) {
+				return -1;
+			}
+			continue;
+		}
+
+		int changed = 0;
+		for (int j = 0; j < param->array_size; j++) {
+			changed += !pycsh_param_shadow_unchanged(param, dest, j);
+		}
+
+		if (changed == param->array_size) {
+			/* Cheaper to send the whole array than every index on its own. */
+			if (pycsh_util_segmented_queue_add(queue, param, -1, param->addr, dest) < 0) {
+				return -1;
+			}
+			continue;
 		}
 
+		for (int j = 0; j < param->array_size; j++) {
+			if (pycsh_param_shadow_unchanged(param, dest, j)) {
+				if (ParameterList_skip(skips, dest, param_typesize(param->type)) < 0) {
+					return -1;
+				}
+				continue;
+			}
+			if (pycsh_util_segmented_queue_add(queue, param, j, ParameterList_cached_value(param, j), dest) < 0) {
+				return -1;
+			}
+		}
 	}
 
-	if (param_pull_queue(&queue, CSP_PRIO_NORM, 0, node, timeout)) {
-		PyErr_SetString(PyExc_ConnectionError, "No response.");
-		return 0;
+	return 0;
+}
+
+/* Copies of the values added to a push, per queue item, recorded as the remote values once acknowledged. */
+typedef struct {
+	uint8_t * values;
+	size_t * positions;  // Start of each item in 'values'
+} ParameterListQueued;
+
+static void cleanup_queued(ParameterListQueued *queued) {
+	free(queued->values);
+	free(queued->positions);
+}
+
+/* Number of values in the queue item. */
+static int ParameterList_item_count(const pycsh_segment_item_t *item) {
+	return item->offset < 0 ? (item->param->array_size > 1 ? item->param->array_size : 1) : 1;
+}
+
+/**
+ * @brief Copies the values of every queue item, as they were when they were serialized into the queue.
+ *
+ * Must be called before the GIL is released, as the cached values may change while the queue is pushed.
+ */
+static int ParameterList_queued_copy(ParameterListQueued *queued, pycsh_segmented_queue_t *queue) {
+
+	size_t total = 0;
+	queued->positions = malloc((queue->item_count + 1) * sizeof(size_t));
+	if (queued->positions == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	for (size_t i = 0; i < queue->item_count; i++) {
+		queued->positions[i] = total;
+		const pycsh_segment_item_t * item = &queue->items[i];
+		if (item->param->addr != NULL) {
+			total += ParameterList_item_count(item) * param_typesize(item->param->type);
+		}
 	}
 
-	Py_RETURN_NONE;
+	queued->values = malloc(total > 0 ? total : 1);
+	if (queued->values == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	for (size_t i = 0; i < queue->item_count; i++) {
+		const pycsh_segment_item_t * item = &queue->items[i];
+		if (item->param->addr == NULL) {
+			continue;
+		}
+		size_t typesize = param_typesize(item->param->type);
+		int start = item->offset < 0 ? 0 : item->offset;
+		for (int j = 0; j < ParameterList_item_count(item); j++) {
+			memcpy(&queued->values[queued->positions[i] + j * typesize], ParameterList_cached_value(item->param, start + j), typesize);
+		}
+	}
+
+	return 0;
 }
 
-/* Pushes all Parameters in the list as a single request. */
+/* Statistics of an only_changed push to the node, INT_MIN for every node. */
+static PyObject * ParameterList_push_stats(pycsh_segmented_queue_t *queue, ParameterListSkips *skips, int node) {
+
+	size_t pushed = 0;
+	for (size_t i = 0; i < queue->item_count; i++) {
+		pushed += (node == INT_MIN || queue->items[i].host == node);
+	}
+
+	size_t skipped_elements = 0;
+	size_t skipped_bytes = 0;
+	for (size_t i = 0; i < skips->count; i++) {
+		if (node == INT_MIN || skips->nodes[i].node == node) {
+			skipped_elements += skips->nodes[i].elements;
+			skipped_bytes += skips->nodes[i].bytes;
+		}
+	}
+
+	return Py_BuildValue("{s:n,s:n,s:n}",
+		"pushed_elements", (Py_ssize_t)pushed,
+		"skipped_elements", (Py_ssize_t)skipped_elements,
+		"skipped_bytes", (Py_ssize_t)skipped_bytes);
+}
+
+/* Replaces the None results of a grouped push with its statistics, including nodes where every value was skipped. */
+static int ParameterList_push_stats_grouped(PyObject *results, pycsh_segmented_queue_t *queue, ParameterListSkips *skips) {
+
+	for (size_t i = 0; i < skips->count; i++) {
+		PyObject * node AUTO_DECREF = PyLong_FromLong(skips->nodes[i].node);
+		if (node == NULL || PyDict_SetDefault(results, node, Py_None) == NULL) {
+			return -1;
+		}
+	}
+
+	PyObject * node;
+	PyObject * result;
+	Py_ssize_t pos = 0;
+	while (PyDict_Next(results, &pos, &node, &result)) {
+		if (result != Py_None) {
+			continue;  // Keep the exception
+		}
+		PyObject * stats AUTO_DECREF = ParameterList_push_stats(queue, skips, PyLong_AsLong(node));
+		if (stats == NULL || PyDict_SetItem(results, node, stats) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Pushes all Parameters in the list, split into as few packets as possible. */
 static PyObject * ParameterList_push(ParameterListObject *self, PyObject *args, PyObject *kwds) {
 
 	CSP_INIT_CHECK()
 	
-	unsigned int node = pycsh_dfl_node;
+	int node = INT_MIN;
 	unsigned int timeout = pycsh_dfl_timeout;
 	uint32_t hwid = 0;
 	int paramver = 2;
+	int retries = 1;
+	unsigned int max_in_flight = pycsh_dfl_max_in_flight;
+	int only_changed = 0;
 
-	static char *kwlist[] = {"node", "timeout", "hwid", "paramver", NULL};
+	static char *kwlist[] = {"node", "timeout", "hwid", "paramver", "retries", "max_in_flight", "only_changed", NULL};
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IIIi", kwlist, &node, &timeout, &hwid, &paramver))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&IIiiIp", kwlist, pycsh_util_node_converter, &node, &timeout, &hwid, &paramver, &retries, &max_in_flight, &only_changed))
 		return NULL;  // TypeError is thrown
 
-	void * queuebuffer CLEANUP_FREE = malloc(PARAM_SERVER_MTU);
-	param_queue_t queue = { };
-	param_queue_init(&queue, queuebuffer, PARAM_SERVER_MTU, 0, PARAM_QUEUE_TYPE_SET, paramver);
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_SET, paramver);
+	queue.verbose = 1;  // Print the pushed values, as before the queue was segmented.
 
-	// Would likely segfault if 'self' is not a sequence, not that this ever seems be possible.
-	// Python seems to perform a sanity check on the type of 'self' before running the method.
-	// Source: cpython/Objects/descrobject.c->descr_check().
-	int seqlen = PySequence_Fast_GET_SIZE(self);
+	ParameterListSkips skips __attribute__((cleanup(cleanup_skips))) = {0};
 
-	for (int i = 0; i < seqlen; i++) {
+	if (only_changed) {
+		if (ParameterList_fill_queue_changed(self, &queue, node, &skips) < 0) {
+			return NULL;
+		}
+	} else if (ParameterList_fill_queue(self, &queue, node) < 0) {
+		return NULL;
+	}
 
-		PyObject *item = PySequence_Fast_GET_ITEM(self, i);
+	ParameterListQueued queued __attribute__((cleanup(cleanup_queued))) = {0};
+	if (ParameterList_queued_copy(&queued, &queue) < 0) {
+		return NULL;
+	}
 
-		if(!item) {
-			PyErr_SetString(PyExc_RuntimeError, "Iterator went outside the bounds of the list.");
-            return NULL;
-        }
+	PyObject * results = NULL;
+	int res = 0;
+	if (node == INT_MIN) {
+		results = pycsh_util_segmented_queue_run_grouped(&queue, timeout, retries, max_in_flight, hwid);
+		if (results == NULL) {
+			return NULL;
+		}
+	} else if (queue.item_count > 0) {
+		res = pycsh_util_segmented_queue_run(&queue, timeout, retries, max_in_flight, hwid);
+	}
 
-		if (!PyObject_TypeCheck(item, &ParameterType)) {  // Sanity check
-			fprintf(stderr, "Skipping non-parameter object (of type: %s) in Parameter list.", item->ob_type->tp_name);
-			continue;
+	/* Whatever got acknowledged is now the remote value, even when other segments failed.
+		Records the values we sent, as the cached values may have changed while pushing. */
+	for (size_t i = 0; i < queue.item_count; i++) {
+		const pycsh_segment_item_t * item = &queue.items[i];
+		if (!pycsh_segmented_queue_item_failed(&queue, i)) {
+			pycsh_param_shadow_update(item->param, item->host, item->offset, ParameterList_item_count(item), &queued.values[queued.positions[i]]);
 		}
+	}
 
-		if (param_queue_add(&queue, ((ParameterObject *)item)->param, -1, ((ParameterObject *)item)->param->addr) < 0) {
-			PyErr_SetString(PyExc_MemoryError, "Queue full");
+	if (results != NULL) {
+		if (only_changed && ParameterList_push_stats_grouped(results, &queue, &skips) < 0) {
+			Py_DECREF(results);
 			return NULL;
 		}
+		return results;
+	}
+
+	if (res < 0) {
+		return NULL;  // Raises ConnectionError or PartialResponseError
+	}
+
+	if (!only_changed) {
+		Py_RETURN_NONE;
+	}
+
+	return ParameterList_push_stats(&queue, &skips, INT_MIN);
+}
+
+/* Awaitable equivalent of ParameterList_pull() */
+static PyObject * ParameterList_apull(ParameterListObject *self, PyObject *args, PyObject *kwds) {
+	
+	CSP_INIT_CHECK()
+
+	int node = INT_MIN;
+	unsigned int timeout = pycsh_dfl_timeout;
+	int paramver = 2;
+	int retries = 1;
+	double deadline = 0;
+
+	static char *kwlist[] = {"node", "timeout", "paramver", "retries", "deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&IiiO&", kwlist, pycsh_util_node_converter, &node, &timeout, &paramver, &retries, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	pycsh_async_request_t * request = pycsh_async_request_new(PARAM_QUEUE_TYPE_GET, NULL, paramver, timeout, retries, deadline);
+	if (request == NULL) {
+		return NULL;
 	}
+	request->grouped = (node == INT_MIN);
 
-	if (param_push_queue(&queue, 1, node, timeout, hwid, false) < 0) {
-		PyErr_SetString(PyExc_ConnectionError, "No response.");
+	if (ParameterList_fill_queue(self, &request->queue, node) < 0) {
+		pycsh_async_request_free(request);
 		return NULL;
 	}
 
-	Py_RETURN_NONE;
+	return pycsh_async_request_submit(request);
+}
+
+/* Awaitable equivalent of ParameterList_push() */
+static PyObject * ParameterList_apush(ParameterListObject *self, PyObject *args, PyObject *kwds) {
+
+	CSP_INIT_CHECK()
+	
+	int node = INT_MIN;
+	unsigned int timeout = pycsh_dfl_timeout;
+	uint32_t hwid = 0;
+	int paramver = 2;
+	int retries = 1;
+	double deadline = 0;
+
+	static char *kwlist[] = {"node", "timeout", "hwid", "paramver", "retries", "deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&IIiiO&", kwlist, pycsh_util_node_converter, &node, &timeout, &hwid, &paramver, &retries, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	pycsh_async_request_t * request = pycsh_async_request_new(PARAM_QUEUE_TYPE_SET, NULL, paramver, timeout, retries, deadline);
+	if (request == NULL) {
+		return NULL;
+	}
+	request->hwid = hwid;
+	request->grouped = (node == INT_MIN);
+
+	if (ParameterList_fill_queue(self, &request->queue, node) < 0) {
+		pycsh_async_request_free(request);
+		return NULL;
+	}
+
+	return pycsh_async_request_submit(request);
+}
+
+/* Starts pulling the list periodically from the shared scheduler thread. */
+static PyObject * ParameterList_poll(ParameterListObject *self, PyObject *args, PyObject *kwds) {
+
+	CSP_INIT_CHECK()
+
+	double period = 0.1;
+	int node = INT_MIN;
+	PyObject * on_update = Py_None;
+	unsigned int timeout = pycsh_dfl_timeout;
+	int paramver = 2;
+	int retries = 1;
+	unsigned int max_in_flight = pycsh_dfl_max_in_flight;
+
+	static char *kwlist[] = {"period", "node", "on_update", "timeout", "paramver", "retries", "max_in_flight", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|dO&OIiiI", kwlist, &period, pycsh_util_node_converter, &node, &on_update, &timeout, &paramver, &retries, &max_in_flight))
+		return NULL;  // TypeError is thrown
+
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_GET, paramver);
+	/* Single-flight claims are made when adding, so they can't be held between polls. */
+	queue.single_flight = 0;
+
+	if (ParameterList_fill_queue(self, &queue, node) < 0) {
+		return NULL;
+	}
+
+	/* Like a grouped pull, every node gets a request in flight at once. */
+	if (node == INT_MIN && max_in_flight < pycsh_segmented_queue_host_count(&queue)) {
+		max_in_flight = pycsh_segmented_queue_host_count(&queue);
+	}
+
+	return Poller_start((PyObject *)self, &queue, period, on_update, timeout, retries, max_in_flight);
+}
+
+/* Wraps the bytes object in a 1-dimensional memoryview of the format, stealing the reference to it. */
+static PyObject * ParameterList_snapshot_column(PyObject *bytes, const char *format) {
+
+	if (bytes == NULL) {
+		return NULL;
+	}
+
+	PyObject * view AUTO_DECREF = PyMemoryView_FromObject(bytes);
+	Py_DECREF(bytes);
+	if (view == NULL) {
+		return NULL;
+	}
+
+	return PyObject_CallMethod(view, "cast", "s", format);
+}
+
+/* Copies the cached values of the parameter into 'out' as a contiguous array of its C type. */
+static int ParameterList_snapshot_values(param_t *param, char *out, Py_ssize_t count, size_t typesize) {
+
+	if (param->vmem != NULL || param->addr == NULL) {
+		ParameterArray_copy_values(param, out);
+		return PyErr_Occurred() ? -1 : 0;  // Error may occur during Parameter_getter()
+	}
+
+	size_t step = param->array_step > 0 ? (size_t)param->array_step : typesize;
+	if (step == typesize) {
+		memcpy(out, param->addr, count * typesize);
+		return 0;
+	}
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		memcpy(out + i * typesize, (char *)param->addr + i * step, typesize);
+	}
+	return 0;
+}
+
+/**
+ * @brief Copies the cached values of every Parameter in the list into columnar buffers.
+ *
+ * Values are grouped by type into one contiguous buffer each,
+ * where the values of row 'i' are values[type_name][offset[i]:offset[i]+count[i]].
+ * Every column (except names) is a memoryview, so numpy.frombuffer(), pandas and polars can use them without copying.
+ */
+static PyObject * ParameterList_snapshot(ParameterListObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	/* Python getters of VMEM parameters may mutate the list while we iterate it. */
+	PyObject * members AUTO_DECREF = PyList_AsTuple((PyObject *)self);
+	if (members == NULL) {
+		return NULL;
+	}
+
+	Py_ssize_t seqlen = PyTuple_GET_SIZE(members);
+	Py_ssize_t rows = 0;
+	Py_ssize_t type_counts[PARAM_TYPE_INVALID] = {0};
+
+	for (Py_ssize_t i = 0; i < seqlen; i++) {
+		PyObject *item = PyTuple_GET_ITEM(members, i);
+		if (!PyObject_TypeCheck(item, &ParameterType)) {
+			continue;
+		}
+		param_t * param = ((ParameterObject *)item)->param;
+		if (param->type < PARAM_TYPE_INVALID) {
+			type_counts[param->type] += (param->array_size > 1) ? param->array_size : 1;
+		}
+		rows++;
+	}
+
+	PyObject * names AUTO_DECREF = PyList_New(rows);
+	PyObject * nodes = PyBytes_FromStringAndSize(NULL, rows * sizeof(uint16_t));
+	PyObject * ids = PyBytes_FromStringAndSize(NULL, rows * sizeof(uint16_t));
+	PyObject * types = PyBytes_FromStringAndSize(NULL, rows * sizeof(uint8_t));
+	PyObject * timestamps = PyBytes_FromStringAndSize(NULL, rows * sizeof(double));
+	PyObject * offsets = PyBytes_FromStringAndSize(NULL, rows * sizeof(int64_t));
+	PyObject * counts = PyBytes_FromStringAndSize(NULL, rows * sizeof(int64_t));
+
+	PyObject * type_values[PARAM_TYPE_INVALID] = {0};
+	int failed = (names == NULL || nodes == NULL || ids == NULL || types == NULL || timestamps == NULL || offsets == NULL || counts == NULL);
+	for (int t = 0; t < PARAM_TYPE_INVALID && !failed; t++) {
+		if (type_counts[t] > 0) {
+			type_values[t] = PyBytes_FromStringAndSize(NULL, type_counts[t] * param_typesize(t));
+			failed = (type_values[t] == NULL);
+		}
+	}
+
+	Py_ssize_t type_used[PARAM_TYPE_INVALID] = {0};
+	for (Py_ssize_t i = 0, row = 0; i < seqlen && !failed; i++) {
+
+		PyObject *item = PyTuple_GET_ITEM(members, i);
+		if (!PyObject_TypeCheck(item, &ParameterType)) {
+			continue;
+		}
+		param_t * param = ((ParameterObject *)item)->param;
+
+		PyObject * name = PyUnicode_FromString(param->name);
+		if (name == NULL) {
+			failed = 1;
+			break;
+		}
+		PyList_SET_ITEM(names, row, name);
+
+		Py_ssize_t count = 0;
+		Py_ssize_t offset = 0;
+		if (param->type < PARAM_TYPE_INVALID) {
+			size_t typesize = param_typesize(param->type);
+			count = (param->array_size > 1) ? param->array_size : 1;
+			offset = type_used[param->type];
+			/* Sanity check, in case the array size changed since the first pass. */
+			if (offset + count > type_counts[param->type]) {
+				count = 0;
+			} else if (ParameterList_snapshot_values(param, PyBytes_AS_STRING(type_values[param->type]) + offset * typesize, count, typesize) < 0) {
+				failed = 1;
+				break;
+			}
+			type_used[param->type] += count;
+		}
+
+		double received = pycsh_param_cache_received(param);
+
+		((uint16_t *)PyBytes_AS_STRING(nodes))[row] = param->node;
+		((uint16_t *)PyBytes_AS_STRING(ids))[row] = param->id;
+		((uint8_t *)PyBytes_AS_STRING(types))[row] = param->type;
+		((double *)PyBytes_AS_STRING(timestamps))[row] = received > 0 ? received : NAN;
+		((int64_t *)PyBytes_AS_STRING(offsets))[row] = offset;
+		((int64_t *)PyBytes_AS_STRING(counts))[row] = count;
+		row++;
+	}
+
+	PyObject * values AUTO_DECREF = failed ? NULL : PyDict_New();
+	for (int t = 0; t < PARAM_TYPE_INVALID; t++) {
+		if (type_values[t] == NULL) {
+			continue;
+		}
+		if (values == NULL) {
+			Py_DECREF(type_values[t]);
+			continue;
+		}
+		char type_name[20];
+		param_type_str(t, type_name, sizeof(type_name));
+		PyObject * column AUTO_DECREF = ParameterList_snapshot_column(type_values[t], pycsh_util_param_type_format(t));
+		if (column == NULL || PyDict_SetItemString(values, type_name, column) < 0) {
+			Py_CLEAR(values);
+		}
+	}
+
+	if (values == NULL) {
+		Py_XDECREF(nodes);
+		Py_XDECREF(ids);
+		Py_XDECREF(types);
+		Py_XDECREF(timestamps);
+		Py_XDECREF(offsets);
+		Py_XDECREF(counts);
+		return NULL;
+	}
+
+	return Py_BuildValue("{s:O,s:N,s:N,s:N,s:N,s:N,s:N,s:O}",
+		"name", names,
+		"node", ParameterList_snapshot_column(nodes, "H"),
+		"id", ParameterList_snapshot_column(ids, "H"),
+		"type", ParameterList_snapshot_column(types, "B"),
+		"timestamp", ParameterList_snapshot_column(timestamps, "d"),
+		"offset", ParameterList_snapshot_column(offsets, "q"),
+		"count", ParameterList_snapshot_column(counts, "q"),
+		"values", values);
 }
 
 static PyMethodDef ParameterList_methods[] = {
     {"append", (PyCFunction)ParameterList_append, METH_VARARGS,
      PyDoc_STR("Add a Parameter to the list.")},
 	{"pull", (PyCFunction)ParameterList_pull, METH_VARARGS | METH_KEYWORDS,
-     PyDoc_STR("Pulls all Parameters in the list as a single request.")},
+     PyDoc_STR("Pulls all Parameters in the list, split into as few packets as possible.")},
 	{"push", (PyCFunction)ParameterList_push, METH_VARARGS | METH_KEYWORDS,
-     PyDoc_STR("Pushes all Parameters in the list as a single request.")},
+     PyDoc_STR("Pushes all Parameters in the list, split into as few packets as possible.\n"
+               "With only_changed=True, only values that differ from their last known remote value are pushed.")},
+	{"poll", (PyCFunction)ParameterList_poll, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Pulls the list periodically from a background thread, returning a Poller.")},
+	{"snapshot", (PyCFunction)ParameterList_snapshot, METH_NOARGS,
+     PyDoc_STR("Copies the cached values of the list into columnar buffers, grouped by type.")},
+	{"apull", (PyCFunction)ParameterList_apull, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Awaitable equivalent of .pull()")},
+	{"apush", (PyCFunction)ParameterList_apush, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Awaitable equivalent of .push()")},
     {NULL, NULL, 0, NULL}
 };
 
@@ -198,6 +840,11 @@ static int ParameterList_init(ParameterListObject *self, PyObject *args, PyObjec
     return 0;
 }
 
+static void ParameterList_dealloc(ParameterListObject *self) {
+	ParameterList_plan_clear(&self->pull_plan);
+	PyList_Type.tp_dealloc((PyObject *)self);
+}
+
 /* Subclass of the Python list which implements an interface to libparam's queue API. 
    This makes some attempts to restricts and validate its contents to be parameters.
    This is generally considered unpythonic however, and shouldn't be relied upon */
@@ -209,6 +856,6 @@ PyTypeObject ParameterListType = {
 	.tp_itemsize = 0,
 	.tp_flags = Py_TPFLAGS_DEFAULT,
 	.tp_init = (initproc)ParameterList_init,
-	// .tp_dealloc = (destructor)ParameterList_dealloc,
+	.tp_dealloc = (destructor)ParameterList_dealloc,
 	.tp_methods = ParameterList_methods,
 };
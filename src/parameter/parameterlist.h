@@ -12,11 +12,27 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include <param/param.h>
+
+#include "../segmented_queue.h"
+
+/* Serialized pull request of the list, reused until the members (or arguments) change. */
+typedef struct {
+	pycsh_segmented_queue_t queue;
+	param_t ** params;  // Members the plan was built from, compared on every pull to detect mutation.
+	Py_ssize_t count;
+	int node;  // INT_MIN when grouped by the node of each Parameter
+	int dfl_node;  // Node of local Parameters when grouped
+	int valid;
+	int busy;  // Being performed by another thread, which then owns the segment results.
+} ParameterListPlan;
+
 typedef struct {
 	PyListObject list;
 	// The documentation warns that for a class to be compatible with multiple inheritance in Python,
 	// its .tp_basicsize should be larger than that of its base class; currently not the case here.
 	// Source: https://docs.python.org/3/extending/newtypes_tutorial.html#subclassing-other-types
+	ParameterListPlan pull_plan;
 } ParameterListObject;
 
 PyObject * ParameterList_append(PyObject * self, PyObject * args);
@@ -0,0 +1,192 @@
+/*
+ * parameterlistview.c
+ *
+ * Contains the ParameterListView class,
+ * a lazily materialized sequence of Parameters, for filters matching very large parts of the list.
+ *
+ */
+
+#include "parameterlistview.h"
+
+#include <param/param.h>
+
+#include "../pycsh.h"
+#include "../utils.h"
+#include "../param_index.h"
+#include "parameter.h"
+#include "parameterlist.h"
+
+PyObject * ParameterListView_from_filter(uint32_t mask, int node, const char * globstr) {
+
+	ParameterListViewObject * self = (ParameterListViewObject *)ParameterListViewType.tp_alloc(&ParameterListViewType, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	Py_ssize_t capacity = 0;
+
+	param_t * param;
+	param_list_iterator i = {};
+	while ((param = param_list_iterate(&i)) != NULL) {
+
+		if (!pycsh_util_param_matches(param, mask, node, globstr)) {
+			continue;
+		}
+
+		if (self->count >= capacity) {
+			capacity = capacity ? capacity * 2 : 256;
+			ParameterListViewEntry * entries = PyMem_Realloc(self->entries, capacity * sizeof(ParameterListViewEntry));
+			if (entries == NULL) {
+				Py_DECREF(self);
+				return PyErr_NoMemory();
+			}
+			self->entries = entries;
+		}
+
+		self->entries[self->count++] = (ParameterListViewEntry){.node = param->node, .id = param->id};
+	}
+
+	return (PyObject *)self;
+}
+
+static void ParameterListView_dealloc(ParameterListViewObject *self) {
+	Py_XDECREF(self->materialized);
+	PyMem_Free(self->entries);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t ParameterListView_length(ParameterListViewObject *self) {
+	return self->count;
+}
+
+/* Wraps the parameter at the index, negative indexes have already been adjusted by Python. */
+static PyObject * ParameterListView_item(ParameterListViewObject *self, Py_ssize_t index) {
+
+	if (index < 0 || index >= self->count) {
+		PyErr_SetString(PyExc_IndexError, "ParameterListView index out of range");
+		return NULL;
+	}
+
+	ParameterListViewEntry * entry = &self->entries[index];
+	param_t * param = pycsh_param_index_find_id(entry->node, entry->id);
+	if (param == NULL) {
+		PyErr_Format(PyExc_ValueError, "Parameter %d:%d has been removed from the list since the view was created", entry->node, entry->id);
+		return NULL;
+	}
+
+	/* CSH does not specify a paramver when listing parameters,
+		so we just use 2 as the default version for the created instances. */
+	return _pycsh_Parameter_from_param(&ParameterType, param, NULL, INT_MIN, pycsh_dfl_timeout, 1, 2);
+}
+
+static PyObject * ParameterListView_materialize(ParameterListViewObject *self, PyObject *args) {
+
+	PyObject * items AUTO_DECREF = PyList_New(self->count);
+	if (items == NULL) {
+		return NULL;
+	}
+
+	for (Py_ssize_t i = 0; i < self->count; i++) {
+		PyObject * parameter = ParameterListView_item(self, i);
+		if (parameter == NULL) {
+			return NULL;
+		}
+		PyList_SET_ITEM(items, i, parameter);  // Steals the reference
+	}
+
+	PyObject * list = PyObject_CallObject((PyObject *)&ParameterListType, NULL);
+	if (list == NULL) {
+		return NULL;
+	}
+
+	if (PyList_SetSlice(list, 0, 0, items) < 0) {
+		Py_DECREF(list);
+		return NULL;
+	}
+
+	return list;
+}
+
+/* Calls the ParameterList method of the same name, on a ParameterList materialized by the first call.
+	It is then reused, such that repeated pulls keep their serialized request. */
+static PyObject * ParameterListView_forward(ParameterListViewObject *self, const char * name, PyObject *args, PyObject *kwds) {
+
+	if (self->materialized == NULL) {
+		self->materialized = ParameterListView_materialize(self, NULL);
+		if (self->materialized == NULL) {
+			return NULL;
+		}
+	}
+
+	PyObject * method AUTO_DECREF = PyObject_GetAttrString(self->materialized, name);
+	if (method == NULL) {
+		return NULL;
+	}
+
+	return PyObject_Call(method, args, kwds);
+}
+
+static PyObject * ParameterListView_pull(ParameterListViewObject *self, PyObject *args, PyObject *kwds) {
+	return ParameterListView_forward(self, "pull", args, kwds);
+}
+
+static PyObject * ParameterListView_push(ParameterListViewObject *self, PyObject *args, PyObject *kwds) {
+	return ParameterListView_forward(self, "push", args, kwds);
+}
+
+static PyObject * ParameterListView_apull(ParameterListViewObject *self, PyObject *args, PyObject *kwds) {
+	return ParameterListView_forward(self, "apull", args, kwds);
+}
+
+static PyObject * ParameterListView_apush(ParameterListViewObject *self, PyObject *args, PyObject *kwds) {
+	return ParameterListView_forward(self, "apush", args, kwds);
+}
+
+static PyObject * ParameterListView_poll(ParameterListViewObject *self, PyObject *args, PyObject *kwds) {
+	return ParameterListView_forward(self, "poll", args, kwds);
+}
+
+static PyObject * ParameterListView_snapshot(ParameterListViewObject *self, PyObject *args) {
+	PyObject * noargs AUTO_DECREF = PyTuple_New(0);
+	if (noargs == NULL) {
+		return NULL;
+	}
+	return ParameterListView_forward(self, "snapshot", noargs, NULL);
+}
+
+static PyMethodDef ParameterListView_methods[] = {
+	{"materialize", (PyCFunction)ParameterListView_materialize, METH_NOARGS,
+     PyDoc_STR("Wrap every Parameter in the view, returning them as a ParameterList.")},
+	{"pull", (PyCFunction)ParameterListView_pull, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("ParameterList.pull() of the view, which is materialized by the first network call.")},
+	{"push", (PyCFunction)ParameterListView_push, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("ParameterList.push() of the view, which is materialized by the first network call.")},
+	{"apull", (PyCFunction)ParameterListView_apull, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("ParameterList.apull() of the view, which is materialized by the first network call.")},
+	{"apush", (PyCFunction)ParameterListView_apush, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("ParameterList.apush() of the view, which is materialized by the first network call.")},
+	{"poll", (PyCFunction)ParameterListView_poll, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("ParameterList.poll() of the view, which is materialized by the first network call.")},
+	{"snapshot", (PyCFunction)ParameterListView_snapshot, METH_NOARGS,
+     PyDoc_STR("ParameterList.snapshot() of the view, which is materialized by the first network call.")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods ParameterListView_as_sequence = {
+	.sq_length = (lenfunc)ParameterListView_length,
+	.sq_item = (ssizeargfunc)ParameterListView_item,
+};
+
+/* Read-only sequence of Parameters, which are only wrapped when accessed. */
+PyTypeObject ParameterListViewType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "pycsh.ParameterListView",
+	.tp_doc = "Lazily materialized sequence of Parameters, as returned by pycsh.list(lazy=True).\n"
+		"pull(), push(), apull(), apush(), poll() and snapshot() materialize it into a ParameterList on the first call.",
+	.tp_basicsize = sizeof(ParameterListViewObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)ParameterListView_dealloc,
+	.tp_as_sequence = &ParameterListView_as_sequence,
+	.tp_methods = ParameterListView_methods,
+};
@@ -0,0 +1,33 @@
+/*
+ * parameterlistview.h
+ *
+ * Contains the ParameterListView class,
+ * a lazily materialized sequence of Parameters, for filters matching very large parts of the list.
+ *
+ */
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+
+typedef struct {
+	int node;
+	int id;
+} ParameterListViewEntry;
+
+typedef struct {
+	PyObject_HEAD
+	/* Parameters are identified by (node, id) rather than param_t pointers,
+		as they may be "list forget"en before they are accessed. */
+	ParameterListViewEntry * entries;
+	Py_ssize_t count;
+	PyObject * materialized;  // ParameterList for pull(), push() and such, created by the first of them.
+} ParameterListViewObject;
+
+extern PyTypeObject ParameterListViewType;
+
+/* Create a view of the parameters matching the filters of pycsh_util_parameter_list() */
+PyObject * ParameterListView_from_filter(uint32_t mask, int node, const char * globstr);
@@ -17,6 +17,7 @@
 
 #include "../pycsh.h"
 #include "../utils.h"
+#include "../param_index.h"
 
 // Instantiated in our PyMODINIT_FUNC
 PyObject * PyExc_ParamCallbackError;
@@ -30,8 +31,7 @@ void Parameter_callback(param_t * param, int offset) {
     assert(Parameter_wraps_param(param));
     assert(!PyErr_Occurred());  // Callback may raise an exception. But we don't want to override an existing one.
 
-    PyObject *key AUTO_DECREF = PyLong_FromVoidPtr(param);
-    PythonParameterObject *python_param = (PythonParameterObject*)PyDict_GetItem((PyObject*)param_callback_dict, key);
+    PythonParameterObject *python_param = pycsh_ptrmap_get(&param_wrapper_map, param);
 
     /* This param_t uses the Python Parameter callback, but doesn't actually point to a Parameter.
         Perhaps it was deleted? Or perhaps it was never set correctly. */
@@ -50,11 +50,11 @@ void Parameter_callback(param_t * param, int offset) {
     }
 
     assert(PyCallable_Check(python_callback));
-    /* Create the arguments. */
-    PyObject *pyoffset AUTO_DECREF = Py_BuildValue("i", offset);
-    PyObject * args AUTO_DECREF = PyTuple_Pack(2, python_param, pyoffset);
-    /* Call the user Python callback */
-    PyObject *value AUTO_DECREF = PyObject_CallObject(python_callback, args);
+    /* Create the arguments. Offsets of up to 256 are cached small ints, so this doesn't allocate for most arrays. */
+    PyObject *pyoffset AUTO_DECREF = PyLong_FromLong(offset);
+    PyObject *args[] = {(PyObject*)python_param, pyoffset};
+    /* Call the user Python callback, vectorcall saves us packing the arguments into a tuple. */
+    PyObject *value AUTO_DECREF = PyObject_Vectorcall(python_callback, args, 2, NULL);
 
     if (PyErr_Occurred()) {
         /* It may not be clear to the user, that the exception came from the callback,
@@ -250,6 +250,7 @@ static void PythonParameter_dealloc(PythonParameterObject *self) {
 
     /* We defer deallocation to our Parameter baseclass,
         as it must also handle deallocation of param_t's that have been "list forget"en anyway. */
+    pycsh_param_index_remove(((ParameterObject*)self)->param);
     param_list_remove_specific(((ParameterObject*)self)->param, 0, 0);
 
     PyTypeObject *baseclass = pycsh_get_base_dealloc_class(&PythonParameterType);
@@ -328,13 +329,13 @@ PythonParameterObject * Parameter_create_new(PyTypeObject *type, uint16_t id, pa
             return NULL;
     }
 
-    if (param_list_find_id(0, id) != NULL) {
+    if (pycsh_param_index_find_id(0, id) != NULL) {
         /* Run away as quickly as possible if this ID is already in use, we would otherwise get a segfault, which is driving me insane. */
         PyErr_Format(PyExc_ValueError, "Parameter with id %d already exists", id);
         return NULL;
     }
 
-    if (param_list_find_name(0, name)) {
+    if (pycsh_param_index_find_name(0, name)) {
         /* While it is perhaps technically acceptable, it's probably best if we don't allow duplicate names either. */
         PyErr_Format(PyExc_ValueError, "Parameter with name \"%s\" already exists", name);
         return NULL;
@@ -357,6 +358,7 @@ PythonParameterObject * Parameter_create_new(PyTypeObject *type, uint16_t id, pa
 
     switch (param_list_add(new_param)) {
         case 0:
+            pycsh_param_index_add(new_param);
             break;  // All good
         case 1: {
             // It shouldn't be possible to arrive here, except perhaps from race conditions.
@@ -14,11 +14,13 @@
 #include <param/param.h>
 
 #include "parameter.h"
+#include "../pointer_map.h"
 
 extern PyObject * PyExc_ParamCallbackError;
 extern PyObject * PyExc_InvalidParameterTypeError;
 
-extern PyDictObject * param_callback_dict;
+/* Maps param_t's to the ParameterObject wrapping them. Only accessed with the GIL held. */
+extern pycsh_ptrmap_t param_wrapper_map;
 
 typedef struct {
     ParameterObject parameter_object;
@@ -0,0 +1,129 @@
+/*
+ * pointer_map.c
+ *
+ * Open addressing hash map from one pointer to another.
+ *
+ */
+
+#include "pointer_map.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Marks a removed entry, so probing continues past it. */
+#define PTRMAP_TOMBSTONE ((const void *)1)
+#define PTRMAP_MIN_CAPACITY 64
+
+static inline size_t pycsh_ptrmap_hash(const void * key) {
+	uint64_t h = (uint64_t)(uintptr_t)key;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return (size_t)h;
+}
+
+void * pycsh_ptrmap_get(const pycsh_ptrmap_t * map, const void * key) {
+
+	if (map->capacity == 0) {
+		return NULL;
+	}
+
+	size_t mask = map->capacity - 1;
+	for (size_t i = pycsh_ptrmap_hash(key) & mask;; i = (i + 1) & mask) {
+		const pycsh_ptrmap_entry_t * entry = &map->entries[i];
+		if (entry->key == key) {
+			return entry->value;
+		}
+		if (entry->key == NULL) {
+			return NULL;
+		}
+	}
+}
+
+static int pycsh_ptrmap_resize(pycsh_ptrmap_t * map) {
+
+	/* Tombstones are dropped by rehashing, so only grow when the live entries need it. */
+	size_t live = 0;
+	for (size_t i = 0; i < map->capacity; i++) {
+		if (map->entries[i].key != NULL && map->entries[i].key != PTRMAP_TOMBSTONE) {
+			live++;
+		}
+	}
+
+	size_t capacity = PTRMAP_MIN_CAPACITY;
+	while ((live + 1) * 2 > capacity) {
+		capacity *= 2;
+	}
+
+	pycsh_ptrmap_entry_t * entries = calloc(capacity, sizeof(pycsh_ptrmap_entry_t));
+	if (entries == NULL) {
+		return -1;
+	}
+
+	pycsh_ptrmap_t old = *map;
+	*map = (pycsh_ptrmap_t){
+		.entries = entries,
+		.capacity = capacity,
+	};
+
+	for (size_t i = 0; i < old.capacity; i++) {
+		if (old.entries[i].key != NULL && old.entries[i].key != PTRMAP_TOMBSTONE) {
+			pycsh_ptrmap_set(map, old.entries[i].key, old.entries[i].value);
+		}
+	}
+
+	free(old.entries);
+	return 0;
+}
+
+int pycsh_ptrmap_set(pycsh_ptrmap_t * map, const void * key, void * value) {
+
+	/* Keep the load factor (including tombstones) below 3/4 */
+	if ((map->used + 1) * 4 > map->capacity * 3 && pycsh_ptrmap_resize(map) < 0) {
+		return -1;
+	}
+
+	size_t mask = map->capacity - 1;
+	pycsh_ptrmap_entry_t * tombstone = NULL;
+	for (size_t i = pycsh_ptrmap_hash(key) & mask;; i = (i + 1) & mask) {
+		pycsh_ptrmap_entry_t * entry = &map->entries[i];
+		if (entry->key == key) {
+			entry->value = value;
+			return 0;
+		}
+		if (entry->key == PTRMAP_TOMBSTONE && tombstone == NULL) {
+			tombstone = entry;
+		}
+		if (entry->key == NULL) {
+			if (tombstone) {
+				entry = tombstone;  // Reuse the first tombstone, which is already counted as used.
+			} else {
+				map->used++;
+			}
+			entry->key = key;
+			entry->value = value;
+			return 0;
+		}
+	}
+}
+
+void * pycsh_ptrmap_remove(pycsh_ptrmap_t * map, const void * key) {
+
+	if (map->capacity == 0) {
+		return NULL;
+	}
+
+	size_t mask = map->capacity - 1;
+	for (size_t i = pycsh_ptrmap_hash(key) & mask;; i = (i + 1) & mask) {
+		pycsh_ptrmap_entry_t * entry = &map->entries[i];
+		if (entry->key == key) {
+			void * value = entry->value;
+			entry->key = PTRMAP_TOMBSTONE;
+			entry->value = NULL;
+			return value;
+		}
+		if (entry->key == NULL) {
+			return NULL;
+		}
+	}
+}
@@ -0,0 +1,33 @@
+/*
+ * pointer_map.h
+ *
+ * Open addressing hash map from one pointer to another,
+ * for lookups that must not allocate Python objects (i.e param_t -> ParameterObject in callbacks).
+ *
+ * A zero-initialized pycsh_ptrmap_t is a valid empty map.
+ * Not thread-safe, callers must provide their own locking (i.e the GIL).
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct {
+	const void * key;
+	void * value;
+} pycsh_ptrmap_entry_t;
+
+typedef struct {
+	pycsh_ptrmap_entry_t * entries;
+	size_t capacity;  // Always a power of 2, or 0
+	size_t used;  // Including tombstones
+} pycsh_ptrmap_t;
+
+/* Returns the value of the key, or NULL when not present. */
+void * pycsh_ptrmap_get(const pycsh_ptrmap_t * map, const void * key);
+
+/* Inserts or replaces the value of the key. Returns 0 on success, -1 when out of memory. */
+int pycsh_ptrmap_set(pycsh_ptrmap_t * map, const void * key, void * value);
+
+/* Removes the key, returning its value, or NULL when not present. */
+void * pycsh_ptrmap_remove(pycsh_ptrmap_t * map, const void * key);
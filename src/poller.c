@@ -0,0 +1,448 @@
+/*
+ * poller.c
+ *
+ * Contains the Poller class, returned by ParameterList.poll(),
+ * which periodically pulls the list from a scheduler thread (and workers) shared by every Poller.
+ *
+ * The scheduler sleeps until the earliest absolute deadline (CLOCK_MONOTONIC),
+ * so the period doesn't drift with the time spent pulling.
+ * Due Pollers are handed to a pool of workers, so a node that doesn't respond only delays its own Poller,
+ * and the workers only take the GIL to deliver the update of their poll.
+ *
+ */
+
+#include "poller.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "utils.h"
+
+/* Number of Pollers performed at once. */
+#define POLLER_WORKERS PYCSH_MAX_IN_FLIGHT_LIMIT
+
+static PollerObject * pollers = NULL;
+/* Due Pollers waiting for a worker, linked through ->ready_next */
+static PollerObject * ready_head = NULL;
+static PollerObject * ready_tail = NULL;
+static pthread_mutex_t scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scheduler_cond;
+static pthread_cond_t worker_cond;
+static pthread_once_t scheduler_once = PTHREAD_ONCE_INIT;
+static int scheduler_started = 0;
+static int scheduler_exiting = 0;
+static pthread_t scheduler_thread;
+static pthread_t worker_threads[POLLER_WORKERS];
+static unsigned int worker_count = 0;
+
+static uint64_t poller_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Sleep until the absolute deadline, or until signalled by a new, stopped or completed Poller.
+	Must be called with scheduler_lock held. */
+static void poller_wait_until(uint64_t deadline_ns) {
+	struct timespec ts = {
+		.tv_sec = deadline_ns / 1000000000ULL,
+		.tv_nsec = deadline_ns % 1000000000ULL,
+	};
+	pthread_cond_timedwait(&scheduler_cond, &scheduler_lock, &ts);
+}
+
+/* Unlinks stopped Pollers that aren't being performed into 'stopped', must be called with scheduler_lock held. */
+static PollerObject * poller_unlink_stopped(void) {
+
+	PollerObject * stopped = NULL;
+
+	PollerObject ** link = &pollers;
+	while (*link != NULL) {
+		PollerObject * poller = *link;
+		if (poller->stopping && !poller->busy) {
+			*link = poller->next;
+			poller->next = stopped;
+			stopped = poller;
+		} else {
+			link = &poller->next;
+		}
+	}
+
+	return stopped;
+}
+
+/* Delivers the update of a Poller that just pulled, must be called with the GIL. */
+static void poller_deliver(PollerObject * poller) {
+	if (poller->on_update == NULL || poller->stopping) {
+		return;
+	}
+	PyObject * res = PyObject_CallOneArg(poller->on_update, poller->plist);
+	if (res == NULL) {
+		PyErr_WriteUnraisable(poller->on_update);
+	}
+	Py_XDECREF(res);
+}
+
+static void * poller_worker(void * arg) {
+
+	pthread_mutex_lock(&scheduler_lock);
+
+	while (1) {
+
+		if (ready_head == NULL) {
+			if (scheduler_exiting) {
+				break;
+			}
+			pthread_cond_wait(&worker_cond, &scheduler_lock);
+			continue;
+		}
+
+		PollerObject * poller = ready_head;
+		ready_head = poller->ready_next;
+		if (ready_head == NULL) {
+			ready_tail = NULL;
+		}
+		poller->ready_next = NULL;
+
+		if (poller->stopping) {
+			poller->busy = 0;
+			pthread_cond_signal(&scheduler_cond);
+			continue;
+		}
+
+		pthread_mutex_unlock(&scheduler_lock);
+
+		uint64_t start = poller_now_ns();
+		int failed = pycsh_segmented_queue_run(&poller->queue, poller->timeout, poller->retries, poller->max_in_flight, 0);
+		uint64_t finish = poller_now_ns();
+		/* Nodes that did respond are still delivered, when others of a grouped list didn't. */
+		int succeeded = (poller->queue.item_count == 0 || !pycsh_segmented_queue_all_failed(&poller->queue));
+
+		pthread_mutex_lock(&scheduler_lock);
+		poller->jitter_ns[poller->jitter_count++ % POLLER_JITTER_SAMPLES] = start - poller->next_deadline_ns;
+		poller->polls++;
+		if (failed) {
+			poller->timeouts++;
+		}
+		/* Keep the original phase, skipping the periods we missed. */
+		poller->next_deadline_ns += poller->period_ns;
+		while (poller->next_deadline_ns <= finish) {
+			poller->next_deadline_ns += poller->period_ns;
+			poller->overruns++;
+		}
+		pthread_mutex_unlock(&scheduler_lock);
+
+		/* The scheduler keeps its reference while we're busy, so the Poller is still alive.
+			Nobody is waiting for updates once the interpreter is shutting down. */
+		if (succeeded && !_Py_IsFinalizing()) {
+			PyGILState_STATE gstate = PyGILState_Ensure();
+			poller_deliver(poller);
+			PyGILState_Release(gstate);
+		}
+
+		pthread_mutex_lock(&scheduler_lock);
+		poller->busy = 0;
+		pthread_cond_signal(&scheduler_cond);
+	}
+
+	pthread_mutex_unlock(&scheduler_lock);
+	return NULL;
+}
+
+static void * poller_scheduler(void * arg) {
+
+	pthread_mutex_lock(&scheduler_lock);
+
+	while (1) {
+
+		PollerObject * stopped = poller_unlink_stopped();
+		if (stopped != NULL) {
+			/* Release the references held by the scheduler, which may deallocate the Pollers.
+				They are leaked when the interpreter is already shutting down. */
+			pthread_mutex_unlock(&scheduler_lock);
+			if (!_Py_IsFinalizing()) {
+				PyGILState_STATE gstate = PyGILState_Ensure();
+				while (stopped != NULL) {
+					PollerObject * next = stopped->next;
+					stopped->next = NULL;
+					Py_DECREF(stopped);
+					stopped = next;
+				}
+				PyGILState_Release(gstate);
+			}
+			pthread_mutex_lock(&scheduler_lock);
+			continue;
+		}
+
+		if (pollers == NULL) {
+			if (scheduler_exiting) {
+				break;
+			}
+			pthread_cond_wait(&scheduler_cond, &scheduler_lock);
+			continue;
+		}
+
+		/* Pollers being performed are scheduled again once their worker is done. */
+		uint64_t earliest = UINT64_MAX;
+		for (PollerObject * poller = pollers; poller != NULL; poller = poller->next) {
+			if (!poller->busy && !poller->stopping && poller->next_deadline_ns < earliest) {
+				earliest = poller->next_deadline_ns;
+			}
+		}
+
+		if (earliest == UINT64_MAX) {
+			pthread_cond_wait(&scheduler_cond, &scheduler_lock);
+			continue;
+		}
+
+		uint64_t now = poller_now_ns();
+		if (now < earliest) {
+			poller_wait_until(earliest);
+			continue;  // Pollers may have been added, stopped or completed meanwhile.
+		}
+
+		for (PollerObject * poller = pollers; poller != NULL; poller = poller->next) {
+			if (poller->busy || poller->stopping || poller->next_deadline_ns > now) {
+				continue;
+			}
+			poller->busy = 1;
+			poller->ready_next = NULL;
+			if (ready_tail != NULL) {
+				ready_tail->ready_next = poller;
+			} else {
+				ready_head = poller;
+			}
+			ready_tail = poller;
+			pthread_cond_signal(&worker_cond);
+		}
+	}
+
+	pthread_mutex_unlock(&scheduler_lock);
+	return NULL;
+}
+
+/* Stops every Poller and waits for the threads to exit, registered with atexit once the scheduler is started.
+	Must be called with the GIL, which is released while waiting, as the threads may need it to finish. */
+static PyObject * poller_atexit(PyObject * self, PyObject * Py_UNUSED(ignored)) {
+
+	pthread_mutex_lock(&scheduler_lock);
+	scheduler_exiting = 1;
+	for (PollerObject * poller = pollers; poller != NULL; poller = poller->next) {
+		if (!poller->stopping) {
+			poller->stopping = 1;
+			poller->stopped_ns = poller_now_ns();
+		}
+	}
+	pthread_cond_broadcast(&scheduler_cond);
+	pthread_cond_broadcast(&worker_cond);
+	pthread_mutex_unlock(&scheduler_lock);
+
+	Py_BEGIN_ALLOW_THREADS;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		pthread_join(worker_threads[i], NULL);
+	}
+	if (scheduler_started) {
+		pthread_join(scheduler_thread, NULL);
+	}
+	Py_END_ALLOW_THREADS;
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef poller_atexit_def = {"_pycsh_poller_atexit", poller_atexit, METH_NOARGS, NULL};
+
+static void poller_scheduler_start(void) {
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&scheduler_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_cond_init(&worker_cond, NULL);
+
+	/* Called from Poller_start(), so we hold the GIL. */
+	PyObject * atexit AUTO_DECREF = PyImport_ImportModule("atexit");
+	PyObject * hook AUTO_DECREF = PyCFunction_New(&poller_atexit_def, NULL);
+	PyObject * res AUTO_DECREF = (atexit != NULL && hook != NULL) ? PyObject_CallMethod(atexit, "register", "O", hook) : NULL;
+	if (res == NULL) {
+		PyErr_Clear();
+		return;  // Without a way to stop the threads, we don't start them.
+	}
+
+	for (; worker_count < POLLER_WORKERS; worker_count++) {
+		if (pthread_create(&worker_threads[worker_count], NULL, poller_worker, NULL) != 0) {
+			break;
+		}
+	}
+
+	if (worker_count > 0 && pthread_create(&scheduler_thread, NULL, poller_scheduler, NULL) == 0) {
+		scheduler_started = 1;
+	}
+}
+
+PyObject * Poller_start(PyObject * plist, pycsh_segmented_queue_t * queue, double period, PyObject * on_update, int timeout, int retries, int max_in_flight) {
+
+	if (period <= 0) {
+		PyErr_SetString(PyExc_ValueError, "period must be positive");
+		return NULL;
+	}
+
+	if (on_update != NULL && on_update != Py_None && !PyCallable_Check(on_update)) {
+		PyErr_SetString(PyExc_TypeError, "on_update must be callable or None");
+		return NULL;
+	}
+
+	pthread_once(&scheduler_once, poller_scheduler_start);
+	if (!scheduler_started) {
+		PyErr_SetString(PyExc_RuntimeError, "Failed to start the poller thread");
+		return NULL;
+	}
+
+	pthread_mutex_lock(&scheduler_lock);
+	int exiting = scheduler_exiting;
+	pthread_mutex_unlock(&scheduler_lock);
+	if (exiting) {
+		PyErr_SetString(PyExc_RuntimeError, "Pollers can't be started while the interpreter is exiting");
+		return NULL;
+	}
+
+	PollerObject * self = (PollerObject *)PollerType.tp_alloc(&PollerType, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	self->plist = Py_NewRef(plist);
+	self->on_update = (on_update != NULL && on_update != Py_None) ? Py_NewRef(on_update) : NULL;
+	self->queue = *queue;
+	pycsh_segmented_queue_init(queue, queue->type, queue->version);  // The Poller owns the segments now.
+	self->timeout = timeout;
+	self->retries = retries;
+	self->max_in_flight = max_in_flight;
+	self->period_ns = period * 1E9;
+
+	pthread_mutex_lock(&scheduler_lock);
+	self->started_ns = poller_now_ns();
+	self->next_deadline_ns = self->started_ns;
+	self->next = pollers;
+	pollers = (PollerObject *)Py_NewRef(self);  // Reference held by the scheduler until stopped.
+	pthread_cond_signal(&scheduler_cond);
+	pthread_mutex_unlock(&scheduler_lock);
+
+	return (PyObject *)self;
+}
+
+static PyObject * Poller_stop(PollerObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	pthread_mutex_lock(&scheduler_lock);
+	if (!self->stopping) {
+		self->stopping = 1;
+		self->stopped_ns = poller_now_ns();
+		pthread_cond_signal(&scheduler_cond);
+	}
+	pthread_mutex_unlock(&scheduler_lock);
+
+	Py_RETURN_NONE;
+}
+
+static int poller_compare_jitter(const void * a, const void * b) {
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static PyObject * Poller_get_stats(PollerObject *self, void *closure) {
+
+	int64_t jitter[POLLER_JITTER_SAMPLES];
+
+	pthread_mutex_lock(&scheduler_lock);
+	uint64_t polls = self->polls;
+	uint64_t timeouts = self->timeouts;
+	uint64_t overruns = self->overruns;
+	uint64_t elapsed = (self->stopping ? self->stopped_ns : poller_now_ns()) - self->started_ns;
+	size_t samples = self->jitter_count < POLLER_JITTER_SAMPLES ? self->jitter_count : POLLER_JITTER_SAMPLES;
+	memcpy(jitter, self->jitter_ns, samples * sizeof(int64_t));
+	pthread_mutex_unlock(&scheduler_lock);
+
+	qsort(jitter, samples, sizeof(int64_t), poller_compare_jitter);
+
+	/* Nearest-rank percentiles of how late the polls were started, in milliseconds. */
+	#define JITTER_PERCENTILE(p) (samples ? jitter[(size_t)((samples - 1) * (p))] / 1E6 : 0.0)
+
+	return Py_BuildValue("{sKsdsKsKsdsdsdsd}",
+		"polls", (unsigned long long)polls,
+		"rate", elapsed ? polls / (elapsed / 1E9) : 0.0,
+		"timeouts", (unsigned long long)timeouts,
+		"overruns", (unsigned long long)overruns,
+		"jitter_p50_ms", JITTER_PERCENTILE(0.50),
+		"jitter_p90_ms", JITTER_PERCENTILE(0.90),
+		"jitter_p99_ms", JITTER_PERCENTILE(0.99),
+		"jitter_max_ms", JITTER_PERCENTILE(1.0));
+
+	#undef JITTER_PERCENTILE
+}
+
+static PyObject * Poller_get_running(PollerObject *self, void *closure) {
+	pthread_mutex_lock(&scheduler_lock);
+	int running = !self->stopping;
+	pthread_mutex_unlock(&scheduler_lock);
+	return PyBool_FromLong(running);
+}
+
+static PyObject * Poller_get_period(PollerObject *self, void *closure) {
+	return PyFloat_FromDouble(self->period_ns / 1E9);
+}
+
+static PyObject * Poller_get_list(PollerObject *self, void *closure) {
+	return Py_NewRef(self->plist);
+}
+
+static PyObject * Poller_enter(PollerObject *self, PyObject *Py_UNUSED(ignored)) {
+	return Py_NewRef(self);
+}
+
+static PyObject * Poller_exit(PollerObject *self, PyObject *args) {
+	Py_XDECREF(Poller_stop(self, NULL));
+	Py_RETURN_FALSE;
+}
+
+static void Poller_dealloc(PollerObject *self) {
+	/* Only reachable once the scheduler has released its reference, so the queue is no longer in use. */
+	pycsh_segmented_queue_free(&self->queue);
+	Py_XDECREF(self->plist);
+	Py_XDECREF(self->on_update);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyMethodDef Poller_methods[] = {
+	{"stop", (PyCFunction)Poller_stop, METH_NOARGS,
+     PyDoc_STR("Stop polling, an ongoing pull is completed first.")},
+	{"__enter__", (PyCFunction)Poller_enter, METH_NOARGS,
+     PyDoc_STR("Returns the Poller itself.")},
+	{"__exit__", (PyCFunction)Poller_exit, METH_VARARGS,
+     PyDoc_STR("Stops the Poller.")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Poller_getsetters[] = {
+	{"stats", (getter)Poller_get_stats, NULL,
+     "dict with the number of polls, achieved rate, timeouts, overruns and jitter percentiles", NULL},
+	{"running", (getter)Poller_get_running, NULL,
+     "whether the Poller has yet to be stopped", NULL},
+	{"period", (getter)Poller_get_period, NULL,
+     "period between polls in seconds", NULL},
+	{"list", (getter)Poller_get_list, NULL,
+     "the ParameterList being polled", NULL},
+    {NULL, NULL, NULL, NULL}  /* Sentinel */
+};
+
+PyTypeObject PollerType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "pycsh.Poller",
+	.tp_doc = "Periodically pulls a ParameterList from a shared scheduler thread, see ParameterList.poll().",
+	.tp_basicsize = sizeof(PollerObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)Poller_dealloc,
+	.tp_methods = Poller_methods,
+	.tp_getset = Poller_getsetters,
+};
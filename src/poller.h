@@ -0,0 +1,56 @@
+/*
+ * poller.h
+ *
+ * Contains the Poller class, returned by ParameterList.poll(),
+ * which periodically pulls the list from a scheduler thread (and workers) shared by every Poller.
+ *
+ */
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+
+#include "segmented_queue.h"
+
+/* Number of most recent start times used for the jitter percentiles. */
+#define POLLER_JITTER_SAMPLES 1024
+
+typedef struct PollerObject {
+	PyObject_HEAD
+
+	PyObject * plist;  // ParameterList being polled, keeps its Parameters (and param_t's) alive.
+	PyObject * on_update;  // Callable or NULL
+
+	pycsh_segmented_queue_t queue;  // Only used by the worker performing the Poller once started.
+	int timeout;
+	int retries;
+	int max_in_flight;
+	uint64_t period_ns;
+
+	/* Protected by the scheduler lock */
+	uint64_t next_deadline_ns;
+	uint64_t started_ns;
+	uint64_t stopped_ns;
+	int stopping;  // The scheduler releases its reference to us once set, and we're no longer busy.
+	int busy;  // Handed to a worker, which has yet to complete the poll.
+	struct PollerObject * ready_next;  // Due Pollers waiting for a worker.
+	uint64_t polls;
+	uint64_t timeouts;
+	uint64_t overruns;
+	int64_t jitter_ns[POLLER_JITTER_SAMPLES];  // How late each poll was started.
+	size_t jitter_count;
+	struct PollerObject * next;
+} PollerObject;
+
+extern PyTypeObject PollerType;
+
+/**
+ * @brief Start polling with the queue, which is taken over by the new Poller.
+ *
+ * @param on_update Called with the ParameterList after each successful pull, or None.
+ * @return PyObject* New reference to the started Poller.
+ */
+PyObject * Poller_start(PyObject * plist, pycsh_segmented_queue_t * queue, double period, PyObject * on_update, int timeout, int retries, int max_in_flight);
@@ -20,6 +20,7 @@
 #include <sys/utsname.h>
 
 #include <param/param.h>
+#include <param/param_server.h>
 #ifdef PARAM_HAVE_COMMANDS
 #include <param/param_commands.h>
 #endif
@@ -59,6 +60,9 @@
 #include "parameter/pythongetsetparameter.h"
 #include "parameter/pythongetsetarrayparameter.h"
 #include "parameter/parameterlist.h"
+#include "parameter/parameterlistview.h"
+#include "batch.h"
+#include "poller.h"
 
 #include "csp_classes/ident.h"
 
@@ -112,6 +116,7 @@ unsigned int pycsh_dfl_node = 0;
 unsigned int pycsh_dfl_timeout = 1000;
 #endif
 unsigned int pycsh_dfl_verbose = -1;
+unsigned int pycsh_dfl_max_in_flight = 4;
 
 uint64_t clock_get_nsec(void) {
 	struct timespec ts;
@@ -247,6 +252,13 @@ static PyMethodDef methods[] = {
 	/* Converted CSH commands from libparam/src/param/param_slash.c */
 	{"get", 		(PyCFunction)pycsh_param_get, 	METH_VARARGS | METH_KEYWORDS, "Set the value of a parameter."},
 	{"set", 		(PyCFunction)pycsh_param_set, 	METH_VARARGS | METH_KEYWORDS, "Get the value of a parameter."},
+	{"get_many", 	(PyCFunction)pycsh_param_get_many, METH_VARARGS | METH_KEYWORDS, "Get the values of multiple parameters, pulled concurrently per node."},
+	{"set_many", 	(PyCFunction)pycsh_param_set_many, METH_VARARGS | METH_KEYWORDS, "Set the values of multiple parameters, pushed concurrently per node."},
+	{"aget", 		(PyCFunction)pycsh_param_aget, 	METH_VARARGS | METH_KEYWORDS, "Awaitable equivalent of get()."},
+	{"aset", 		(PyCFunction)pycsh_param_aset, 	METH_VARARGS | METH_KEYWORDS, "Awaitable equivalent of set()."},
+	{"batch", 		(PyCFunction)pycsh_batch, 		METH_VARARGS | METH_KEYWORDS, "Context manager which queues remote sets, and pushes them on exit."},
+	{"cache_stats", (PyCFunction)pycsh_param_cache_stats, METH_VARARGS | METH_KEYWORDS, "Hit and miss counts of reads using max_age."},
+	{"queue_stats", (PyCFunction)pycsh_param_queue_stats, METH_VARARGS | METH_KEYWORDS, "Packets, bytes and timeouts of parameter requests."},
 	// {"push", 		(PyCFunction)pycsh_param_push,	METH_VARARGS | METH_KEYWORDS, "Push the current queue."},
 	{"pull", 		(PyCFunction)pycsh_param_pull,	METH_VARARGS | METH_KEYWORDS, "Pull all or a specific set of parameters."},
 	{"cmd_done", 	pycsh_param_cmd_done, 			METH_NOARGS, 				  "Clears the queue."},
@@ -254,6 +266,11 @@ static PyMethodDef methods[] = {
 	{"node", 		pycsh_slash_node, 			  	METH_VARARGS, 				  "Used to get or change the default node."},
 	{"timeout", 	pycsh_slash_timeout, 			METH_VARARGS, 		  		  "Used to get or change the default timeout."},
 	{"verbose", 	pycsh_slash_verbose, 			METH_VARARGS, 		  		  "Used to get or change the default parameter verbosity."},
+	{"max_in_flight", pycsh_max_in_flight, 		METH_VARARGS, 		  		  "Used to get or change the default number of packets in flight, for requests larger than a single packet."},
+	{"async_workers", pycsh_async_workers, 		METH_VARARGS, 		  		  "Used to get or change the maximum number of awaitable requests in flight at once."},
+	{"history_limit", pycsh_history_limit, 		METH_VARARGS, 		  		  "Used to get or change the global memory limit (in bytes) of parameter histories."},
+	{"sniffer_cache", pycsh_sniffer_cache, 		METH_VARARGS, 		  		  "Used to get or change whether sniffed values are written to the cached value of remote parameters."},
+	{"coalesce", 	pycsh_coalesce, 				METH_VARARGS, 		  		  "Used to get or change the window (in ms) for coalescing single parameter requests into shared packets."},
 	{"queue", 		pycsh_param_cmd,			  	METH_NOARGS, 				  "Print the current command."},
 
 	/* Converted CSH commands from libparam/src/param/list/param_list_slash.c */
@@ -348,6 +365,15 @@ PyMODINIT_FUNC PyInit_pycsh(void) {
 	if (PyType_Ready(&ParameterListType) < 0)
 		return NULL;
 
+	if (PyType_Ready(&ParameterListViewType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&BatchType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PollerType) < 0)
+		return NULL;
+
 
 	if (PyType_Ready(&IdentType) < 0)
         return NULL;
@@ -388,6 +414,14 @@ PyMODINIT_FUNC PyInit_pycsh(void) {
 			PyExc_ValueError, NULL);
 		Py_IncRef(PyExc_InvalidParameterTypeError);
 		PyModule_AddObject(m, "ParamCallbackError", PyExc_InvalidParameterTypeError);
+
+		PyExc_PartialResponseError = PyErr_NewExceptionWithDoc("pycsh.PartialResponseError", 
+			"Raised when only some of the packets of a segmented request received a response.\n"
+			"args[1] is a list of the Parameters in the failed packets.\n"
+			"Must be caught before ConnectionError() baseclass.",
+			PyExc_ConnectionError, NULL);
+		Py_IncRef(PyExc_PartialResponseError);
+		PyModule_AddObject(m, "PartialResponseError", PyExc_PartialResponseError);
 	}
 
 	Py_INCREF(&ParameterType);
@@ -439,6 +473,27 @@ PyMODINIT_FUNC PyInit_pycsh(void) {
 		return NULL;
 	}
 
+	Py_INCREF(&ParameterListViewType);
+	if (PyModule_AddObject(m, "ParameterListView", (PyObject *)&ParameterListViewType) < 0) {
+		Py_DECREF(&ParameterListViewType);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	Py_INCREF(&BatchType);
+	if (PyModule_AddObject(m, "Batch", (PyObject *)&BatchType) < 0) {
+		Py_DECREF(&BatchType);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	Py_INCREF(&PollerType);
+	if (PyModule_AddObject(m, "Poller", (PyObject *)&PollerType) < 0) {
+		Py_DECREF(&PollerType);
+		Py_DECREF(m);
+		return NULL;
+	}
+
 
 	Py_INCREF(&IdentType);
 	if (PyModule_AddObject(m, "Ident", (PyObject *) &IdentType) < 0) {
@@ -508,11 +563,11 @@ PyMODINIT_FUNC PyInit_pycsh(void) {
 		PyModule_AddObject(m, "PM_PRIO3", PyLong_FromLong(PM_PRIO3));
 		PyModule_AddObject(m, "PM_PRIO_MASK", PyLong_FromLong(PM_PRIO_MASK));
 
+		PyModule_AddObject(m, "PARAM_SERVER_MTU", PyLong_FromLong(PARAM_SERVER_MTU));
+
 		// TODO Kevin: We should probably add constants for SLASH_SUCCESS and such
 	}
 
-	param_callback_dict = (PyDictObject *)PyDict_New();
-
 	{  /* Argumentless CSH init */
 		#ifdef PYCSH_HAVE_SLASH
 			slash_list_init();
@@ -36,3 +36,4 @@ extern unsigned int pycsh_dfl_timeout;  // In milliseconds
 extern unsigned int pycsh_dfl_node;
 #endif
 extern unsigned int pycsh_dfl_verbose;
+extern unsigned int pycsh_dfl_max_in_flight;  // Packets in flight at once, when a request is split into several
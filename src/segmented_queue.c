@@ -0,0 +1,423 @@
+/*
+ * segmented_queue.c
+ *
+ * Splits parameter requests that don't fit in a single PARAM_SERVER_MTU queue,
+ * into multiple packets, and performs them with a configurable number of requests in flight.
+ *
+ */
+
+#include "segmented_queue.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <csp/csp.h>
+#include <param/param_client.h>
+
+#include "param_history.h"
+#include "param_cache.h"
+#include "param_shadow.h"
+
+static atomic_uint_fast64_t sent_packets = 0;
+static atomic_uint_fast64_t sent_bytes = 0;
+static atomic_uint_fast64_t sent_timeouts = 0;
+
+void pycsh_segmented_queue_counters(uint64_t * packets, uint64_t * bytes, uint64_t * timeouts, int reset) {
+	if (reset) {
+		*packets = atomic_exchange(&sent_packets, 0);
+		*bytes = atomic_exchange(&sent_bytes, 0);
+		*timeouts = atomic_exchange(&sent_timeouts, 0);
+	} else {
+		*packets = atomic_load(&sent_packets);
+		*bytes = atomic_load(&sent_bytes);
+		*timeouts = atomic_load(&sent_timeouts);
+	}
+}
+
+uint64_t pycsh_segmented_queue_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+size_t pycsh_segmented_queue_host_count(const pycsh_segmented_queue_t * sq) {
+	size_t hosts = 0;
+	for (size_t i = 0; i < sq->item_count; i++) {
+		size_t j = 0;
+		while (j < i && sq->items[j].host != sq->items[i].host) {
+			j++;
+		}
+		hosts += (j == i);
+	}
+	return hosts;
+}
+
+void pycsh_segmented_queue_init(pycsh_segmented_queue_t * sq, param_queue_type_e type, int version) {
+	*sq = (pycsh_segmented_queue_t){
+		.type = type,
+		.version = version,
+		.single_flight = (type == PARAM_QUEUE_TYPE_GET),
+	};
+}
+
+void pycsh_segmented_queue_release(pycsh_segmented_queue_t * sq, int result) {
+	for (size_t i = 0; i < sq->item_count; i++) {
+		pycsh_segment_item_t * item = &sq->items[i];
+		if (item->flight == NULL) {
+			continue;
+		}
+		if (item->following) {
+			pycsh_flight_leave(item->flight);
+		} else {
+			pycsh_flight_land(item->flight, result);
+		}
+		item->flight = NULL;
+		item->following = 0;
+	}
+}
+
+void pycsh_segmented_queue_claim(pycsh_segmented_queue_t * sq) {
+
+	if (sq->type != PARAM_QUEUE_TYPE_GET) {
+		return;
+	}
+
+	for (size_t i = 0; i < sq->segment_count; i++) {
+		sq->segments[i]->borrowed = 1;  // Until one of its items is led by us.
+	}
+
+	for (size_t i = 0; i < sq->item_count; i++) {
+		pycsh_segment_item_t * item = &sq->items[i];
+		item->result = 0;
+		if (item->segment == PYCSH_SEGMENT_BORROWED || item->flight != NULL) {
+			continue;  // Already claimed when added.
+		}
+		int leader = 1;
+		item->flight = pycsh_flight_join(item->host, item->param->node, item->param->id, item->offset, &leader);
+		item->following = (item->flight != NULL && !leader);
+		if (!item->following) {
+			sq->segments[item->segment]->borrowed = 0;
+		}
+	}
+}
+
+void pycsh_segmented_queue_free(pycsh_segmented_queue_t * sq) {
+	pycsh_segmented_queue_release(sq, -1);
+	int single_flight = sq->single_flight;
+	uint64_t deadline_ns = sq->deadline_ns;
+	for (size_t i = 0; i < sq->segment_count; i++) {
+		free(sq->segments[i]);
+	}
+	free(sq->segments);
+	free(sq->items);
+	pycsh_segmented_queue_init(sq, sq->type, sq->version);
+	sq->single_flight = single_flight;
+	sq->deadline_ns = deadline_ns;
+}
+
+static pycsh_queue_segment_t * pycsh_segmented_queue_new_segment(pycsh_segmented_queue_t * sq, int host) {
+
+	pycsh_queue_segment_t ** segments = realloc(sq->segments, (sq->segment_count + 1) * sizeof(*segments));
+	if (segments == NULL) {
+		return NULL;
+	}
+	sq->segments = segments;
+
+	pycsh_queue_segment_t * segment = calloc(1, sizeof(pycsh_queue_segment_t));
+	if (segment == NULL) {
+		return NULL;
+	}
+
+	segment->host = host;
+	param_queue_init(&segment->queue, segment->buffer, PARAM_SERVER_MTU, 0, sq->type, sq->version);
+	sq->segments[sq->segment_count++] = segment;
+	return segment;
+}
+
+int pycsh_segmented_queue_add(pycsh_segmented_queue_t * sq, param_t * param, int offset, void * value, int host) {
+
+	if (sq->item_count >= sq->item_capacity) {
+		size_t capacity = sq->item_capacity ? sq->item_capacity * 2 : 16;
+		pycsh_segment_item_t * items = realloc(sq->items, capacity * sizeof(*items));
+		if (items == NULL) {
+			return -1;
+		}
+		sq->items = items;
+		sq->item_capacity = capacity;
+	}
+
+	pycsh_flight_t * flight = NULL;
+	if (sq->single_flight && sq->type == PARAM_QUEUE_TYPE_GET) {
+		int leader;
+		flight = pycsh_flight_join(host, param->node, param->id, offset, &leader);
+		if (flight != NULL && !leader) {
+			/* Someone else is already pulling it, wait for their response in pycsh_segmented_queue_run() */
+			sq->items[sq->item_count++] = (pycsh_segment_item_t){
+				.param = param,
+				.offset = offset,
+				.host = host,
+				.segment = PYCSH_SEGMENT_BORROWED,
+				.flight = flight,
+				.following = 1,
+			};
+			return 0;
+		}
+	}
+
+	/* Only the newest segment for a host can have room left, as we start a new one when it fills up. */
+	size_t segment_idx = sq->segment_count;
+	for (size_t i = sq->segment_count; i > 0; i--) {
+		if (sq->segments[i-1]->host == host) {
+			segment_idx = i-1;
+			break;
+		}
+	}
+
+	if (segment_idx == sq->segment_count || param_queue_add(&sq->segments[segment_idx]->queue, param, offset, value) < 0) {
+
+		pycsh_queue_segment_t * segment = pycsh_segmented_queue_new_segment(sq, host);
+		if (segment == NULL) {
+			if (flight != NULL) {
+				pycsh_flight_land(flight, -1);
+			}
+			return -1;
+		}
+		segment_idx = sq->segment_count - 1;
+
+		if (param_queue_add(&segment->queue, param, offset, value) < 0) {
+			/* Leave the empty segment, it will be skipped by pycsh_segmented_queue_run() */
+			if (flight != NULL) {
+				pycsh_flight_land(flight, -1);
+			}
+			return -2;
+		}
+	}
+
+	sq->items[sq->item_count++] = (pycsh_segment_item_t){
+		.param = param,
+		.offset = offset,
+		.host = host,
+		.segment = segment_idx,
+		.flight = flight,
+	};
+
+	return 0;
+}
+
+static void pycsh_queue_segment_perform(pycsh_queue_segment_t * segment, int timeout, int retries, uint32_t hwid, int verbose, uint64_t deadline_ns) {
+
+	if (segment->queue.used == 0 || segment->borrowed) {
+		segment->result = 0;
+		return;
+	}
+
+	segment->result = -1;  // When the deadline expired before the first attempt.
+
+	for (int i = 0; i < (retries > 0 ? retries : 1); i++) {
+		if (deadline_ns) {
+			/* Don't start attempts, or wait for a response, beyond the deadline. */
+			uint64_t now = pycsh_segmented_queue_now_ns();
+			if (now >= deadline_ns) {
+				return;
+			}
+			uint64_t remaining_ms = (deadline_ns - now) / 1000000;
+			if (remaining_ms < (uint64_t)timeout) {
+				timeout = remaining_ms > 0 ? remaining_ms : 1;
+			}
+		}
+		atomic_fetch_add(&sent_packets, 1);
+		atomic_fetch_add(&sent_bytes, segment->queue.used);
+		if (segment->queue.type == PARAM_QUEUE_TYPE_GET) {
+			segment->result = param_pull_queue(&segment->queue, CSP_PRIO_NORM, 0, segment->host, timeout);
+		} else {
+			segment->result = param_push_queue(&segment->queue, verbose, segment->host, timeout, hwid, false);
+			if (segment->result > 0) {
+				segment->result = 0;  // param_push_queue() only uses negative numbers for errors.
+			}
+		}
+		if (segment->result == 0) {
+			return;
+		}
+		atomic_fetch_add(&sent_timeouts, 1);
+	}
+}
+
+/* Record the pulled values of every parameter that got a response.
+	Consecutive items of the same parameter are recorded as a single sample,
+	and mark the cached value as fresh when they cover every index. */
+static void pycsh_segmented_queue_record_received(pycsh_segmented_queue_t * sq) {
+
+	const double now = pycsh_param_history_now();
+
+	size_t start = 0;
+	while (start < sq->item_count) {
+		pycsh_segment_item_t * first = &sq->items[start];
+		size_t end = start + 1;
+		while (end < sq->item_count && sq->items[end].param == first->param && sq->items[end].host == first->host
+				&& sq->items[end].offset == first->offset + (int)(end - start)) {
+			end++;
+		}
+
+		int complete = 1;
+		for (size_t i = start; i < end; i++) {
+			/* Borrowed items are recorded by the caller that pulled them. */
+			if (pycsh_segmented_queue_item_borrowed(sq, i) || pycsh_segmented_queue_item_failed(sq, i)) {
+				complete = 0;
+				break;
+			}
+		}
+
+		if (complete) {
+			pycsh_param_history_record_cached(first->param, first->offset, end - start, now);
+			pycsh_param_shadow_update_cached(first->param, first->host, first->offset, end - start);
+			if (first->offset < 0 || (first->offset == 0 && (int)(end - start) >= first->param->array_size)) {
+				pycsh_param_cache_touch(first->param, now);
+			}
+		}
+		start = end;
+	}
+}
+
+typedef struct {
+	pycsh_segmented_queue_t * sq;
+	/* Units of work claimed by the workers: single segments, or for PARAM_QUEUE_TYPE_SET every segment of a host.
+		Holds the first segment of each unit. */
+	size_t * units;
+	size_t unit_count;
+	atomic_size_t next;
+	int timeout;
+	int retries;
+	uint32_t hwid;
+} pycsh_segmented_queue_run_ctx_t;
+
+static void * pycsh_segmented_queue_worker(void * arg) {
+
+	pycsh_segmented_queue_run_ctx_t * ctx = arg;
+	pycsh_segmented_queue_t * sq = ctx->sq;
+
+	size_t unit;
+	while ((unit = atomic_fetch_add(&ctx->next, 1)) < ctx->unit_count) {
+
+		size_t first = ctx->units[unit];
+		pycsh_queue_segment_perform(sq->segments[first], ctx->timeout, ctx->retries, ctx->hwid, sq->verbose, sq->deadline_ns);
+
+		if (sq->type != PARAM_QUEUE_TYPE_SET) {
+			continue;
+		}
+
+		/* Sets to the same host are pushed in the order they were added, as later ones may depend on earlier ones.
+			So once a segment fails, the rest of the host are not pushed either, and fail with the same result. */
+		int result = sq->segments[first]->result;
+		for (size_t i = first + 1; i < sq->segment_count; i++) {
+			pycsh_queue_segment_t * segment = sq->segments[i];
+			if (segment->host != sq->segments[first]->host) {
+				continue;
+			}
+			if (result != 0) {
+				segment->result = result;
+				continue;
+			}
+			pycsh_queue_segment_perform(segment, ctx->timeout, ctx->retries, ctx->hwid, sq->verbose, sq->deadline_ns);
+			result = segment->result;
+		}
+	}
+
+	return NULL;
+}
+
+int pycsh_segmented_queue_run(pycsh_segmented_queue_t * sq, int timeout, int retries, unsigned int max_in_flight, uint32_t hwid) {
+
+	size_t * units = malloc((sq->segment_count ? sq->segment_count : 1) * sizeof(size_t));
+	if (units == NULL) {
+		for (size_t i = 0; i < sq->segment_count; i++) {
+			sq->segments[i]->result = -1;
+		}
+	}
+
+	pycsh_segmented_queue_run_ctx_t ctx = {
+		.sq = sq,
+		.units = units,
+		.timeout = timeout,
+		.retries = retries,
+		.hwid = hwid,
+	};
+	atomic_init(&ctx.next, 0);
+
+	for (size_t i = 0; units != NULL && i < sq->segment_count; i++) {
+		int first = 1;
+		for (size_t j = 0; sq->type == PARAM_QUEUE_TYPE_SET && j < i; j++) {
+			if (sq->segments[j]->host == sq->segments[i]->host) {
+				first = 0;
+				break;
+			}
+		}
+		if (first) {
+			units[ctx.unit_count++] = i;
+		}
+	}
+
+	if (max_in_flight < 1) {
+		max_in_flight = 1;
+	} else if (max_in_flight > PYCSH_MAX_IN_FLIGHT_LIMIT) {
+		max_in_flight = PYCSH_MAX_IN_FLIGHT_LIMIT;
+	}
+	if (max_in_flight > ctx.unit_count) {
+		max_in_flight = ctx.unit_count;
+	}
+
+	/* The calling thread works as well, so we only need (max_in_flight - 1) helpers. */
+	pthread_t workers[PYCSH_MAX_IN_FLIGHT_LIMIT];
+	unsigned int started = 0;
+	for (; started + 1 < max_in_flight; started++) {
+		if (pthread_create(&workers[started], NULL, pycsh_segmented_queue_worker, &ctx) != 0) {
+			break;  // Fewer requests in flight is slower, but still correct.
+		}
+	}
+
+	pycsh_segmented_queue_worker(&ctx);
+
+	for (unsigned int i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	free(units);
+
+	int failed = 0;
+	for (size_t i = 0; i < sq->segment_count; i++) {
+		if (sq->segments[i]->result != 0) {
+			failed++;
+		}
+	}
+
+	/* Land our own pulls before waiting on others, as they may in turn be waiting on ours. */
+	for (size_t i = 0; i < sq->item_count; i++) {
+		pycsh_segment_item_t * item = &sq->items[i];
+		if (item->flight != NULL && !item->following) {
+			pycsh_flight_land(item->flight, sq->segments[item->segment]->result);
+			item->flight = NULL;
+		}
+	}
+	for (size_t i = 0; i < sq->item_count; i++) {
+		pycsh_segment_item_t * item = &sq->items[i];
+		if (item->flight == NULL) {
+			continue;
+		}
+		if (pycsh_segmented_queue_item_borrowed(sq, i)) {
+			item->result = pycsh_flight_wait(item->flight);
+			if (item->result != 0) {
+				failed++;
+			}
+		} else {
+			pycsh_flight_leave(item->flight);  // Pulled by our own segment anyway.
+		}
+		item->flight = NULL;
+		item->following = 0;
+	}
+
+	if (sq->type == PARAM_QUEUE_TYPE_GET) {
+		pycsh_segmented_queue_record_received(sq);
+	}
+
+	return failed;
+}
@@ -0,0 +1,142 @@
+/*
+ * segmented_queue.h
+ *
+ * Splits parameter requests that don't fit in a single PARAM_SERVER_MTU queue,
+ * into multiple packets, and performs them with a configurable number of requests in flight.
+ *
+ * Contains no Python API, so it may be used without holding the GIL.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <param/param.h>
+#include <param/param_queue.h>
+#include <param/param_server.h>
+
+#include "single_flight.h"
+
+/* Upper limit for pycsh_segmented_queue_run(), keeps us well below csp:conn_max */
+#define PYCSH_MAX_IN_FLIGHT_LIMIT 16
+
+/* Segment of items that are pulled by another caller, see pycsh_segment_item_t.flight */
+#define PYCSH_SEGMENT_BORROWED SIZE_MAX
+
+typedef struct {
+	param_queue_t queue;
+	int host;
+	int result;  // 0 for success, otherwise the error returned by param_pull_queue()/param_push_queue()
+	int borrowed;  // Every item of the segment is pulled by another caller, so it's not performed, see pycsh_segmented_queue_claim()
+	char buffer[PARAM_SERVER_MTU] __attribute__((aligned(16)));
+} pycsh_queue_segment_t;
+
+/* Records which segment each added parameter (and offset) was serialized into,
+	so failures can be reported per parameter. */
+typedef struct {
+	param_t * param;
+	int offset;
+	int host;
+	size_t segment;  // PYCSH_SEGMENT_BORROWED when another caller is already pulling the item.
+	pycsh_flight_t * flight;  // Outstanding single-flight pull we lead, or follow when 'following'.
+	int following;  // Whether another caller leads the pull of the item.
+	int result;  // Result of the borrowed pull.
+} pycsh_segment_item_t;
+
+typedef struct {
+	param_queue_type_e type;
+	int version;
+	/* Whether GET items already being pulled by another caller are borrowed, instead of pulled again.
+		Defaults to true for PARAM_QUEUE_TYPE_GET. Must only be enabled when pycsh_segmented_queue_run() is called promptly after adding,
+		as other callers will be waiting for it. */
+	int single_flight;
+	/* Passed to param_push_queue() for PARAM_QUEUE_TYPE_SET, 0 by default. */
+	int verbose;
+	/* CLOCK_MONOTONIC time after which no attempt is started, and no response is waited for, 0 (default) for none.
+		Bounds pycsh_segmented_queue_run() across every segment and retry. */
+	uint64_t deadline_ns;
+
+	pycsh_queue_segment_t ** segments;
+	size_t segment_count;
+
+	pycsh_segment_item_t * items;
+	size_t item_count;
+	size_t item_capacity;
+} pycsh_segmented_queue_t;
+
+void pycsh_segmented_queue_init(pycsh_segmented_queue_t * sq, param_queue_type_e type, int version);
+
+void pycsh_segmented_queue_free(pycsh_segmented_queue_t * sq);
+
+/**
+ * @brief Add a parameter to the last segment for 'host', starting a new segment when it's full.
+ *
+ * @param value Value to serialize for PARAM_QUEUE_TYPE_SET, NULL otherwise.
+ * @return int 0 on success, -1 when out of memory, -2 when the item doesn't even fit in an empty packet.
+ */
+int pycsh_segmented_queue_add(pycsh_segmented_queue_t * sq, param_t * param, int offset, void * value, int host);
+
+/**
+ * @brief Pull or push (depending on the queue type) every segment.
+ *
+ * At most 'max_in_flight' segments are outstanding at once, each from its own worker thread.
+ * Segments of PARAM_QUEUE_TYPE_SET to the same host are pushed one at a time, in the order they were added,
+ * and the rest of the host is skipped (failing with the same result) once one of them fails.
+ * Blocks until every segment has either succeeded or run out of retries.
+ * Must be called without holding the GIL, as param_t callbacks may need it.
+ *
+ * Borrowed items are waited for after our own segments have been performed.
+ *
+ * @return int Number of failed segments and borrowed items, see pycsh_segmented_queue_item_failed() for which.
+ */
+int pycsh_segmented_queue_run(pycsh_segmented_queue_t * sq, int timeout, int retries, unsigned int max_in_flight, uint32_t hwid);
+
+/**
+ * @brief Claim single-flight pulls for every item of a PARAM_QUEUE_TYPE_GET queue that was filled with single_flight disabled.
+ *
+ * Allows a queue to be kept and performed repeatedly, while still coalescing with identical pulls from other callers.
+ * As the items are already serialized, a segment is only left out when every one of its items is pulled by another caller,
+ * the rest are pulled again and stop following.
+ * Must be called promptly before pycsh_segmented_queue_run(), as other callers will be waiting for it.
+ */
+void pycsh_segmented_queue_claim(pycsh_segmented_queue_t * sq);
+
+/**
+ * @brief Complete every single-flight pull we lead with the specified result, and stop following the rest.
+ *
+ * Used when the queue is abandoned without being run, called by pycsh_segmented_queue_free() as well.
+ */
+void pycsh_segmented_queue_release(pycsh_segmented_queue_t * sq, int result);
+
+/* CLOCK_MONOTONIC time in nanoseconds, as used by pycsh_segmented_queue_t.deadline_ns */
+uint64_t pycsh_segmented_queue_now_ns(void);
+
+/* Number of distinct hosts the items of the queue are sent to. */
+size_t pycsh_segmented_queue_host_count(const pycsh_segmented_queue_t * sq);
+
+/* Packets (including retries) and payload bytes sent by every segmented queue, and attempts without a response. */
+void pycsh_segmented_queue_counters(uint64_t * packets, uint64_t * bytes, uint64_t * timeouts, int reset);
+
+/* Whether the specified item is pulled by another caller, rather than by the queue itself. */
+static inline int pycsh_segmented_queue_item_borrowed(const pycsh_segmented_queue_t * sq, size_t item) {
+	return sq->items[item].segment == PYCSH_SEGMENT_BORROWED || sq->segments[sq->items[item].segment]->borrowed;
+}
+
+/* Whether the segment of the specified item failed during pycsh_segmented_queue_run() */
+static inline int pycsh_segmented_queue_item_failed(const pycsh_segmented_queue_t * sq, size_t item) {
+	if (pycsh_segmented_queue_item_borrowed(sq, item)) {
+		return sq->items[item].result != 0;
+	}
+	return sq->segments[sq->items[item].segment]->result != 0;
+}
+
+/* Whether every item failed during pycsh_segmented_queue_run() */
+static inline int pycsh_segmented_queue_all_failed(const pycsh_segmented_queue_t * sq) {
+	for (size_t i = 0; i < sq->item_count; i++) {
+		if (!pycsh_segmented_queue_item_failed(sq, i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,119 @@
+/*
+ * single_flight.c
+ *
+ * Table of outstanding pull requests keyed by (host, node, id, offset).
+ *
+ */
+
+#include "single_flight.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define FLIGHT_BUCKETS 256
+
+struct pycsh_flight_s {
+	int host;
+	int node;
+	int id;
+	int offset;
+
+	int refs;  // Leader and followers
+	int landed;
+	int result;
+
+	struct pycsh_flight_s * next;  // In the bucket
+};
+
+/* Only flights that have yet to land are in the table. */
+static pycsh_flight_t * flight_buckets[FLIGHT_BUCKETS];
+static pthread_mutex_t flight_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Shared by every flight, landings are rare enough that a broadcast is cheap. */
+static pthread_cond_t flight_landed = PTHREAD_COND_INITIALIZER;
+
+static inline size_t flight_bucket(int host, int node, int id, int offset) {
+	uint64_t h = ((uint64_t)(uint16_t)node << 48) ^ ((uint64_t)(uint16_t)id << 32) ^ ((uint64_t)(uint16_t)host << 16) ^ (uint32_t)offset;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h % FLIGHT_BUCKETS;
+}
+
+/* Must be called with flight_lock held. */
+static void flight_unref(pycsh_flight_t * flight) {
+	if (--flight->refs == 0) {
+		free(flight);
+	}
+}
+
+pycsh_flight_t * pycsh_flight_join(int host, int node, int id, int offset, int * leader) {
+
+	size_t bucket = flight_bucket(host, node, id, offset);
+
+	pthread_mutex_lock(&flight_lock);
+
+	for (pycsh_flight_t * flight = flight_buckets[bucket]; flight != NULL; flight = flight->next) {
+		if (flight->host == host && flight->node == node && flight->id == id && flight->offset == offset) {
+			flight->refs++;
+			pthread_mutex_unlock(&flight_lock);
+			*leader = 0;
+			return flight;
+		}
+	}
+
+	pycsh_flight_t * flight = calloc(1, sizeof(pycsh_flight_t));
+	if (flight != NULL) {
+		*flight = (pycsh_flight_t){
+			.host = host,
+			.node = node,
+			.id = id,
+			.offset = offset,
+			.refs = 1,
+			.next = flight_buckets[bucket],
+		};
+		flight_buckets[bucket] = flight;
+	}
+
+	pthread_mutex_unlock(&flight_lock);
+	*leader = 1;
+	return flight;
+}
+
+void pycsh_flight_land(pycsh_flight_t * flight, int result) {
+
+	pthread_mutex_lock(&flight_lock);
+
+	/* Later pulls of the same key start a new flight. */
+	pycsh_flight_t ** link = &flight_buckets[flight_bucket(flight->host, flight->node, flight->id, flight->offset)];
+	while (*link != flight) {
+		link = &(*link)->next;
+	}
+	*link = flight->next;
+
+	flight->landed = 1;
+	flight->result = result;
+	flight_unref(flight);
+
+	pthread_cond_broadcast(&flight_landed);
+	pthread_mutex_unlock(&flight_lock);
+}
+
+int pycsh_flight_wait(pycsh_flight_t * flight) {
+
+	pthread_mutex_lock(&flight_lock);
+	while (!flight->landed) {
+		pthread_cond_wait(&flight_landed, &flight_lock);
+	}
+	int result = flight->result;
+	flight_unref(flight);
+	pthread_mutex_unlock(&flight_lock);
+
+	return result;
+}
+
+void pycsh_flight_leave(pycsh_flight_t * flight) {
+	pthread_mutex_lock(&flight_lock);
+	flight_unref(flight);
+	pthread_mutex_unlock(&flight_lock);
+}
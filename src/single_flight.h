@@ -0,0 +1,30 @@
+/*
+ * single_flight.h
+ *
+ * Table of outstanding pull requests keyed by (host, node, id, offset),
+ * such that concurrent identical pulls wait on the first one instead of sending duplicates.
+ *
+ * Contains no Python API, waiting must be done without holding the GIL.
+ */
+
+#pragma once
+
+typedef struct pycsh_flight_s pycsh_flight_t;
+
+/**
+ * @brief Join the outstanding request for the key, or start a new one.
+ *
+ * @param leader Set to 1 when the caller must perform the request and pycsh_flight_land() it,
+ * 	otherwise 0, in which case the caller must pycsh_flight_wait() or pycsh_flight_leave() it.
+ * @return pycsh_flight_t* NULL when out of memory, in which case the caller should just perform the request.
+ */
+pycsh_flight_t * pycsh_flight_join(int host, int node, int id, int offset, int * leader);
+
+/* Called by the leader with the result of the request (0 for success), wakes every waiting follower. */
+void pycsh_flight_land(pycsh_flight_t * flight, int result);
+
+/* Called by followers, blocks until the leader lands the request, returning its result. */
+int pycsh_flight_wait(pycsh_flight_t * flight);
+
+/* Called by followers that no longer care about the result. */
+void pycsh_flight_leave(pycsh_flight_t * flight);
@@ -0,0 +1,79 @@
+/*
+ * spsc_ring.c
+ *
+ * Bounded single-producer single-consumer ring of fixed-size elements.
+ *
+ */
+
+#include "spsc_ring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+int pycsh_spsc_init(pycsh_spsc_t * ring, size_t capacity, size_t elem_size) {
+
+	size_t rounded = 1;
+	while (rounded < capacity) {
+		rounded <<= 1;
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	ring->slots = calloc(rounded, elem_size);
+	if (ring->slots == NULL) {
+		return -1;
+	}
+	ring->capacity = rounded;
+	ring->elem_size = elem_size;
+	sem_init(&ring->items, 0, 0);
+
+	return 0;
+}
+
+void pycsh_spsc_free(pycsh_spsc_t * ring) {
+	if (ring->slots == NULL) {
+		return;
+	}
+	sem_destroy(&ring->items);
+	free(ring->slots);
+	ring->slots = NULL;
+}
+
+int pycsh_spsc_push(pycsh_spsc_t * ring, const void * elem) {
+
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	if (head - tail >= ring->capacity) {
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return -1;
+	}
+
+	memcpy(&ring->slots[(head & (ring->capacity - 1)) * ring->elem_size], elem, ring->elem_size);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	atomic_fetch_add_explicit(&ring->pushed, 1, memory_order_relaxed);
+
+	sem_post(&ring->items);
+	return 0;
+}
+
+/* Copies out the oldest element, which the semaphore guarantees is there. */
+static void pycsh_spsc_take(pycsh_spsc_t * ring, void * elem) {
+	(void)atomic_load_explicit(&ring->head, memory_order_acquire);  // Pairs with the release in pycsh_spsc_push()
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	memcpy(elem, &ring->slots[(tail & (ring->capacity - 1)) * ring->elem_size], ring->elem_size);
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void pycsh_spsc_pop(pycsh_spsc_t * ring, void * elem) {
+	while (sem_wait(&ring->items) != 0 && errno == EINTR);
+	pycsh_spsc_take(ring, elem);
+}
+
+int pycsh_spsc_try_pop(pycsh_spsc_t * ring, void * elem) {
+	if (sem_trywait(&ring->items) != 0) {
+		return -1;
+	}
+	pycsh_spsc_take(ring, elem);
+	return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * spsc_ring.h
+ *
+ * Bounded single-producer single-consumer ring of fixed-size elements.
+ *
+ * Pushing never blocks (elements are dropped when the ring is full),
+ * while the consumer may sleep until an element arrives.
+ * Contains no Python API, so it may be used without holding the GIL.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+
+typedef struct {
+	size_t capacity;  // Power of 2
+	size_t elem_size;
+	char * slots;
+	sem_t items;  // Posted once per pushed element, so the consumer can sleep while empty.
+
+	/* Written by one side each, kept on their own cache lines. */
+	_Alignas(64) atomic_size_t head;  // Next slot to write
+	_Alignas(64) atomic_size_t tail;  // Next slot to read
+
+	_Alignas(64) atomic_uint_fast64_t pushed;
+	atomic_uint_fast64_t dropped;
+} pycsh_spsc_t;
+
+/**
+ * @brief Allocate a ring of at least 'capacity' elements of 'elem_size' bytes.
+ *
+ * @return int 0 on success, -1 when out of memory.
+ */
+int pycsh_spsc_init(pycsh_spsc_t * ring, size_t capacity, size_t elem_size);
+
+/* Frees the ring, which must no longer be in use by either side. */
+void pycsh_spsc_free(pycsh_spsc_t * ring);
+
+/* Producer side: copy the element into the ring, returns -1 (counting a drop) when full. */
+int pycsh_spsc_push(pycsh_spsc_t * ring, const void * elem);
+
+/* Consumer side: copy the oldest element out of the ring, sleeping until there is one. */
+void pycsh_spsc_pop(pycsh_spsc_t * ring, void * elem);
+
+/* Consumer side: like pycsh_spsc_pop(), but returns -1 instead of sleeping when empty. */
+int pycsh_spsc_try_pop(pycsh_spsc_t * ring, void * elem);
+
+/* Number of elements waiting, may be stale by the time it returns. */
+static inline size_t pycsh_spsc_depth(pycsh_spsc_t * ring) {
+	return atomic_load_explicit(&ring->head, memory_order_relaxed) - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
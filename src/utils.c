@@ -19,10 +19,18 @@
 #include "parameter/pythonparameter.h"
 #include "parameter/parameterlist.h"
 #include "parameter/pythonarrayparameter.h"
+#include "param_index.h"
+#include "param_history.h"
+#include "param_cache.h"
+#include "param_shadow.h"
+#include "coalescer.h"
+#include "batch.h"
 
 #undef NDEBUG
 #include <assert.h>
 
+PyObject * PyExc_PartialResponseError;
+
 /* __attribute__(()) doesn't like to treat char** and void** interchangeably. */
 void cleanup_str(char ** obj) {
     if (*obj == NULL) {
@@ -38,6 +46,11 @@ void cleanup_free(void ** obj) {
     free(*obj);
     *obj = NULL;
 }
+
+void cleanup_segmented_queue(pycsh_segmented_queue_t * queue) {
+	pycsh_segmented_queue_free(queue);
+}
+
 void cleanup_GIL(PyGILState_STATE * gstate) {
 	//printf("AAA %d\n", PyGILState_Check());
     //if (*gstate == PyGILState_UNLOCKED)
@@ -257,14 +270,34 @@ int pycsh_get_num_required_args(const PyObject *function, bool raise_exc) {
 
 /* Retrieves a param_t from either its name, id or wrapper object.
    May raise TypeError or ValueError, returned value will be NULL in either case. */
+int pycsh_util_node_converter(PyObject * obj, int * node) {
+
+	if (obj == Py_None) {
+		*node = INT_MIN;
+		return 1;
+	}
+
+	long value = PyLong_AsLong(obj);
+	if (value == -1 && PyErr_Occurred()) {
+		return 0;  // Raises TypeError or OverflowError
+	}
+	if (value < 0 || value > UINT16_MAX) {
+		PyErr_Format(PyExc_ValueError, "Invalid node %ld", value);
+		return 0;
+	}
+
+	*node = (int)value;
+	return 1;
+}
+
 param_t * _pycsh_util_find_param_t(PyObject * param_identifier, int node) {
 
 	param_t * param = NULL;
 
 	if (PyUnicode_Check(param_identifier))  // is_string
-		param = param_list_find_name(node, (char*)PyUnicode_AsUTF8(param_identifier));
+		param = pycsh_param_index_find_name(node, PyUnicode_AsUTF8(param_identifier));
 	else if (PyLong_Check(param_identifier))  // is_int
-		param = param_list_find_id(node, (int)PyLong_AsLong(param_identifier));
+		param = pycsh_param_index_find_id(node, (int)PyLong_AsLong(param_identifier));
 	else if (PyObject_TypeCheck(param_identifier, &ParameterType))
 		param = ((ParameterObject *)param_identifier)->param;
 	else {  // Invalid type passed.
@@ -325,6 +358,46 @@ static PyTypeObject * _pycsh_misc_param_t_type(param_t * param) {
 }
 
 
+/* Gets the struct module format character matching the C type of the param_t,
+   for use with the buffer protocol. Returns NULL for unsupported types. */
+const char * pycsh_util_param_type_format(param_type_e type) {
+
+	switch (type) {
+		case PARAM_TYPE_UINT8:
+		case PARAM_TYPE_XINT8:
+			return "B";
+		case PARAM_TYPE_UINT16:
+		case PARAM_TYPE_XINT16:
+			return "H";
+		case PARAM_TYPE_UINT32:
+		case PARAM_TYPE_XINT32:
+			return "I";
+		case PARAM_TYPE_UINT64:
+		case PARAM_TYPE_XINT64:
+			return "Q";
+		case PARAM_TYPE_INT8:
+			return "b";
+		case PARAM_TYPE_INT16:
+			return "h";
+		case PARAM_TYPE_INT32:
+			return "i";
+		case PARAM_TYPE_INT64:
+			return "q";
+		case PARAM_TYPE_FLOAT:
+			return "f";
+		case PARAM_TYPE_DOUBLE:
+			return "d";
+		case PARAM_TYPE_STRING:
+		case PARAM_TYPE_DATA:
+			return "B";  // Exposed as raw bytes
+		default:
+			break;
+	}
+
+	return NULL;
+}
+
+
 /* Public interface for '_pycsh_misc_param_t_type()'
    Does not increment the reference count of the found type before returning. */
 PyObject * pycsh_util_get_type(PyObject * self, PyObject * args) {
@@ -364,10 +437,7 @@ ParameterObject * Parameter_wraps_param(param_t *param) {
 		because the GIL should still be held after returning. */
     assert(param != NULL);
 
-	PyObject *key AUTO_DECREF = PyLong_FromVoidPtr(param);
-    ParameterObject *python_param = (ParameterObject*)PyDict_GetItem((PyObject*)param_callback_dict, key);
-
-	return python_param;
+	return pycsh_ptrmap_get(&param_wrapper_map, param);
 }
 
 static PyTypeObject * get_arrayparameter_subclass(PyTypeObject *type) {
@@ -415,6 +485,56 @@ static PyTypeObject * get_arrayparameter_subclass(PyTypeObject *type) {
 	return NULL;
 }
 
+/* What _pycsh_Parameter_from_param() needs to know about a Parameter (sub)class,
+	which is expensive to determine through __subclasses__() and PyObject_IsSubclass(). */
+typedef struct {
+	PyTypeObject *type;
+	PyTypeObject *array_subclass;  // Strong reference, resolved on first use by an array parameter.
+	int is_pythonparameter;
+} parameter_type_info_t;
+
+/* We only expect a handful of Parameter classes, so a small array beats a hash map. */
+#define PARAMETER_TYPE_CACHE_SIZE 32
+static parameter_type_info_t parameter_type_cache[PARAMETER_TYPE_CACHE_SIZE];
+static size_t parameter_type_cache_count = 0;
+
+void pycsh_parameter_type_cache_clear(void) {
+	for (size_t i = 0; i < parameter_type_cache_count; i++) {
+		Py_XDECREF(parameter_type_cache[i].array_subclass);
+		Py_DECREF(parameter_type_cache[i].type);
+	}
+	parameter_type_cache_count = 0;
+}
+
+/* Returns the cached info of the type, or a temporary one when the cache is full.
+	Returns NULL with an exception set on failure. */
+static parameter_type_info_t * get_parameter_type_info(PyTypeObject *type, parameter_type_info_t *uncached) {
+
+	for (size_t i = 0; i < parameter_type_cache_count; i++) {
+		if (parameter_type_cache[i].type == type) {
+			return &parameter_type_cache[i];
+		}
+	}
+
+	int is_pythonparameter = PyObject_IsSubclass((PyObject*)(type), (PyObject*)&PythonParameterType);
+	if (is_pythonparameter < 0) {
+		return NULL;
+	}
+
+	parameter_type_info_t *info = uncached;
+	if (parameter_type_cache_count < PARAMETER_TYPE_CACHE_SIZE) {
+		info = &parameter_type_cache[parameter_type_cache_count++];
+		Py_INCREF(type);
+	}
+
+	*info = (parameter_type_info_t){
+		.type = type,
+		.array_subclass = NULL,
+		.is_pythonparameter = is_pythonparameter,
+	};
+	return info;
+}
+
 /* Create a Python Parameter object from a param_t pointer directly. */
 PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, const PyObject * callback, int host, int timeout, int retries, int paramver) {
 	if (param == NULL) {
@@ -431,43 +551,62 @@ PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, cons
 		PyErr_SetString(PyExc_TypeError, 
 			"Attempted to create a ParameterArray instance, for a non array parameter.");
 		return NULL;
-	} else if (param->array_size > 1) {  		   // If the parameter is an array.
-		type = get_arrayparameter_subclass(type);  // We create a ParameterArray instance instead.
-		if (type == NULL) {
-			return NULL;
+	}
+
+	parameter_type_info_t uncached_info;
+	parameter_type_info_t *type_info = get_parameter_type_info(type, &uncached_info);
+	if (type_info == NULL) {
+		return NULL;
+	}
+
+	if (param->array_size > 1) {  // If the parameter is an array.
+		if (type_info->array_subclass == NULL) {
+			PyTypeObject *array_subclass = get_arrayparameter_subclass(type);  // We create a ParameterArray instance instead.
+			if (array_subclass == NULL) {
+				return NULL;
+			}
+			if (type_info != &uncached_info) {
+				Py_INCREF(array_subclass);  // Keep it alive for as long as it's cached.
+			}
+			type_info->array_subclass = array_subclass;
 		}
+		type = type_info->array_subclass;
 		// If you listen really carefully here, you can hear OOP idealists, screaming in agony.
 		// On a more serious note, I'm amazed that this even works at all.
+
+		type_info = get_parameter_type_info(type, &uncached_info);
+		if (type_info == NULL) {
+			return NULL;
+		}
+	}
+	int is_pythonparameter = type_info->is_pythonparameter;
+
+	/* Reserve our entry in the callback/lookup map before allocating,
+		so we don't have to deallocate a half-initialized Parameter when the map is out of memory. */
+	assert(pycsh_ptrmap_get(&param_wrapper_map, param) == NULL);
+	if (pycsh_ptrmap_set(&param_wrapper_map, param, NULL) < 0) {
+		return PyErr_NoMemory();
 	}
 
 	ParameterObject *self = (ParameterObject *)type->tp_alloc(type, 0);
 
-	if (self == NULL)
+	if (self == NULL) {
+		pycsh_ptrmap_remove(&param_wrapper_map, param);
 		return NULL;
+	}
 
-	{   /* Add ourselves to the callback/lookup dictionary */
-		PyObject *key AUTO_DECREF = PyLong_FromVoidPtr(param);
-		assert(key != NULL);
-		assert(!PyErr_Occurred());
-		assert(PyDict_GetItem((PyObject*)param_callback_dict, key) == NULL);
-		int set_res = PyDict_SetItem((PyObject*)param_callback_dict, key, (PyObject*)self);
-		assert(set_res == 0);  // Allows the param_t callback to find the corresponding ParameterObject.
-		assert(PyDict_GetItem((PyObject*)param_callback_dict, key) != NULL);
+	{   /* Add ourselves to the callback/lookup map */
 		assert(!PyErr_Occurred());
+		pycsh_ptrmap_set(&param_wrapper_map, param, self);  // Allows the param_t callback to find the corresponding ParameterObject. Can't fail, as the key exists.
 
 		assert(self);
 		assert(self->ob_base.ob_type);
 		/* The parameter linked list should maintain an eternal reference to Parameter() instances, and subclasses thereof (with the exception of PythonParameter() and its subclasses).
 			This check should ensure that: Parameter("name") is Parameter("name") == True.
-			This check doesn't apply to PythonParameter()'s, because its reference is maintained by .keep_alive */
-		int is_pythonparameter = PyObject_IsSubclass((PyObject*)(type), (PyObject*)&PythonParameterType);
-        if (is_pythonparameter < 0) {
-			assert(false);
-			return NULL;
-		}
-
-		if (is_pythonparameter) {
-			Py_DECREF(self);  // param_callback_dict should hold a weak reference to self
+			This check doesn't apply to PythonParameter()'s, because its reference is maintained by .keep_alive
+			param_wrapper_map holds no references itself, so we take the eternal one here, it is released by "list forget". */
+		if (!is_pythonparameter) {
+			Py_INCREF(self);
 		}
 	}
 
@@ -476,6 +615,7 @@ PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, cons
 	self->timeout = timeout;
 	self->retries = retries;
 	self->paramver = paramver;
+	self->max_age = -1;
 
 	self->type = (PyTypeObject *)pycsh_util_get_type((PyObject *)self, NULL);
 
@@ -483,6 +623,22 @@ PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, cons
 }
 
 
+int pycsh_util_param_matches(param_t * param, uint32_t mask, int node, const char * globstr) {
+
+	if ((node >= 0) && (param->node != node)) {
+		return 0;
+	}
+	if ((param->mask & mask) == 0) {
+		return 0;
+	}
+	int strmatch(const char *str, const char *pattern, int n, int m);  // TODO Kevin: Maybe strmatch() should be in the libparam public API?
+	if ((globstr != NULL) && strmatch(param->name, globstr, strlen(param->name), strlen(globstr)) == 0) {
+		return 0;
+	}
+
+	return 1;
+}
+
 /**
  * @brief Return a list of Parameter wrappers similar to the "list" slash command
  * 
@@ -491,32 +647,59 @@ PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, cons
  */
 PyObject * pycsh_util_parameter_list(uint32_t mask, int node, const char * globstr) {
 
-	PyObject * list = PyObject_CallObject((PyObject *)&ParameterListType, NULL);
+	/* Collect the matches first, so the list can be allocated in one go. */
+	size_t count = 0;
+	size_t capacity = 256;
+	void * matches_mem CLEANUP_FREE = malloc(capacity * sizeof(param_t *));
+	if (matches_mem == NULL) {
+		return PyErr_NoMemory();
+	}
 
 	param_t * param;
 	param_list_iterator i = {};
 	while ((param = param_list_iterate(&i)) != NULL) {
 
-		if ((node >= 0) && (param->node != node)) {
-			continue;
-		}
-		if ((param->mask & mask) == 0) {
+		if (!pycsh_util_param_matches(param, mask, node, globstr)) {
 			continue;
 		}
-		int strmatch(const char *str, const char *pattern, int n, int m);  // TODO Kevin: Maybe strmatch() should be in the libparam public API?
-		if ((globstr != NULL) && strmatch(param->name, globstr, strlen(param->name), strlen(globstr)) == 0) {
-			continue;
+
+		if (count >= capacity) {
+			void * grown = realloc(matches_mem, capacity * 2 * sizeof(param_t *));
+			if (grown == NULL) {
+				return PyErr_NoMemory();
+			}
+			matches_mem = grown;
+			capacity *= 2;
 		}
+		((param_t **)matches_mem)[count++] = param;
+	}
+
+	param_t ** matches = matches_mem;
 
+	/* Every item is a Parameter, so we may skip ParameterList_append() and its type-check. */
+	PyObject * items AUTO_DECREF = PyList_New(count);
+	if (items == NULL) {
+		return NULL;
+	}
+
+	for (size_t j = 0; j < count; j++) {
 		/* CSH does not specify a paramver when listing parameters,
 			so we just use 2 as the default version for the created instances. */
-		PyObject * parameter AUTO_DECREF = _pycsh_Parameter_from_param(&ParameterType, param, NULL, INT_MIN, pycsh_dfl_timeout, 1, 2);
+		PyObject * parameter = _pycsh_Parameter_from_param(&ParameterType, matches[j], NULL, INT_MIN, pycsh_dfl_timeout, 1, 2);
 		if (parameter == NULL) {
-			Py_DECREF(list);
 			return NULL;
 		}
-		PyObject * argtuple AUTO_DECREF = PyTuple_Pack(1, parameter);
-		Py_XDECREF(ParameterList_append(list, argtuple));  // TODO Kevin: DECREF on None doesn't seem right here...
+		PyList_SET_ITEM(items, j, parameter);  // Steals the reference
+	}
+
+	PyObject * list = PyObject_CallObject((PyObject *)&ParameterListType, NULL);
+	if (list == NULL) {
+		return NULL;
+	}
+
+	if (PyList_SetSlice(list, 0, 0, items) < 0) {
+		Py_DECREF(list);
+		return NULL;
 	}
 
 	return list;
@@ -549,17 +732,40 @@ PyObject * _pycsh_util_get_single(param_t *param, int offset, int autopull, int
 
 	if (autopull && (param->node != 0)) {
 
-		for (size_t i = 0; i < (retries > 0 ? retries : 1); i++) {
-			int param_pull_res;
-			Py_BEGIN_ALLOW_THREADS;
-			param_pull_res = param_pull_single(param, offset,  CSP_PRIO_NORM, 1, (host != INT_MIN ? host : param->node), timeout, paramver);
-			Py_END_ALLOW_THREADS;
-			if (param_pull_res)
-				if (i >= retries-1) {
-					PyErr_SetString(PyExc_ConnectionError, "No response");
-					return NULL;
-				}
-		}	
+		int dest = (host != INT_MIN ? host : param->node);
+		int param_pull_res = 0;
+
+		Py_BEGIN_ALLOW_THREADS;
+		/* Wait for an identical pull from another thread, rather than sending our own. */
+		int leader = 1;
+		pycsh_flight_t * flight = pycsh_flight_join(dest, param->node, param->id, offset, &leader);
+		if (flight != NULL && !leader) {
+			param_pull_res = pycsh_flight_wait(flight);
+		} else {
+			const int coalesce = pycsh_coalescer_get_window() > 0;
+			for (size_t i = 0; i < (retries > 0 ? retries : 1); i++) {
+				if (coalesce)
+					param_pull_res = pycsh_coalescer_submit(PARAM_QUEUE_TYPE_GET, param, offset, NULL, dest, timeout, paramver);
+				else
+					param_pull_res = param_pull_single(param, offset,  CSP_PRIO_NORM, 1, dest, timeout, paramver);
+				if (param_pull_res == 0)
+					break;
+			}
+			if (flight != NULL)
+				pycsh_flight_land(flight, param_pull_res);
+		}
+		Py_END_ALLOW_THREADS;
+
+		if (param_pull_res) {
+			PyErr_SetString(PyExc_ConnectionError, "No response");
+			return NULL;
+		}
+		const double now = pycsh_param_history_now();
+		pycsh_param_history_record_cached(param, offset, 1, now);
+		pycsh_param_shadow_update_cached(param, dest, offset, 1);
+		if (offset < 0) {
+			pycsh_param_cache_touch(param, now);
+		}
 	}
 
 	if (verbose > -1) {
@@ -672,26 +878,24 @@ PyObject * _pycsh_util_get_single(param_t *param, int offset, int autopull, int
    Increases the reference count of the returned tuple before returning.  */
 PyObject * _pycsh_util_get_array(param_t *param, int autopull, int host, int timeout, int retries, int paramver, int verbose) {
 
+	int dest = (host != INT_MIN ? host : param->node);
+
 	// Pull the value for every index using a queue (if we're allowed to),
 	// instead of pulling them individually.
-	if (autopull && param->node != 0) {
-		void * queuebuffer = malloc(PARAM_SERVER_MTU);
-		param_queue_t queue = { };
-		param_queue_init(&queue, queuebuffer, PARAM_SERVER_MTU, 0, PARAM_QUEUE_TYPE_GET, paramver);
+	// Arrays larger than a single packet are split into segments.
+	if (autopull && dest != 0) {
+		pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+		pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_GET, paramver);
 
 		for (int i = 0; i < param->array_size; i++) {
-			param_queue_add(&queue, param, i, NULL);
-		}
-
-		for (size_t i = 0; i < (retries > 0 ? retries : 1); i++) {
-			if (param_pull_queue(&queue, CSP_PRIO_NORM, 0, param->node, timeout)) {
-				PyErr_SetString(PyExc_ConnectionError, "No response.");
-				free(queuebuffer);
-				return 0;
+			if (pycsh_util_segmented_queue_add(&queue, param, i, NULL, dest) < 0) {
+				return NULL;
 			}
 		}
 
-		free(queuebuffer);
+		if (pycsh_util_segmented_queue_run(&queue, timeout, retries, pycsh_dfl_max_in_flight, 0) < 0) {
+			return NULL;  // Raises ConnectionError
+		}
 	}
 	
 	// We will populate this tuple with the values from the indexes.
@@ -790,6 +994,336 @@ static int _pycsh_typecheck_sequence(PyObject * sequence, PyTypeObject * type) {
 	return PyErr_Occurred() ? -3 : 0;
 }
 
+/**
+ * @brief Converts int and float objects directly into the C value of the specified parameter type.
+ *
+ * This avoids the str() -> param_str_to_value() round trip for the most common value types.
+ *
+ * @param type Parameter type, which determines the C type written to 'valuebuf'.
+ * @param value int or float object to convert.
+ * @param valuebuf Buffer for the converted value, must be large enough for the type.
+ * @return int 0 on success, 1 when the value can't be converted directly (i.e str, or float for int types),
+ *	and -1 with OverflowError set, when the value is outside the range of the parameter type.
+ */
+static int _pycsh_util_pyobject_to_value(param_type_e type, PyObject * value, void * valuebuf) {
+
+	switch (type) {
+		case PARAM_TYPE_UINT8:
+		case PARAM_TYPE_XINT8:
+		case PARAM_TYPE_UINT16:
+		case PARAM_TYPE_XINT16:
+		case PARAM_TYPE_UINT32:
+		case PARAM_TYPE_XINT32:
+		case PARAM_TYPE_UINT64:
+		case PARAM_TYPE_XINT64: {
+			if (!PyLong_Check(value)) {
+				return 1;
+			}
+			unsigned long long val = PyLong_AsUnsignedLongLong(value);
+			if (val == (unsigned long long)-1 && PyErr_Occurred()) {
+				return -1;  // OverflowError, also raised for negative values.
+			}
+			unsigned long long max = UINT64_MAX;
+			switch (type) {
+				case PARAM_TYPE_UINT8:
+				case PARAM_TYPE_XINT8: max = UINT8_MAX; break;
+				case PARAM_TYPE_UINT16:
+				case PARAM_TYPE_XINT16: max = UINT16_MAX; break;
+				case PARAM_TYPE_UINT32:
+				case PARAM_TYPE_XINT32: max = UINT32_MAX; break;
+				default: break;
+			}
+			if (val > max) {
+				PyErr_Format(PyExc_OverflowError, "Value %llu is out of range for parameter type (max %llu)", val, max);
+				return -1;
+			}
+			switch (type) {
+				case PARAM_TYPE_UINT8:
+				case PARAM_TYPE_XINT8: *(uint8_t *)valuebuf = val; break;
+				case PARAM_TYPE_UINT16:
+				case PARAM_TYPE_XINT16: *(uint16_t *)valuebuf = val; break;
+				case PARAM_TYPE_UINT32:
+				case PARAM_TYPE_XINT32: *(uint32_t *)valuebuf = val; break;
+				default: *(uint64_t *)valuebuf = val; break;
+			}
+			return 0;
+		}
+		case PARAM_TYPE_INT8:
+		case PARAM_TYPE_INT16:
+		case PARAM_TYPE_INT32:
+		case PARAM_TYPE_INT64: {
+			if (!PyLong_Check(value)) {
+				return 1;
+			}
+			long long val = PyLong_AsLongLong(value);
+			if (val == -1 && PyErr_Occurred()) {
+				return -1;  // OverflowError
+			}
+			long long min = INT64_MIN, max = INT64_MAX;
+			switch (type) {
+				case PARAM_TYPE_INT8: min = INT8_MIN; max = INT8_MAX; break;
+				case PARAM_TYPE_INT16: min = INT16_MIN; max = INT16_MAX; break;
+				case PARAM_TYPE_INT32: min = INT32_MIN; max = INT32_MAX; break;
+				default: break;
+			}
+			if (val < min || val > max) {
+				PyErr_Format(PyExc_OverflowError, "Value %lld is out of range for parameter type (%lld to %lld)", val, min, max);
+				return -1;
+			}
+			switch (type) {
+				case PARAM_TYPE_INT8: *(int8_t *)valuebuf = val; break;
+				case PARAM_TYPE_INT16: *(int16_t *)valuebuf = val; break;
+				case PARAM_TYPE_INT32: *(int32_t *)valuebuf = val; break;
+				default: *(int64_t *)valuebuf = val; break;
+			}
+			return 0;
+		}
+		case PARAM_TYPE_FLOAT:
+		case PARAM_TYPE_DOUBLE: {
+			if (!PyFloat_Check(value) && !PyLong_Check(value)) {
+				return 1;
+			}
+			double val = PyFloat_AsDouble(value);
+			if (val == -1.0 && PyErr_Occurred()) {
+				return -1;  // OverflowError for very large ints
+			}
+			if (type == PARAM_TYPE_FLOAT) {
+				*(float *)valuebuf = (float)val;
+			} else {
+				*(double *)valuebuf = val;
+			}
+			return 0;
+		}
+		default:
+			break;
+	}
+
+	return 1;  // Strings and data are still parsed by param_str_to_value()
+}
+
+/* Converts a Python object to the C value of the parameter, stored in 'valuebuf'.
+   int and float objects are converted directly, other objects are stringified and parsed like CSH would.
+   Returns 0 on success, or <0 with an exception set. */
+static int _pycsh_util_value_from_pyobject(param_t *param, PyObject *value, void *valuebuf) {
+
+	/* Fast path: int and float objects are converted directly to the C value, with range checking. */
+	int convert_res = _pycsh_util_pyobject_to_value(param->type, value, valuebuf);
+	if (convert_res <= 0) {
+		return convert_res;  // Success or OverflowError
+	}
+
+	/* Stringify the value object, and parse it like CSH would.
+		NOTE: str inputs for XINT types must contain hexadecimal digits only (including 0x) */
+	PyObject * strvalue AUTO_DECREF = _pycsh_get_str_value(value);
+	if (strvalue == NULL) {
+		return -1;
+	}
+	param_str_to_value(param->type, (char*)PyUnicode_AsUTF8(strvalue), valuebuf);
+	return 0;
+}
+
+int pycsh_util_segmented_queue_add(pycsh_segmented_queue_t * queue, param_t * param, int offset, void * value, int host) {
+	switch (pycsh_segmented_queue_add(queue, param, offset, value, host)) {
+		case 0:
+			return 0;
+		case -2:
+			PyErr_Format(PyExc_ValueError, "Parameter '%s' does not fit in a single packet", param->name);
+			return -2;
+		default:
+			PyErr_NoMemory();
+			return -1;
+	}
+}
+
+int pycsh_util_segmented_queue_add_value(pycsh_segmented_queue_t * queue, param_t * param, PyObject * value, int host) {
+
+	int is_array = param->array_size > 1 && param->type != PARAM_TYPE_STRING && param->type != PARAM_TYPE_DATA;
+
+	if (is_array && PySequence_Check(value) && !PyUnicode_Check(value) && !PyBytes_Check(value)) {
+
+		PyObject * sequence AUTO_DECREF = PySequence_Fast(value, "Provided argument must be iterable.");
+		if (sequence == NULL) {
+			return -1;
+		}
+
+		Py_ssize_t seqlen = PySequence_Fast_GET_SIZE(sequence);
+		if (seqlen != param->array_size) {
+			PyErr_Format(PyExc_ValueError, "Provided iterable's length does not match parameter's. <iterable length: %zd> <param length: %i>", seqlen, param->array_size);
+			return -2;
+		}
+
+		if (_pycsh_typecheck_sequence(sequence, _pycsh_misc_param_t_type(param))) {
+			return -3;  // Raises TypeError.
+		}
+
+		/* Convert every index before queuing any of them, so a bad value never leaves the array partially queued. */
+		typedef char valuebuf_t[128] __attribute__((aligned(16)));
+		void * valuebufs_mem CLEANUP_FREE = calloc(seqlen, sizeof(valuebuf_t));
+		valuebuf_t * valuebufs = valuebufs_mem;
+		if (valuebufs == NULL) {
+			PyErr_NoMemory();
+			return -5;
+		}
+
+		for (int i = 0; i < seqlen; i++) {
+			if (_pycsh_util_value_from_pyobject(param, PySequence_Fast_GET_ITEM(sequence, i), valuebufs[i]) < 0) {
+				return -4;  // Raises OverflowError
+			}
+		}
+
+		for (int i = 0; i < seqlen; i++) {
+			if (pycsh_util_segmented_queue_add(queue, param, i, valuebufs[i], host) < 0) {
+				return -5;
+			}
+		}
+		return 0;
+	}
+
+	char valuebuf[128] __attribute__((aligned(16))) = { };
+	if (_pycsh_util_value_from_pyobject(param, value, valuebuf) < 0) {
+		return -4;  // Raises OverflowError
+	}
+
+	/* Like _pycsh_util_set_single(), a single value is assigned to every index of an array. */
+	for (int i = 0; i < (is_array ? param->array_size : 1); i++) {
+		if (pycsh_util_segmented_queue_add(queue, param, is_array ? i : -1, valuebuf, host) < 0) {
+			return -5;
+		}
+	}
+
+	return 0;
+}
+
+int pycsh_util_segmented_queue_run(pycsh_segmented_queue_t * queue, int timeout, int retries, int max_in_flight, uint32_t hwid) {
+
+	int failed;
+	/* Release the GIL while waiting for the network, like for single parameters.
+		Remote param_t's have no Python callbacks, so this is safe. */
+	Py_BEGIN_ALLOW_THREADS;
+	failed = pycsh_segmented_queue_run(queue, timeout, retries, max_in_flight, hwid);
+	Py_END_ALLOW_THREADS;
+
+	return pycsh_util_segmented_queue_raise(queue, failed, timeout, retries);
+}
+
+PyObject * pycsh_util_segmented_queue_run_grouped(pycsh_segmented_queue_t * queue, int timeout, int retries, int max_in_flight, uint32_t hwid) {
+
+	if (queue->item_count > 0) {
+		/* Every host gets a request in flight at once, so the slowest host decides how long we wait. */
+		size_t hosts = pycsh_segmented_queue_host_count(queue);
+		if ((size_t)max_in_flight < hosts) {
+			max_in_flight = hosts;
+		}
+
+		Py_BEGIN_ALLOW_THREADS;
+		pycsh_segmented_queue_run(queue, timeout, retries, max_in_flight, hwid);
+		Py_END_ALLOW_THREADS;
+	}
+
+	return pycsh_util_segmented_queue_results(queue, timeout, retries, NULL, NULL);
+}
+
+PyObject * pycsh_util_segmented_queue_results(pycsh_segmented_queue_t * queue, int timeout, int retries, PyObject * exc_type, const char * exc_msg) {
+
+	PyObject * results = PyDict_New();
+	if (results == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < queue->item_count; i++) {
+		PyObject * host AUTO_DECREF = PyLong_FromLong(queue->items[i].host);
+		if (host == NULL || PyDict_SetDefault(results, host, Py_None) == NULL) {
+			Py_DECREF(results);
+			return NULL;
+		}
+	}
+
+	PyObject * host;
+	PyObject * result;
+	Py_ssize_t pos = 0;
+	while (PyDict_Next(results, &pos, &host, &result)) {
+		PyObject * host_exc AUTO_DECREF = pycsh_util_segmented_queue_exception(queue, PyLong_AsLong(host), timeout, retries);
+		if (host_exc != NULL && host_exc != Py_None && exc_type != NULL) {
+			Py_SETREF(host_exc, PyObject_CallFunction(exc_type, "s", exc_msg));
+		}
+		/* Replacing the value of an existing key is allowed while iterating. */
+		if (host_exc == NULL || PyDict_SetItem(results, host, host_exc) < 0) {
+			Py_DECREF(results);
+			return NULL;
+		}
+	}
+
+	return results;
+}
+
+PyObject * pycsh_util_segmented_queue_exception(pycsh_segmented_queue_t * queue, int host, int timeout, int retries) {
+
+	size_t items = 0;
+	size_t failed = 0;
+	for (size_t i = 0; i < queue->item_count; i++) {
+		if (host != INT_MIN && queue->items[i].host != host) {
+			continue;
+		}
+		items++;
+		failed += pycsh_segmented_queue_item_failed(queue, i);
+	}
+
+	if (failed == 0) {
+		Py_RETURN_NONE;
+	}
+
+	if (failed == items) {
+		if (host == INT_MIN) {
+			return PyObject_CallFunction(PyExc_ConnectionError, "s", "No response.");
+		}
+		return PyObject_CallFunction(PyExc_ConnectionError, "N", PyUnicode_FromFormat("No response from node %d.", host));
+	}
+
+	/* Some packets made it, let the caller know exactly which parameters didn't. */
+	PyObject * failed_params AUTO_DECREF = PyList_New(0);
+	if (failed_params == NULL) {
+		return NULL;
+	}
+
+	param_t * last_param = NULL;
+	for (size_t i = 0; i < queue->item_count; i++) {
+		if ((host != INT_MIN && queue->items[i].host != host) || !pycsh_segmented_queue_item_failed(queue, i)) {
+			continue;
+		}
+
+		param_t * param = queue->items[i].param;
+		if (param == last_param) {
+			continue;  // Array indexes of the same parameter are consecutive.
+		}
+		last_param = param;
+
+		PyObject * failed_param AUTO_DECREF = _pycsh_Parameter_from_param(&ParameterType, param, NULL, queue->items[i].host, timeout, retries, queue->version);
+		if (failed_param == NULL || PyList_Append(failed_params, failed_param) < 0) {
+			return NULL;
+		}
+	}
+
+	return PyObject_CallFunction(PyExc_PartialResponseError, "sO", "No response for some packets.", failed_params);
+}
+
+int pycsh_util_segmented_queue_raise(pycsh_segmented_queue_t * queue, int failed, int timeout, int retries) {
+
+	if (failed == 0) {
+		return 0;
+	}
+
+	PyObject * exc AUTO_DECREF = pycsh_util_segmented_queue_exception(queue, INT_MIN, timeout, retries);
+	if (exc == NULL) {
+		return -1;
+	}
+	if (exc == Py_None) {
+		return 0;
+	}
+
+	PyErr_SetObject((PyObject *)Py_TYPE(exc), exc);
+	return -1;
+}
+
 /* Private interface for setting the value of a normal parameter. 
    Use INT_MIN as no offset. */
 int _pycsh_util_set_single(param_t *param, PyObject *value, int offset, int host, int timeout, int retries, int paramver, int remote, int verbose) {
@@ -806,37 +1340,20 @@ int _pycsh_util_set_single(param_t *param, PyObject *value, int offset, int host
 		offset = -1;
 
 	char valuebuf[128] __attribute__((aligned(16))) = { };
- 	{   // Stringify the value object
-		PyObject * strvalue AUTO_DECREF = _pycsh_get_str_value(value);
-		switch (param->type) {
-			case PARAM_TYPE_XINT8:
-			case PARAM_TYPE_XINT16:
-			case PARAM_TYPE_XINT32:
-			case PARAM_TYPE_XINT64:
-				// If the destination parameter is expecting a hexadecimal value
-				// and the Python object value is of Long type (int), then we need
-				// to do a conversion here. Otherwise if the Python value is a string
-				// type, then we must expect hexadecimal digits only (including 0x)
-				if (Py_IS_TYPE(value, &PyLong_Type)) {
-					// Convert the integer value to hexadecimal digits
-					char tmp[64];
-					snprintf(tmp,64,"0x%lX", PyLong_AsUnsignedLong(value));
-					// Convert the hexadecimal C-string into a Python string object
-					PyObject *py_long_str = PyUnicode_FromString(tmp);
-					// De-reference the original strvalue before assigning a new
-					Py_DECREF(strvalue);
-					strvalue = py_long_str;
-				}
-				break;
-
-			default:
-				break;
-		}
-		param_str_to_value(param->type, (char*)PyUnicode_AsUTF8(strvalue), valuebuf);
+	if (_pycsh_util_value_from_pyobject(param, value, valuebuf) < 0) {
+		return -1;  // Raises OverflowError
 	}
 
 	int dest = (host != INT_MIN ? host : param->node);
 
+	/* Inside pycsh.batch(), remote sets are queued until the batch is exited. */
+	if (remote && dest != 0) {
+		int queued = pycsh_batch_add(param, offset, valuebuf, host);
+		if (queued != 0) {
+			return queued < 0 ? -4 : 0;
+		}
+	}
+
 	// TODO Kevin: The way we set the parameters has been refactored,
 	//	confirm that it still behaves like the original (especially for remote host parameters).
 	if (remote && (dest != 0)) {  // When allowed, set remote parameter immediately.
@@ -844,7 +1361,10 @@ int _pycsh_util_set_single(param_t *param, PyObject *value, int offset, int host
 		for (size_t i = 0; i < (retries > 0 ? retries : 1); i++) {
 			int param_push_res;
 			Py_BEGIN_ALLOW_THREADS;  // Only allow threads for remote parameters, as local ones could have Python callbacks.
-			param_push_res = param_push_single(param, offset, valuebuf, 1, dest, timeout, paramver, false);
+			if (pycsh_coalescer_get_window() > 0)
+				param_push_res = pycsh_coalescer_submit(PARAM_QUEUE_TYPE_SET, param, offset, valuebuf, dest, timeout, paramver);
+			else
+				param_push_res = param_push_single(param, offset, valuebuf, 1, dest, timeout, paramver, false);
 			Py_END_ALLOW_THREADS;
 			if (param_push_res < 0)
 				if (i >= retries-1) {
@@ -871,6 +1391,9 @@ int _pycsh_util_set_single(param_t *param, PyObject *value, int offset, int host
 			// TODO Kevin: We could create a CallbackException class here, to be caught by us and in Python.
 			return -3;
 		}
+
+		/* Every index gets the same value when no offset is specified. */
+		pycsh_param_history_record(param, offset, (offset < 0) ? param->array_size : 1, valuebuf, 0, pycsh_param_history_now());
 	}
 
 	return 0;
@@ -914,47 +1437,99 @@ int _pycsh_util_set_array(param_t *param, PyObject *value, int host, int timeout
 		return -3;  // Raises TypeError.
 	}
 
+	int dest = (host != INT_MIN ? host : param->node);
+
+	/* Local parameters are set immediately, as they may have Python callbacks.
+		The whole array is recorded as a single history sample once every index is set. */
+	if (dest == 0) {
+		if (param->type == PARAM_TYPE_STRING) {
+			Py_DECREF(value);
+			PyErr_SetString(PyExc_NotImplementedError, "Cannot set string parameters by index.");
+			return -4;
+		}
+
+		size_t typesize = param_typesize(param->type);
+		void * values_mem CLEANUP_FREE = malloc(seqlen * typesize);
+		uint8_t * values = values_mem;
+		if (values == NULL) {
+			Py_DECREF(value);
+			PyErr_NoMemory();
+			return -4;
+		}
+
+		int res = 0;
+		int set = 0;
+		for (; set < seqlen; set++) {
+			PyObject *item = PySequence_Fast_GET_ITEM(value, set);  // Borrowed reference
+			char valuebuf[128] __attribute__((aligned(16))) = { };
+			if (_pycsh_util_value_from_pyobject(param, item, valuebuf) < 0) {
+				res = -4;  // Raises OverflowError
+				break;
+			}
+
+			param_set(param, set, valuebuf);
+			if (PyErr_Occurred()) {
+				/* If the exception came from the callback, we should already have chained unto it. */
+				res = -4;
+				break;
+			}
+			memcpy(&values[set * typesize], valuebuf, typesize);
+		}
+
+		/* Indexes that were set before a failure are still recorded. */
+		if (set > 0) {
+			pycsh_param_history_record(param, 0, set, values, typesize, pycsh_param_history_now());
+		}
+
+		Py_DECREF(value);
+		return res;
+	}
+
+	/* Inside pycsh.batch(), every index is queued until the batch is exited. */
+	int queued = pycsh_batch_add_value(param, value, host);
+	if (queued != 0) {
+		Py_DECREF(value);
+		return queued < 0 ? -8 : 0;
+	}
+
 	// TODO Kevin: This does not allow for queued operations on array parameters.
 	//	This could be implemented by simply replacing 'param_queue_t queue = { };',
-	//	with the global queue, but then we need to handle freeing the buffer.
-	// TODO Kevin: Also this queue is not used for local parameters (and therefore wasted).
-	//	Perhaps structure the function to avoid its unecessary instantiation.
-	void * queuebuffer = malloc(PARAM_SERVER_MTU);
-	param_queue_t queue = { };
-	param_queue_init(&queue, queuebuffer, PARAM_SERVER_MTU, 0, PARAM_QUEUE_TYPE_SET, paramver);
+	//	with the global queue.
+	/* Serialize every index up front, the queue is split into as few packets as the MTU allows. */
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_SET, paramver);
 	
 	for (int i = 0; i < seqlen; i++) {
 
-		PyObject *item = PySequence_Fast_GET_ITEM(value, i);
+		PyObject *item = PySequence_Fast_GET_ITEM(value, i);  // Borrowed reference
 
 		if(!item) {
-			Py_DECREF(value);
-			free(queuebuffer);
 			PyErr_SetString(PyExc_RuntimeError, "Iterator went outside the bounds of the iterable.");
 			Py_DECREF(value);
 			return -4;
 		}
 
-#if 0  /* TODO Kevin: When should we use queues with the new cmd system? */
-		// Set local parameters immediately, use the global queue if autosend if off.
-		param_queue_t *usequeue = (!autosend ? &param_queue_set : ((param->node != 0) ? &queue : NULL));
-#endif
-		_pycsh_util_set_single(param, item, i, host, timeout, retries, paramver, 1, verbose);
-		
-		// 'item' is a borrowed reference, so we don't need to decrement it.
-	}
+		char valuebuf[128] __attribute__((aligned(16))) = { };
+		if (_pycsh_util_value_from_pyobject(param, item, valuebuf) < 0) {
+			Py_DECREF(value);
+			return -5;  // Raises OverflowError
+		}
 
-	param_queue_print(&queue);
-	
-	if (param->node != 0)
-		if (param_push_queue(&queue, 1, param->node, 100, 0, false) < 0) {  // TODO Kevin: We should probably have a parameter for hwid here.
-			PyErr_SetString(PyExc_ConnectionError, "No response.");
-			free(queuebuffer);
+		if (pycsh_util_segmented_queue_add(&queue, param, i, valuebuf, dest) < 0) {
 			Py_DECREF(value);
-			return -6;
+			return -7;
 		}
-	
-	free(queuebuffer);
+	}
+
+	if (pycsh_util_segmented_queue_run(&queue, timeout, retries, pycsh_dfl_max_in_flight, 0) < 0) {
+		Py_DECREF(value);
+		return -6;  // Raises ConnectionError
+	}
+
+	if (verbose > -1) {
+		param_print(param, -1, NULL, 0, 2, 0);
+	}
+
 	Py_DECREF(value);
 	return 0;
 }
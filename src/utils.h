@@ -15,19 +15,23 @@
 #include <param/param.h>
 #include <param/param_queue.h>
 #include "parameter/pythonparameter.h"
+#include "segmented_queue.h"
+#include "cleanup.h"
 
-void cleanup_str(char ** obj);
-void cleanup_free(void ** obj);
 void cleanup_GIL(PyGILState_STATE * gstate);
 void cleanup_pyobject(PyObject **obj);
 
 void state_release_GIL(PyThreadState ** state);
 
-#define CLEANUP_STR __attribute__((cleanup(cleanup_str)))
-#define CLEANUP_FREE __attribute__((cleanup(cleanup_free)))
 #define CLEANUP_GIL __attribute__((cleanup(cleanup_GIL)))
 #define AUTO_DECREF __attribute__((cleanup(cleanup_pyobject)))
 
+void cleanup_segmented_queue(pycsh_segmented_queue_t * queue);
+#define CLEANUP_SEGMENTED_QUEUE __attribute__((cleanup(cleanup_segmented_queue)))
+
+/* Raised when only some segments of a pycsh_segmented_queue_t got a response. */
+extern PyObject * PyExc_PartialResponseError;
+
 __attribute__((malloc(free, 1)))
 char *safe_strdup(const char *s);
 
@@ -64,20 +68,34 @@ int pycsh_get_num_accepted_pos_args(const PyObject *function, bool raise_exc);
 
 int pycsh_get_num_required_args(const PyObject *function, bool raise_exc);
 
+/* PyArg_Parse*() "O&" converter for node arguments, where None is INT_MIN (i.e the node of each parameter). */
+int pycsh_util_node_converter(PyObject * obj, int * node);
+
 /* Retrieves a param_t from either its name, id or wrapper object.
    May raise TypeError or ValueError, returned value will be NULL in either case. */
 param_t * _pycsh_util_find_param_t(PyObject * param_identifier, int node);
 
 
+/* Gets the struct module format character matching the C type of the param_t,
+   for use with the buffer protocol. Returns NULL for unsupported types. */
+const char * pycsh_util_param_type_format(param_type_e type);
+
+
 /* Public interface for '_pycsh_misc_param_t_type()'
    Increments the reference count of the found type before returning. */
 PyObject * pycsh_util_get_type(PyObject * self, PyObject * args);
 
 
+/* Clears the per-type cache used by _pycsh_Parameter_from_param(), must be called when Parameter is subclassed. */
+void pycsh_parameter_type_cache_clear(void);
+
 /* Create a Python Parameter object from a param_t pointer directly. */
 PyObject * _pycsh_Parameter_from_param(PyTypeObject *type, param_t * param, const PyObject * callback, int host, int timeout, int retries, int paramver);
 
 
+/* Whether the param_t matches the filters of pycsh_util_parameter_list() */
+int pycsh_util_param_matches(param_t * param, uint32_t mask, int node, const char * globstr);
+
 /**
  * @brief Return a list of Parameter wrappers similar to the "list" slash command
  * 
@@ -103,6 +121,53 @@ int _pycsh_util_set_single(param_t *param, PyObject *value, int offset, int host
 /* Private interface for setting the value of an array parameter. */
 int _pycsh_util_set_array(param_t *param, PyObject *value, int host, int timeout, int retries, int paramver, int verbose);
 
+/* pycsh_segmented_queue_add() which raises ValueError or MemoryError on failure. */
+int pycsh_util_segmented_queue_add(pycsh_segmented_queue_t * queue, param_t * param, int offset, void * value, int host);
+
+/* Converts the Python value (or sequence of values for arrays) and adds it to a PARAM_QUEUE_TYPE_SET queue.
+   Raises TypeError, ValueError, OverflowError or MemoryError on failure. */
+int pycsh_util_segmented_queue_add_value(pycsh_segmented_queue_t * queue, param_t * param, PyObject * value, int host);
+
+/**
+ * @brief Performs every segment of the queue with the GIL released.
+ * 
+ * Raises ConnectionError when no segments got a response,
+ * or PartialResponseError (listing the affected Parameters) when only some did.
+ * 
+ * @return int 0 on success, <0 with an exception set otherwise.
+ */
+int pycsh_util_segmented_queue_run(pycsh_segmented_queue_t * queue, int timeout, int retries, int max_in_flight, uint32_t hwid);
+
+/**
+ * @brief Performs every segment of the queue with the GIL released, without raising for missing responses.
+ *
+ * Raises the number of requests in flight to the number of hosts (up to PYCSH_MAX_IN_FLIGHT_LIMIT),
+ * so the hosts are waited for concurrently.
+ *
+ * @return PyObject* New reference to a dict of {host: None | ConnectionError | PartialResponseError}, or NULL with an exception set.
+ */
+PyObject * pycsh_util_segmented_queue_run_grouped(pycsh_segmented_queue_t * queue, int timeout, int retries, int max_in_flight, uint32_t hwid);
+
+/**
+ * @brief Creates the results of pycsh_util_segmented_queue_run_grouped(), for a queue that has already been performed.
+ *
+ * @param exc_type Exception (with 'exc_msg') to use instead for hosts with failed items, i.e when a deadline expired, or NULL.
+ * @return PyObject* New reference to a dict of {host: None | exception}, or NULL with an exception set.
+ */
+PyObject * pycsh_util_segmented_queue_results(pycsh_segmented_queue_t * queue, int timeout, int retries, PyObject * exc_type, const char * exc_msg);
+
+/**
+ * @brief Creates the exception described by pycsh_util_segmented_queue_run(), for a queue that has already been performed.
+ *
+ * @param host Only consider the items sent to this host, INT_MIN for every item.
+ * @return PyObject* New reference to the exception, Py_None when none of the items failed, or NULL with an exception set.
+ */
+PyObject * pycsh_util_segmented_queue_exception(pycsh_segmented_queue_t * queue, int host, int timeout, int retries);
+
+/* Raises the exception described by pycsh_util_segmented_queue_run(),
+   for a queue that has already been performed with 'failed' failed segments. */
+int pycsh_util_segmented_queue_raise(pycsh_segmented_queue_t * queue, int failed, int timeout, int retries);
+
 /**
  * @brief Check if this param_t is wrapped by a ParameterObject.
  * 
@@ -12,6 +12,11 @@
 
 #include "../pycsh.h"
 #include "../csh/known_hosts.h"
+#include "../segmented_queue.h"
+#include "../param_history.h"
+#include "../coalescer.h"
+#include "../async_request.h"
+#include "../param_cache.h"
 
 
 // TODO Kevin: These differ from the newest version of slash/csh
@@ -78,3 +83,110 @@ PyObject * pycsh_slash_verbose(PyObject * self, PyObject * args) {
 
 	return Py_BuildValue("i", pycsh_dfl_verbose);
 }
+
+PyObject * pycsh_max_in_flight(PyObject * self, PyObject * args) {
+
+	int max_in_flight = INT_MIN;
+
+	if (!PyArg_ParseTuple(args, "|i", &max_in_flight)) {
+		return NULL;  // TypeError is thrown
+	}
+
+	if (max_in_flight == INT_MIN)
+		printf("Default max in flight = %d\n", pycsh_dfl_max_in_flight);
+	else {
+		if (max_in_flight < 1 || max_in_flight > PYCSH_MAX_IN_FLIGHT_LIMIT) {
+			PyErr_Format(PyExc_ValueError, "max_in_flight must be between 1 and %d", PYCSH_MAX_IN_FLIGHT_LIMIT);
+			return NULL;
+		}
+		pycsh_dfl_max_in_flight = max_in_flight;
+		printf("Set default max in flight to %d\n", pycsh_dfl_max_in_flight);
+	}
+
+	return Py_BuildValue("i", pycsh_dfl_max_in_flight);
+}
+
+PyObject * pycsh_async_workers(PyObject * self, PyObject * args) {
+
+	int workers = INT_MIN;
+
+	if (!PyArg_ParseTuple(args, "|i", &workers)) {
+		return NULL;  // TypeError is thrown
+	}
+
+	if (workers == INT_MIN)
+		printf("Async workers = %u\n", pycsh_async_get_workers());
+	else {
+		if (workers < 1 || workers > PYCSH_ASYNC_WORKERS_LIMIT) {
+			PyErr_Format(PyExc_ValueError, "async workers must be between 1 and %d", PYCSH_ASYNC_WORKERS_LIMIT);
+			return NULL;
+		}
+		pycsh_async_set_workers(workers);
+		printf("Set async workers to %u\n", pycsh_async_get_workers());
+	}
+
+	return Py_BuildValue("I", pycsh_async_get_workers());
+}
+
+PyObject * pycsh_history_limit(PyObject * self, PyObject * args) {
+
+	Py_ssize_t limit = -1;
+
+	if (!PyArg_ParseTuple(args, "|n", &limit)) {
+		return NULL;  // TypeError is thrown
+	}
+
+	if (limit < -1) {
+		PyErr_SetString(PyExc_ValueError, "history limit must not be negative");
+		return NULL;
+	}
+
+	if (limit == -1)
+		printf("History limit = %zu bytes (%zu used)\n", pycsh_param_history_get_limit(), pycsh_param_history_used());
+	else {
+		pycsh_param_history_set_limit(limit);
+		printf("Set history limit to %zu bytes\n", pycsh_param_history_get_limit());
+	}
+
+	return PyLong_FromSize_t(pycsh_param_history_get_limit());
+}
+
+PyObject * pycsh_sniffer_cache(PyObject * self, PyObject * args) {
+
+	int enable = -1;
+
+	if (!PyArg_ParseTuple(args, "|p", &enable)) {
+		return NULL;  // TypeError is thrown
+	}
+
+	if (enable == -1)
+		printf("Sniffer cache updates = %s\n", pycsh_param_cache_get_sniffed() ? "enabled" : "disabled");
+	else {
+		pycsh_param_cache_set_sniffed(enable);
+		printf("%s sniffer cache updates\n", enable ? "Enabled" : "Disabled");
+	}
+
+	return PyBool_FromLong(pycsh_param_cache_get_sniffed());
+}
+
+PyObject * pycsh_coalesce(PyObject * self, PyObject * args) {
+
+	double window_ms = -1;
+
+	if (!PyArg_ParseTuple(args, "|d", &window_ms)) {
+		return NULL;  // TypeError is thrown
+	}
+
+	if (window_ms == -1)
+		printf("Coalescing window = %.3f ms\n", pycsh_coalescer_get_window() / 1000.0);
+	else {
+		if (window_ms < 0 || window_ms > 1000) {
+			PyErr_SetString(PyExc_ValueError, "Coalescing window must be between 0 and 1000 ms");
+			return NULL;
+		}
+		pycsh_coalescer_set_window(window_ms * 1000);
+		printf("Set coalescing window to %.3f ms\n", pycsh_coalescer_get_window() / 1000.0);
+	}
+
+	return PyFloat_FromDouble(pycsh_coalescer_get_window() / 1000.0);
+}
@@ -15,3 +15,13 @@ PyObject * pycsh_slash_node(PyObject * self, PyObject * args);
 PyObject * pycsh_slash_timeout(PyObject * self, PyObject * args);
 
 PyObject * pycsh_slash_verbose(PyObject * self, PyObject * args);
+
+PyObject * pycsh_max_in_flight(PyObject * self, PyObject * args);
+
+PyObject * pycsh_async_workers(PyObject * self, PyObject * args);
+
+PyObject * pycsh_history_limit(PyObject * self, PyObject * args);
+
+PyObject * pycsh_coalesce(PyObject * self, PyObject * args);
+
+PyObject * pycsh_sniffer_cache(PyObject * self, PyObject * args);
@@ -14,19 +14,25 @@
 #include "../utils.h"
 #include "../parameter/parameter.h"
 #include "../parameter/pythonparameter.h"
+#include "../param_index.h"
+#include "../param_history.h"
+#include "../param_cache.h"
+#include "../param_shadow.h"
+#include "../parameter/parameterlistview.h"
 
 #include "param_list_py.h"
 
 PyObject * pycsh_param_list(PyObject * self, PyObject * args, PyObject * kwds) {
 
     int node = pycsh_dfl_node;
-    int verbosity = 1;
+    int verbosity = -1;  // Printing large lists is slow, so only do it when asked to.
     PyObject * mask_obj = NULL;
     char * globstr = NULL;
+    int lazy = 0;
 
-    static char *kwlist[] = {"node", "verbose", "mask", "globstr", NULL};
+    static char *kwlist[] = {"node", "verbose", "mask", "globstr", "lazy", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iiOs", kwlist, &node, &verbosity, &mask_obj, &globstr)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iiOsp", kwlist, &node, &verbosity, &mask_obj, &globstr, &lazy)) {
         return NULL;
     }
 
@@ -38,7 +44,13 @@ PyObject * pycsh_param_list(PyObject * self, PyObject * args, PyObject * kwds) {
         }
     }
 
-    param_list_print(mask, node, globstr, verbosity);
+    if (verbosity >= 0) {
+        param_list_print(mask, node, globstr, verbosity);
+    }
+
+    if (lazy) {
+        return ParameterListView_from_filter(mask, node, globstr);
+    }
 
     return pycsh_util_parameter_list(mask, node, globstr);
 }
@@ -61,6 +73,9 @@ PyObject * pycsh_param_list_download(PyObject * self, PyObject * args, PyObject
         int list_download_res;
         Py_BEGIN_ALLOW_THREADS;
         list_download_res = param_list_download(node, timeout, version, include_remotes);
+        /* Existing parameters are updated in place, which may change their name, so rebuild the index rather than patching it.
+            Lookups meanwhile still find the new parameters, as misses fall back to the list. */
+        pycsh_param_index_invalidate();
         Py_END_ALLOW_THREADS;
         // TODO Kevin: Downloading parameters with an incorrect version, can lead to a segmentation fault.
         //	Had it been easier to detect when an incorrect version is used, we would've raised an exception instead.
@@ -133,9 +148,11 @@ PyObject * pycsh_param_list_add(PyObject * self, PyObject * args, PyObject * kwd
     if (param_list_add(param) != 0) {
         param_list_destroy(param);
         Py_DECREF(param_instance);
+        pycsh_param_index_invalidate();  // An existing parameter may have been updated instead.
         PyErr_SetString(PyExc_ValueError, "Failed to add parameter to list");
         return NULL;
     }   
+    pycsh_param_index_add(param);
 
     return param_instance;
 }
@@ -165,6 +182,7 @@ static int param_list_remove_py(int node, uint8_t verbose) {
 
 		if (match) {
             ParameterObject *python_parameter = Parameter_wraps_param(param);
+            pycsh_param_index_remove(param);
             /* TODO Kevin: Perhaps we need a better way to distinguish between param_t that are wrapped by Parameter()s,
                 and those that are not. Currently we do this by reimplementing param_list_remove() here.
                 We need to do this, because we must not free() param_t's referenced by Parameter()s,
@@ -175,6 +193,9 @@ static int param_list_remove_py(int node, uint8_t verbose) {
                 param_list_remove_specific(param, verbose, 0);
                 Py_DECREF(python_parameter);  // The parameter list no longer holds a reference to the Parameter
             } else {
+                pycsh_param_history_remove(param);
+                pycsh_param_cache_remove(param);
+                pycsh_param_shadow_remove(param);
                 param_list_remove_specific(param, verbose, 1);
             }
 			count++;
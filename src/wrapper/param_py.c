@@ -17,6 +17,9 @@
 
 #include "../pycsh.h"
 #include "../utils.h"
+#include "../async_request.h"
+#include "../param_cache.h"
+#include "../parameter/parameter.h"
 
 #include "param_py.h"
 
@@ -42,10 +45,11 @@ PyObject * pycsh_param_get(PyObject * self, PyObject * args, PyObject * kwds) {
 	int timeout = pycsh_dfl_timeout;
 	int retries = 1;
 	int verbose = pycsh_dfl_verbose;
+	PyObject * max_age_obj = Py_None;
 
-	static char *kwlist[] = {"param_identifier", "node", "server", "paramver", "offset", "timeout", "retries", "verbose", NULL};
+	static char *kwlist[] = {"param_identifier", "node", "server", "paramver", "offset", "timeout", "retries", "verbose", "max_age", NULL};
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iiiiiii", kwlist, &param_identifier, &node, &server, &paramver, &offset, &timeout, &retries, &verbose))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iiiiiiiO", kwlist, &param_identifier, &node, &server, &paramver, &offset, &timeout, &retries, &verbose, &max_age_obj))
 		return NULL;  // TypeError is thrown
 
 	param_t *param = _pycsh_util_find_param_t(param_identifier, node);
@@ -53,15 +57,28 @@ PyObject * pycsh_param_get(PyObject * self, PyObject * args, PyObject * kwds) {
 	if (param == NULL)  // Did not find a match.
 		return NULL;  // Raises TypeError or ValueError.
 
+	/* Parameter objects provide the default max age. */
+	double max_age = -1;
+	if (max_age_obj != Py_None) {
+		max_age = PyFloat_AsDouble(max_age_obj);
+		if (PyErr_Occurred())
+			return NULL;
+	} else if (PyObject_TypeCheck(param_identifier, &ParameterType)) {
+		max_age = ((ParameterObject *)param_identifier)->max_age;
+	}
+
 	/* Select destination, host overrides parameter node */
 	int dest = node;
 	if (server > 0)
 		dest = server;
 
+	/* Only a whole parameter is marked as received, so only those are served from the cache. */
+	int autopull = !(max_age >= 0 && offset == INT_MIN && pycsh_param_cache_fresh(param, max_age));
+
 	// _pycsh_util_get_single() and _pycsh_util_get_array() will return NULL for exceptions, which is fine with us.
 	if (param->array_size > 1 && param->type != PARAM_TYPE_STRING)
-		return _pycsh_util_get_array(param, 1, dest, timeout, retries, paramver, verbose);
-	return _pycsh_util_get_single(param, offset, 1, dest, timeout, retries, paramver, verbose);
+		return _pycsh_util_get_array(param, autopull, dest, timeout, retries, paramver, verbose);
+	return _pycsh_util_get_single(param, offset, autopull, dest, timeout, retries, paramver, verbose);
 }
 
 PyObject * pycsh_param_set(PyObject * self, PyObject * args, PyObject * kwds) {
@@ -108,6 +125,327 @@ PyObject * pycsh_param_set(PyObject * self, PyObject * args, PyObject * kwds) {
 	Py_RETURN_NONE;
 }
 
+PyObject * pycsh_param_aget(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	CSP_INIT_CHECK()
+
+	PyObject * param_identifier;
+	int node = pycsh_dfl_node;
+	int server = INT_MIN;
+	int paramver = 2;
+	int timeout = pycsh_dfl_timeout;
+	int retries = 1;
+	double deadline = 0;
+
+	static char *kwlist[] = {"param_identifier", "node", "server", "paramver", "timeout", "retries", "deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iiiiiO&", kwlist, &param_identifier, &node, &server, &paramver, &timeout, &retries, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	param_t *param = _pycsh_util_find_param_t(param_identifier, node);
+
+	if (param == NULL)  // Did not find a match.
+		return NULL;  // Raises TypeError or ValueError.
+
+	return pycsh_async_get(param, (server > 0) ? server : INT_MIN, timeout, retries, paramver, deadline);
+}
+
+PyObject * pycsh_param_aset(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	CSP_INIT_CHECK()
+
+	PyObject * param_identifier;
+	PyObject * value;
+	int node = pycsh_dfl_node;
+	int server = INT_MIN;
+	int paramver = 2;
+	int timeout = pycsh_dfl_timeout;
+	int retries = 1;
+	double deadline = 0;
+
+	static char *kwlist[] = {"param_identifier", "value", "node", "server", "paramver", "timeout", "retries", "deadline", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|iiiiiO&", kwlist, &param_identifier, &value, &node, &server, &paramver, &timeout, &retries, pycsh_async_deadline_converter, &deadline))
+		return NULL;  // TypeError is thrown
+
+	param_t *param = _pycsh_util_find_param_t(param_identifier, node);
+
+	if (param == NULL)  // Did not find a match.
+		return NULL;  // Raises TypeError or ValueError.
+
+	return pycsh_async_set(param, value, (server > 0) ? server : INT_MIN, timeout, retries, paramver, deadline);
+}
+
+PyObject * pycsh_param_cache_stats(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	int reset = 0;
+
+	static char *kwlist[] = {"reset", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p", kwlist, &reset))
+		return NULL;  // TypeError is thrown
+
+	uint64_t hits, misses;
+	pycsh_param_cache_counters(&hits, &misses, reset);
+
+	return Py_BuildValue("{sKsK}", "hits", (unsigned long long)hits, "misses", (unsigned long long)misses);
+}
+
+PyObject * pycsh_param_queue_stats(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	int reset = 0;
+
+	static char *kwlist[] = {"reset", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p", kwlist, &reset))
+		return NULL;  // TypeError is thrown
+
+	uint64_t packets, bytes, timeouts;
+	pycsh_segmented_queue_counters(&packets, &bytes, &timeouts, reset);
+
+	return Py_BuildValue("{sKsKsK}", "packets", (unsigned long long)packets, "bytes", (unsigned long long)bytes, "timeouts", (unsigned long long)timeouts);
+}
+
+/* Returns the currently raised exception instance (clearing it), for per-parameter error reporting. */
+static PyObject * _pycsh_param_fetch_exception(void) {
+
+	PyObject *type, *value, *traceback;
+	PyErr_Fetch(&type, &value, &traceback);
+	PyErr_NormalizeException(&type, &value, &traceback);
+
+	if (traceback != NULL) {
+		PyException_SetTraceback(value, traceback);
+	}
+
+	Py_XDECREF(type);
+	Py_XDECREF(traceback);
+	return value;
+}
+
+/* Whether any of the items queued for a single parameter failed, [start; end) */
+static int _pycsh_param_items_failed(pycsh_segmented_queue_t * queue, size_t start, size_t end) {
+	for (size_t i = start; i < end; i++) {
+		if (pycsh_segmented_queue_item_failed(queue, i)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Node to look names and ids up in for get_many()/set_many(), where INT_MIN (None) uses the default node. */
+static int _pycsh_param_lookup_node(int node) {
+	return node != INT_MIN ? node : (int)pycsh_dfl_node;
+}
+
+/* Destination of a remote parameter for get_many()/set_many(): server overrides node, which overrides the node of the parameter. */
+static int _pycsh_param_dest(param_t * param, int node, int server) {
+	if (server > 0) {
+		return server;
+	}
+	return node != INT_MIN ? node : param->node;
+}
+
+/* Performs the queue with the GIL released, with at least a request in flight per destination node. */
+static void _pycsh_param_run_concurrently(pycsh_segmented_queue_t * queue, int timeout, int retries, unsigned int max_in_flight) {
+
+	size_t hosts = pycsh_segmented_queue_host_count(queue);
+	if (max_in_flight < hosts) {
+		max_in_flight = hosts;
+	}
+
+	Py_BEGIN_ALLOW_THREADS;
+	pycsh_segmented_queue_run(queue, timeout, retries, max_in_flight, 0);
+	Py_END_ALLOW_THREADS;
+}
+
+PyObject * pycsh_param_get_many(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	CSP_INIT_CHECK()
+
+	PyObject * identifiers;
+	int node = INT_MIN;
+	int server = INT_MIN;
+	int paramver = 2;
+	int timeout = pycsh_dfl_timeout;
+	int retries = 1;
+	int verbose = pycsh_dfl_verbose;
+	unsigned int max_in_flight = pycsh_dfl_max_in_flight;
+
+	static char *kwlist[] = {"identifiers", "node", "server", "paramver", "timeout", "retries", "verbose", "max_in_flight", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&iiiiiI", kwlist, &identifiers, pycsh_util_node_converter, &node, &server, &paramver, &timeout, &retries, &verbose, &max_in_flight))
+		return NULL;  // TypeError is thrown
+
+	PyObject * sequence AUTO_DECREF = PySequence_Fast(identifiers, "identifiers must be iterable.");
+	if (sequence == NULL) {
+		return NULL;
+	}
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+
+	/* Holds the parameter for each identifier, or the exception instance for those we couldn't find/queue. */
+	PyObject * results AUTO_DECREF = PyTuple_New(count);
+	void * params_buf CLEANUP_FREE = calloc(count ? count : 1, sizeof(param_t *));
+	void * item_start_buf CLEANUP_FREE = calloc(count + 1, sizeof(size_t));
+	param_t ** params = params_buf;
+	size_t * item_start = item_start_buf;  // Index of the first queued item for each parameter
+	if (results == NULL || params == NULL || item_start == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	/* One queue for every parameter, segmented per destination node, so nodes are pulled concurrently. */
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_GET, paramver);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+
+		item_start[i] = queue.item_count;
+
+		param_t * param = _pycsh_util_find_param_t(PySequence_Fast_GET_ITEM(sequence, i), _pycsh_param_lookup_node(node));
+		if (param == NULL) {
+			PyTuple_SET_ITEM(results, i, _pycsh_param_fetch_exception());
+			continue;
+		}
+		params[i] = param;
+
+		if (param->node == 0) {
+			continue;  // Local parameters are read directly.
+		}
+
+		if (pycsh_util_segmented_queue_add(&queue, param, -1, NULL, _pycsh_param_dest(param, node, server)) < 0) {
+			if (PyErr_ExceptionMatches(PyExc_MemoryError)) {
+				return NULL;
+			}
+			PyTuple_SET_ITEM(results, i, _pycsh_param_fetch_exception());
+			params[i] = NULL;
+		}
+	}
+	item_start[count] = queue.item_count;
+
+	_pycsh_param_run_concurrently(&queue, timeout, retries, max_in_flight);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+
+		param_t * param = params[i];
+		if (param == NULL) {
+			continue;  // Already holds an exception.
+		}
+
+		PyObject * value;
+		if (_pycsh_param_items_failed(&queue, item_start[i], item_start[i+1])) {
+			value = PyObject_CallFunction(PyExc_ConnectionError, "s", "No response.");
+		} else if (param->array_size > 1 && param->type != PARAM_TYPE_STRING && param->type != PARAM_TYPE_DATA) {
+			value = _pycsh_util_get_array(param, 0, INT_MIN, timeout, retries, paramver, verbose);
+		} else {
+			value = _pycsh_util_get_single(param, INT_MIN, 0, INT_MIN, timeout, retries, paramver, verbose);
+		}
+
+		if (value == NULL) {
+			value = _pycsh_param_fetch_exception();  // Probably from the getter of a PythonParameter
+		}
+		PyTuple_SET_ITEM(results, i, value);
+	}
+
+	return Py_NewRef(results);
+}
+
+PyObject * pycsh_param_set_many(PyObject * self, PyObject * args, PyObject * kwds) {
+
+	CSP_INIT_CHECK()
+
+	PyObject * mapping;
+	int node = INT_MIN;
+	int server = INT_MIN;
+	int paramver = 2;
+	int timeout = pycsh_dfl_timeout;
+	int retries = 1;
+	int verbose = -1;
+	unsigned int max_in_flight = pycsh_dfl_max_in_flight;
+
+	static char *kwlist[] = {"mapping", "node", "server", "paramver", "timeout", "retries", "verbose", "max_in_flight", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&iiiiiI", kwlist, &mapping, pycsh_util_node_converter, &node, &server, &paramver, &timeout, &retries, &verbose, &max_in_flight))
+		return NULL;  // TypeError is thrown
+
+	PyObject * items AUTO_DECREF = PyMapping_Items(mapping);
+	if (items == NULL) {
+		return NULL;
+	}
+	Py_ssize_t count = PyList_GET_SIZE(items);
+
+	PyObject * results AUTO_DECREF = PyDict_New();
+	void * params_buf CLEANUP_FREE = calloc(count ? count : 1, sizeof(param_t *));
+	void * item_start_buf CLEANUP_FREE = calloc(count + 1, sizeof(size_t));
+	param_t ** params = params_buf;
+	size_t * item_start = item_start_buf;  // Index of the first queued item for each parameter
+	if (results == NULL || params == NULL || item_start == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	pycsh_segmented_queue_t queue CLEANUP_SEGMENTED_QUEUE;
+	pycsh_segmented_queue_init(&queue, PARAM_QUEUE_TYPE_SET, paramver);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+
+		item_start[i] = queue.item_count;
+
+		PyObject * key = PyTuple_GET_ITEM(PyList_GET_ITEM(items, i), 0);
+		PyObject * value = PyTuple_GET_ITEM(PyList_GET_ITEM(items, i), 1);
+		PyObject * result = NULL;
+
+		param_t * param = _pycsh_util_find_param_t(key, _pycsh_param_lookup_node(node));
+		if (param == NULL) {
+			result = _pycsh_param_fetch_exception();
+		} else {
+			if (param->node == 0) {
+				/* Local parameters are set immediately, as they may have Python callbacks. */
+				int res = ((PyIter_Check(value) || PySequence_Check(value)) && !PyUnicode_Check(value)) ?
+					_pycsh_util_set_array(param, value, 0, timeout, retries, paramver, verbose) :
+					_pycsh_util_set_single(param, value, INT_MIN, 0, timeout, retries, paramver, 1, verbose);
+				if (res != 0) {
+					result = _pycsh_param_fetch_exception();
+				}
+			} else if (pycsh_util_segmented_queue_add_value(&queue, param, value, _pycsh_param_dest(param, node, server)) < 0) {
+				if (PyErr_ExceptionMatches(PyExc_MemoryError)) {
+					return NULL;
+				}
+				result = _pycsh_param_fetch_exception();
+			} else {
+				params[i] = param;
+			}
+		}
+
+		if (PyDict_SetItem(results, key, result ? result : Py_None) < 0) {
+			Py_XDECREF(result);
+			return NULL;
+		}
+		Py_XDECREF(result);
+	}
+	item_start[count] = queue.item_count;
+
+	_pycsh_param_run_concurrently(&queue, timeout, retries, max_in_flight);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+
+		param_t * param = params[i];
+		if (param == NULL) {
+			continue;  // Local, or already holds an exception.
+		}
+
+		PyObject * key = PyTuple_GET_ITEM(PyList_GET_ITEM(items, i), 0);
+
+		if (_pycsh_param_items_failed(&queue, item_start[i], item_start[i+1])) {
+			PyObject * exc AUTO_DECREF = PyObject_CallFunction(PyExc_ConnectionError, "s", "No response.");
+			if (exc == NULL || PyDict_SetItem(results, key, exc) < 0) {
+				return NULL;
+			}
+		} else if (verbose > -1) {
+			param_print(param, -1, NULL, 0, verbose, 0);
+		}
+	}
+
+	return Py_NewRef(results);
+}
+
 PyObject * pycsh_param_cmd(PyObject * self, PyObject * args) {
 
 	if (param_queue.type == PARAM_QUEUE_TYPE_EMPTY) {
@@ -14,6 +14,17 @@ PyObject * pycsh_param_get(PyObject * self, PyObject * args, PyObject * kwds);
 
 PyObject * pycsh_param_set(PyObject * self, PyObject * args, PyObject * kwds);
 
+PyObject * pycsh_param_get_many(PyObject * self, PyObject * args, PyObject * kwds);
+
+PyObject * pycsh_param_set_many(PyObject * self, PyObject * args, PyObject * kwds);
+
+PyObject * pycsh_param_aget(PyObject * self, PyObject * args, PyObject * kwds);
+
+PyObject * pycsh_param_aset(PyObject * self, PyObject * args, PyObject * kwds);
+
+PyObject * pycsh_param_cache_stats(PyObject * self, PyObject * args, PyObject * kwds);
+PyObject * pycsh_param_queue_stats(PyObject * self, PyObject * args, PyObject * kwds);
+
 
 PyObject * pycsh_param_cmd(PyObject * self, PyObject * args);
 
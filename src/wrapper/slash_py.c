@@ -7,6 +7,25 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "../param_index.h"
+
+
+/* Whether the command is "list forget", with any amount of whitespace between (and around) the words. */
+static int slash_py_is_list_forget(const char * command) {
+    const char * words[] = {"list", "forget"};
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        command += strspn(command, " \t");
+        size_t len = strlen(words[i]);
+        if (strncmp(command, words[i], len) != 0) {
+            return 0;
+        }
+        command += len;
+        if (*command != '\0' && *command != ' ' && *command != '\t') {
+            return 0;
+        }
+    }
+    return 1;
+}
 
 PyObject * pycsh_slash_execute(PyObject * self, PyObject * args, PyObject * kwds) {
 
@@ -32,8 +51,22 @@ PyObject * pycsh_slash_execute(PyObject * self, PyObject * args, PyObject * kwds
     char * cmd_cpy = strdup(command);
     slash_printf(&slas, "executing: '%s'\n", cmd_cpy);
 
+    /* "list forget" frees param_t's behind our back, so lookups must wait for it, which is quick as it's local.
+        Other commands (like "list download") may wait for the network or run Python callbacks (making lookups),
+        so we only invalidate after them. */
+    int forget_cmd = slash_py_is_list_forget(command);
+    if (forget_cmd) {
+        pycsh_param_index_begin_change();
+    }
+
     PyObject * ret = Py_BuildValue("i", slash_execute(&slas, cmd_cpy));
 
+    if (forget_cmd) {
+        pycsh_param_index_end_change();
+    } else {
+        pycsh_param_index_invalidate();
+    }
+
     free(cmd_cpy);
 
     return ret;